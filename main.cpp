@@ -7,8 +7,8 @@ using namespace vkstart;
 
 struct ApplicationState
 {
-    ApplicationState(SDL3IWindow *window, Engine &engine)
-        : m_window{window}, m_engine{std::move(engine)}
+    ApplicationState(SDL3IWindow *window, PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr)
+        : m_window{window}, m_engine{vkGetInstanceProcAddr, window}
     {
     }
 
@@ -74,9 +74,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 
     assert(vkGetInstanceProcAddr != nullptr);
 
-    Engine engine = Engine{vkGetInstanceProcAddr, window};
-
-    ApplicationState *appState = new ApplicationState{window, engine};
+    ApplicationState *appState = new ApplicationState{window, vkGetInstanceProcAddr};
     *appstate = appState;
 
     return SDL_APP_CONTINUE;
@@ -95,6 +93,14 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
         appData->GetEngine().PixelSizeChanged();
     }
         return SDL_APP_CONTINUE;
+    case SDL_EVENT_KEY_DOWN:
+        // F1 shows the scene, F2 to F4 the debug views
+        if (event->key.key >= SDLK_F1 && event->key.key < SDLK_F1 + DebugViewCount)
+        {
+            GetApplicationState(appstate)->GetEngine().SetDebugView(
+                static_cast<DebugView>(event->key.key - SDLK_F1));
+        }
+        return SDL_APP_CONTINUE;
     default:
         return SDL_APP_CONTINUE;
     }
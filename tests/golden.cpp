@@ -0,0 +1,209 @@
+#include <vkstart.h>
+
+#include "stb_image.h"
+
+using namespace vkstart;
+
+// Renders the built-in scenes headless, and compares them against the reference images.
+// Usage: vkstart-golden <scene> <reference dir> <output dir> [--update]
+// With --update, the reference gets (re)written from what was rendered.
+
+constexpr int Width = 640;
+constexpr int Height = 480;
+
+// enough for the texture to be streamed in completely
+constexpr uint32_t WarmupFrames = 16;
+constexpr float AnimationTime = 0.5f;
+
+// CIE76 color difference a pixel may have; around 2.3 is just noticeable
+constexpr float MaxDeltaE = 5.0f;
+// share of the pixels that may be off by more, for rasterization differences along edges
+constexpr double MaxFailingFraction = 0.001;
+
+const std::array<std::pair<std::string_view, BuiltinScene>, 3> Scenes{
+    {{"quads", BuiltinScene::Quads},
+     {"viking_room", BuiltinScene::VikingRoom},
+     {"stress", BuiltinScene::Stress}}};
+
+static CapturedImage Render(BuiltinScene scene)
+{
+    HeadlessWindow window{Width, Height};
+
+    EngineSettings settings{};
+    settings.Scene = scene;
+    settings.AnimationTime = AnimationTime;
+    // the references show the scene as rendered, before any post-processing
+    settings.PostProcessing = false;
+    Engine engine{vkGetInstanceProcAddr, &window, settings};
+
+    for (uint32_t i = 0; i < WarmupFrames; ++i)
+    {
+        engine.DrawFrame();
+    }
+
+    // written on a job, which WaitIdle waits for
+    std::optional<CapturedImage> captured{};
+    engine.CaptureFrame([&captured](CapturedImage image) { captured = std::move(image); });
+    engine.DrawFrame();
+    engine.WaitIdle();
+
+    if (!captured)
+    {
+        throw std::runtime_error{"nothing was captured"};
+    }
+
+    return std::move(*captured);
+}
+
+static CapturedImage LoadImage(const std::filesystem::path &path)
+{
+    int width, height, channels;
+    stbi_uc *pixels = stbi_load(path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        throw std::runtime_error{"failed to load " + path.string()};
+    }
+
+    CapturedImage image{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    image.Pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    return image;
+}
+
+static glm::vec3 SrgbToLab(const uint8_t *pixel)
+{
+    glm::vec3 linear{};
+    for (int i = 0; i < 3; ++i)
+    {
+        const float c = pixel[i] / 255.0f;
+        linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    // D65 white
+    const glm::vec3 xyz{
+        (0.4124f * linear.r + 0.3576f * linear.g + 0.1805f * linear.b) / 0.95047f,
+        0.2126f * linear.r + 0.7152f * linear.g + 0.0722f * linear.b,
+        (0.0193f * linear.r + 0.1192f * linear.g + 0.9505f * linear.b) / 1.08883f};
+
+    const auto f = [](float t) {
+        return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.0f / 116.0f;
+    };
+    const glm::vec3 fxyz{f(xyz.x), f(xyz.y), f(xyz.z)};
+
+    return {116.0f * fxyz.y - 16.0f, 500.0f * (fxyz.x - fxyz.y), 200.0f * (fxyz.y - fxyz.z)};
+}
+
+// The reference darkened, with the pixels that are off in red.
+static CapturedImage Compare(const CapturedImage &reference, const CapturedImage &actual,
+                             size_t &failingPixels)
+{
+    CapturedImage diff{reference.Width, reference.Height,
+                       std::vector<uint8_t>(reference.Pixels.size())};
+
+    failingPixels = 0;
+    for (size_t i = 0; i < reference.Pixels.size(); i += 4)
+    {
+        const glm::vec3 expected = SrgbToLab(&reference.Pixels[i]);
+        const float deltaE = glm::length(expected - SrgbToLab(&actual.Pixels[i]));
+
+        const uint8_t gray = static_cast<uint8_t>(expected.x * 0.25f / 100.0f * 255.0f);
+        diff.Pixels[i] = gray;
+        diff.Pixels[i + 1] = gray;
+        diff.Pixels[i + 2] = gray;
+        diff.Pixels[i + 3] = 255;
+
+        if (deltaE > MaxDeltaE)
+        {
+            ++failingPixels;
+            diff.Pixels[i] = static_cast<uint8_t>(std::min(128.0f + deltaE * 4.0f, 255.0f));
+            diff.Pixels[i + 1] = 0;
+            diff.Pixels[i + 2] = 0;
+        }
+    }
+
+    return diff;
+}
+
+static bool Run(std::string_view name, BuiltinScene scene,
+                const std::filesystem::path &referenceDir, const std::filesystem::path &outputDir,
+                bool update)
+{
+    const std::filesystem::path referencePath = referenceDir / (std::string{name} + ".png");
+    const std::filesystem::path actualPath = outputDir / (std::string{name} + ".png");
+    const std::filesystem::path diffPath = outputDir / (std::string{name} + ".diff.png");
+
+    const CapturedImage actual = Render(scene);
+    std::filesystem::create_directories(outputDir);
+    FrameCapture::Save(actual, actualPath, CaptureFormat::Png);
+
+    if (update)
+    {
+        std::filesystem::create_directories(referenceDir);
+        FrameCapture::Save(actual, referencePath, CaptureFormat::Png);
+        SDL_Log("%s: reference written to %s", name.data(), referencePath.string().c_str());
+        return true;
+    }
+
+    if (!std::filesystem::exists(referencePath))
+    {
+        SDL_Log("%s: no reference at %s; build the update-golden-images target, then review "
+                "and commit it",
+                name.data(), referencePath.string().c_str());
+        return false;
+    }
+
+    const CapturedImage reference = LoadImage(referencePath);
+    if (reference.Width != actual.Width || reference.Height != actual.Height)
+    {
+        SDL_Log("%s: rendered %ux%u, the reference is %ux%u", name.data(), actual.Width,
+                actual.Height, reference.Width, reference.Height);
+        return false;
+    }
+
+    size_t failingPixels = 0;
+    const CapturedImage diff = Compare(reference, actual, failingPixels);
+    const double failingFraction =
+        static_cast<double>(failingPixels) / (static_cast<size_t>(actual.Width) * actual.Height);
+    if (failingFraction > MaxFailingFraction)
+    {
+        FrameCapture::Save(diff, diffPath, CaptureFormat::Png);
+        SDL_Log("%s: %zu pixels differ by more than %.1f, see %s", name.data(), failingPixels,
+                MaxDeltaE, diffPath.string().c_str());
+        return false;
+    }
+
+    SDL_Log("%s: %zu pixels differ by more than %.1f, within tolerance", name.data(),
+            failingPixels, MaxDeltaE);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        SDL_Log("usage: %s <scene> <reference dir> <output dir> [--update]", argv[0]);
+        return 2;
+    }
+
+    const std::string_view name = argv[1];
+    const bool update = argc > 4 && std::string_view{argv[4]} == "--update";
+
+    const auto scene = std::ranges::find_if(
+        Scenes, [name](const auto &namedScene) { return namedScene.first == name; });
+    if (scene == Scenes.end())
+    {
+        SDL_Log("unknown scene %s", argv[1]);
+        return 2;
+    }
+
+    try
+    {
+        return Run(name, scene->second, argv[2], argv[3], update) ? 0 : 1;
+    }
+    catch (const std::exception &e)
+    {
+        SDL_Log("%s: %s", argv[1], e.what());
+        return 1;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <AssetArchive.h>
+
+#include <iostream>
+
+using namespace vkstart;
+
+// vkstart-pack <archive> <root> [--compression none|lz4|zstd] <file>...
+// Files are given relative to <root>, which is also what they are called in the archive.
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: vkstart-pack <archive> <root> [--compression none|lz4|zstd] "
+                     "<file>...\n";
+        return 1;
+    }
+
+    const std::filesystem::path archivePath{argv[1]};
+    const std::filesystem::path root{argv[2]};
+
+    AssetCompression compression = AssetCompression::None;
+    std::vector<std::pair<std::string, std::filesystem::path>> files{};
+    for (int i = 3; i < argc; ++i)
+    {
+        const std::string argument{argv[i]};
+        if (argument == "--compression" && i + 1 < argc)
+        {
+            const std::string name{argv[++i]};
+            compression = name == "lz4"    ? AssetCompression::Lz4
+                          : name == "zstd" ? AssetCompression::Zstd
+                                           : AssetCompression::None;
+            continue;
+        }
+
+        const std::filesystem::path relative = std::filesystem::path{argument}.lexically_normal();
+        files.emplace_back(relative.generic_string(), root / relative);
+    }
+
+    if (!AssetArchive::IsCompressionSupported(compression))
+    {
+        std::cerr << "vkstart-pack: compression not available in this build, storing as is\n";
+        compression = AssetCompression::None;
+    }
+
+    try
+    {
+        AssetArchive::Write(archivePath, files, compression);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "vkstart-pack: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
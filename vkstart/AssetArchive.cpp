@@ -0,0 +1,346 @@
+#include "AssetArchive.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef VKSTART_WITH_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#ifdef VKSTART_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace vkstart
+{
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static std::vector<char> Compress(const std::vector<char> &data, AssetCompression compression)
+{
+    std::vector<char> compressed{};
+
+    switch (compression)
+    {
+    case AssetCompression::None:
+        break;
+    case AssetCompression::Lz4: {
+#ifdef VKSTART_WITH_LZ4
+        compressed.resize(LZ4_compressBound(static_cast<int>(data.size())));
+        const int size = LZ4_compress_HC(data.data(), compressed.data(),
+                                         static_cast<int>(data.size()),
+                                         static_cast<int>(compressed.size()), LZ4HC_CLEVEL_MAX);
+        compressed.resize(size > 0 ? size : 0);
+#endif
+        break;
+    }
+    case AssetCompression::Zstd: {
+#ifdef VKSTART_WITH_ZSTD
+        compressed.resize(ZSTD_compressBound(data.size()));
+        const size_t size = ZSTD_compress(compressed.data(), compressed.size(), data.data(),
+                                          data.size(), ZSTD_maxCLevel());
+        compressed.resize(ZSTD_isError(size) ? 0 : size);
+#endif
+        break;
+    }
+    }
+
+    return compressed;
+}
+
+static void Decompress(std::span<const char> stored, AssetCompression compression,
+                       std::vector<char> &data)
+{
+    switch (compression)
+    {
+    case AssetCompression::None:
+        std::copy(stored.begin(), stored.end(), data.begin());
+        return;
+    case AssetCompression::Lz4:
+#ifdef VKSTART_WITH_LZ4
+        if (LZ4_decompress_safe(stored.data(), data.data(), static_cast<int>(stored.size()),
+                                static_cast<int>(data.size())) == static_cast<int>(data.size()))
+        {
+            return;
+        }
+#endif
+        break;
+    case AssetCompression::Zstd:
+#ifdef VKSTART_WITH_ZSTD
+        if (ZSTD_decompress(data.data(), data.size(), stored.data(), stored.size()) ==
+            data.size())
+        {
+            return;
+        }
+#endif
+        break;
+    }
+
+    throw std::runtime_error{"failed to decompress asset"};
+}
+
+AssetArchive::AssetArchive(const std::filesystem::path &path)
+{
+#ifdef _WIN32
+    m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        throw std::runtime_error{"failed to open asset archive"};
+    }
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(m_file, &size);
+    m_size = static_cast<size_t>(size.QuadPart);
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping)
+    {
+        m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    m_file = open(path.c_str(), O_RDONLY);
+    if (m_file < 0)
+    {
+        throw std::runtime_error{"failed to open asset archive"};
+    }
+
+    struct stat status{};
+    fstat(m_file, &status);
+    m_size = static_cast<size_t>(status.st_size);
+
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_file, 0);
+    m_data = data == MAP_FAILED ? nullptr : static_cast<const char *>(data);
+#endif
+
+    try
+    {
+        ReadTableOfContents();
+    }
+    catch (...)
+    {
+        Close();
+        throw;
+    }
+
+#ifndef _WIN32
+    // the loaders walk most entries front to back, once
+    madvise(const_cast<char *>(m_data), m_size, MADV_WILLNEED);
+#endif
+}
+
+AssetArchive::~AssetArchive()
+{
+    Close();
+}
+
+bool AssetArchive::Contains(const std::string &name) const
+{
+    return m_entries.contains(name);
+}
+
+std::span<const char> AssetArchive::Stored(const std::string &name) const
+{
+    const ArchiveEntry &entry = Entry(name);
+    return {m_data + entry.Offset, static_cast<size_t>(entry.StoredSize)};
+}
+
+std::vector<char> AssetArchive::Read(const std::string &name) const
+{
+    const ArchiveEntry &entry = Entry(name);
+
+    std::vector<char> data(static_cast<size_t>(entry.Size));
+    Decompress(Stored(name), entry.Compression, data);
+
+    return data;
+}
+
+void AssetArchive::Write(const std::filesystem::path &path,
+                         const std::vector<std::pair<std::string, std::filesystem::path>> &files,
+                         AssetCompression compression)
+{
+    if (!IsCompressionSupported(compression))
+    {
+        throw std::runtime_error{"asset compression not supported by this build"};
+    }
+
+    std::ofstream archive(path, std::ios::binary | std::ios::trunc);
+    if (!archive.is_open())
+    {
+        throw std::runtime_error{"failed to create asset archive"};
+    }
+
+    ArchiveHeader header{ArchiveMagic, ArchiveVersion, static_cast<uint32_t>(files.size())};
+    archive.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    std::vector<ArchiveEntry> entries{};
+    std::string names{};
+    uint64_t offset = sizeof(header);
+    for (const auto &[name, filePath] : files)
+    {
+        std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error{"failed to open " + filePath.string()};
+        }
+
+        std::vector<char> data(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+        std::vector<char> stored = Compress(data, compression);
+        AssetCompression storedCompression = compression;
+        if (stored.empty() || stored.size() > data.size() - data.size() / 8)
+        {
+            stored = std::move(data);
+            storedCompression = AssetCompression::None;
+        }
+
+        const uint64_t entryOffset = AlignUp(offset, ArchiveAlignment);
+        const std::vector<char> padding(entryOffset - offset, 0);
+        archive.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        archive.write(stored.data(), static_cast<std::streamsize>(stored.size()));
+
+        const uint64_t size = storedCompression == AssetCompression::None
+                                  ? stored.size()
+                                  : static_cast<uint64_t>(data.size());
+        entries.push_back({entryOffset, stored.size(), size, storedCompression,
+                           static_cast<uint32_t>(names.size()),
+                           static_cast<uint32_t>(name.size()), 0});
+        names += name;
+        offset = entryOffset + stored.size();
+    }
+
+    header.TocOffset = offset;
+    header.TocSize = entries.size() * sizeof(ArchiveEntry) + names.size();
+    archive.write(reinterpret_cast<const char *>(entries.data()),
+                  static_cast<std::streamsize>(entries.size() * sizeof(ArchiveEntry)));
+    archive.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    archive.seekp(0, std::ios::beg);
+    archive.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    if (!archive.good())
+    {
+        throw std::runtime_error{"failed to write asset archive"};
+    }
+}
+
+bool AssetArchive::IsCompressionSupported(AssetCompression compression)
+{
+    switch (compression)
+    {
+    case AssetCompression::None:
+        return true;
+    case AssetCompression::Lz4:
+#ifdef VKSTART_WITH_LZ4
+        return true;
+#else
+        return false;
+#endif
+    case AssetCompression::Zstd:
+#ifdef VKSTART_WITH_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+void AssetArchive::ReadTableOfContents()
+{
+    ArchiveHeader header{};
+    if (!m_data || m_size < sizeof(header))
+    {
+        throw std::runtime_error{"failed to map asset archive"};
+    }
+
+    memcpy(&header, m_data, sizeof(header));
+    if (header.Magic != ArchiveMagic || header.Version != ArchiveVersion ||
+        header.TocOffset > m_size || header.TocSize > m_size - header.TocOffset ||
+        header.EntryCount * sizeof(ArchiveEntry) > header.TocSize)
+    {
+        throw std::runtime_error{"invalid asset archive"};
+    }
+
+    const char *toc = m_data + header.TocOffset;
+    const char *names = toc + header.EntryCount * sizeof(ArchiveEntry);
+    const uint64_t namesSize = header.TocSize - header.EntryCount * sizeof(ArchiveEntry);
+
+    m_entries.reserve(header.EntryCount);
+    for (uint32_t i = 0; i < header.EntryCount; ++i)
+    {
+        ArchiveEntry entry{};
+        memcpy(&entry, toc + i * sizeof(ArchiveEntry), sizeof(entry));
+        // compared against what is left after the offsets, so that the sums cannot wrap
+        if (entry.Offset > header.TocOffset ||
+            entry.StoredSize > header.TocOffset - entry.Offset || entry.NameOffset > namesSize ||
+            entry.NameLength > namesSize - entry.NameOffset ||
+            (entry.Compression == AssetCompression::None && entry.StoredSize != entry.Size))
+        {
+            throw std::runtime_error{"invalid asset archive entry"};
+        }
+
+        m_entries.emplace(std::string{names + entry.NameOffset, entry.NameLength}, entry);
+    }
+}
+
+void AssetArchive::Close()
+{
+#ifdef _WIN32
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file)
+    {
+        CloseHandle(m_file);
+    }
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data)
+    {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+    if (m_file >= 0)
+    {
+        close(m_file);
+    }
+    m_file = -1;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const ArchiveEntry &AssetArchive::Entry(const std::string &name) const
+{
+    const auto entry = m_entries.find(name);
+    if (entry == m_entries.end())
+    {
+        throw std::runtime_error{"no asset named " + name};
+    }
+
+    return entry->second;
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// Layout of a packed asset archive, all little endian:
+//   ArchiveHeader
+//   entry data, every entry starting at a multiple of `ArchiveAlignment`
+//   table of contents: `EntryCount` ArchiveEntry, followed by the names
+constexpr std::array<char, 4> ArchiveMagic{'V', 'K', 'P', 'K'};
+constexpr uint32_t ArchiveVersion = 1;
+
+// A page, so that every entry can be mapped, or read unbuffered, on its own.
+constexpr uint64_t ArchiveAlignment = 4096;
+
+enum class AssetCompression : uint32_t
+{
+    None = 0,
+    Lz4 = 1,
+    Zstd = 2,
+};
+
+struct ArchiveHeader
+{
+    std::array<char, 4> Magic;
+    uint32_t Version;
+    uint32_t EntryCount;
+    uint32_t Reserved;
+    uint64_t TocOffset;
+    uint64_t TocSize;
+};
+
+struct ArchiveEntry
+{
+    uint64_t Offset;
+    uint64_t StoredSize;
+    uint64_t Size;
+    AssetCompression Compression;
+    uint32_t NameOffset;
+    uint32_t NameLength;
+    uint32_t Reserved;
+};
+
+// Read-only, memory-mapped archive.
+struct AssetArchive
+{
+    explicit AssetArchive(const std::filesystem::path &path);
+    ~AssetArchive();
+
+    AssetArchive(const AssetArchive &) = delete;
+    AssetArchive &operator=(const AssetArchive &) = delete;
+
+    bool Contains(const std::string &name) const;
+
+    // The entry as stored in the archive, without copying it.
+    // Only the entry's actual content if it isn't compressed.
+    std::span<const char> Stored(const std::string &name) const;
+
+    // The entry's content, decompressed if need be.
+    std::vector<char> Read(const std::string &name) const;
+
+    // Packs `files` (archive name, file on disk) into a new archive at `path`. Entries that
+    // `compression` doesn't shrink by at least an eighth are stored as they are.
+    static void Write(const std::filesystem::path &path,
+                      const std::vector<std::pair<std::string, std::filesystem::path>> &files,
+                      AssetCompression compression);
+
+    static bool IsCompressionSupported(AssetCompression compression);
+
+  private:
+    void ReadTableOfContents();
+    void Close();
+    const ArchiveEntry &Entry(const std::string &name) const;
+
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+
+    std::unordered_map<std::string, ArchiveEntry> m_entries;
+};
+
+} // namespace vkstart
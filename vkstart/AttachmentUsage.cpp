@@ -0,0 +1,51 @@
+#include "AttachmentUsage.h"
+
+namespace vkstart
+{
+
+vk::AttachmentLoadOp LoadOp(const AttachmentUsage &usage)
+{
+    if (usage.LoadsPrevious)
+    {
+        return vk::AttachmentLoadOp::eLoad;
+    }
+    if (usage.Cleared)
+    {
+        return vk::AttachmentLoadOp::eClear;
+    }
+
+    return vk::AttachmentLoadOp::eDontCare;
+}
+
+vk::AttachmentStoreOp StoreOp(const AttachmentUsage &usage)
+{
+    return usage.UsedAfterPass ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+}
+
+bool IsTransient(const AttachmentUsage &usage)
+{
+    return !usage.LoadsPrevious && !usage.UsedAfterPass;
+}
+
+vk::ImageUsageFlags ImageUsage(const AttachmentUsage &usage, vk::ImageUsageFlags attachmentUsage)
+{
+    if (IsTransient(usage))
+    {
+        attachmentUsage |= vk::ImageUsageFlagBits::eTransientAttachment;
+    }
+
+    return attachmentUsage;
+}
+
+vk::MemoryPropertyFlags MemoryProperties(const AttachmentUsage &usage)
+{
+    vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    if (IsTransient(usage))
+    {
+        properties |= vk::MemoryPropertyFlagBits::eLazilyAllocated;
+    }
+
+    return properties;
+}
+
+} // namespace vkstart
\ No newline at end of file
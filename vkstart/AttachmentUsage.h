@@ -0,0 +1,34 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// What happens to an attachment's contents around a rendering pass,
+// from which its load and store ops and its memory follow.
+struct AttachmentUsage
+{
+    // reads what an earlier pass left, otherwise the contents start out undefined
+    bool LoadsPrevious = false;
+    // starts out cleared, unless it loads the previous contents
+    bool Cleared = false;
+    // read after the pass, e.g. sampled, copied or presented
+    bool UsedAfterPass = false;
+};
+
+vk::AttachmentLoadOp LoadOp(const AttachmentUsage &usage);
+vk::AttachmentStoreOp StoreOp(const AttachmentUsage &usage);
+
+// Contents that never leave the pass can stay in tile memory on tilers,
+// and need no backing memory there.
+bool IsTransient(const AttachmentUsage &usage);
+
+// `attachmentUsage` with eTransientAttachment added if the attachment is transient.
+vk::ImageUsageFlags ImageUsage(const AttachmentUsage &usage,
+                               vk::ImageUsageFlags attachmentUsage);
+
+// Device local, and lazily allocated if the attachment is transient.
+vk::MemoryPropertyFlags MemoryProperties(const AttachmentUsage &usage);
+
+} // namespace vkstart
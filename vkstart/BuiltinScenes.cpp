@@ -0,0 +1,142 @@
+#include "BuiltinScenes.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace vkstart
+{
+
+const std::vector<Vertex> Vertices = {{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+                                      {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+                                      {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+                                      {{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
+
+                                      {{-0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+                                      {{0.5f, -0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+                                      {{0.5f, 0.5f, -0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+                                      {{-0.5f, 0.5f, -0.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}};
+
+const std::vector<uint32_t> Indices = {0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4};
+
+constexpr uint32_t StressLayers = 16;
+// quads per side of every layer
+constexpr uint32_t StressLayerQuads = 64;
+
+static Mesh StressMesh()
+{
+    Mesh mesh{};
+
+    const uint32_t verticesPerSide = StressLayerQuads + 1;
+    for (uint32_t layer = 0; layer < StressLayers; ++layer)
+    {
+        const float layerFraction = static_cast<float>(layer) / (StressLayers - 1);
+        const uint32_t firstVertex = static_cast<uint32_t>(mesh.Vertices.size());
+
+        for (uint32_t y = 0; y < verticesPerSide; ++y)
+        {
+            for (uint32_t x = 0; x < verticesPerSide; ++x)
+            {
+                const float u = static_cast<float>(x) / StressLayerQuads;
+                const float v = static_cast<float>(y) / StressLayerQuads;
+
+                // every layer waves a little differently, so that they intersect
+                const float phase = layerFraction * glm::pi<float>();
+                const float z = -0.5f + layerFraction +
+                                0.1f * std::sin(u * 4.0f * glm::pi<float>() + phase) *
+                                    std::cos(v * 4.0f * glm::pi<float>() - phase);
+
+                mesh.Vertices.push_back(
+                    {{u - 0.5f, v - 0.5f, z}, {u, v, 1.0f - layerFraction}, {u, v}});
+            }
+        }
+
+        for (uint32_t y = 0; y < StressLayerQuads; ++y)
+        {
+            for (uint32_t x = 0; x < StressLayerQuads; ++x)
+            {
+                const uint32_t i = firstVertex + y * verticesPerSide + x;
+                mesh.Indices.insert(mesh.Indices.end(), {i, i + 1, i + verticesPerSide + 1,
+                                                         i + verticesPerSide + 1,
+                                                         i + verticesPerSide, i});
+            }
+        }
+    }
+
+    return mesh;
+}
+
+Mesh BuiltinSceneMesh(BuiltinScene scene, const VirtualFileSystem &assets)
+{
+    switch (scene)
+    {
+    case BuiltinScene::Quads:
+        return Mesh{Vertices, Indices};
+    case BuiltinScene::VikingRoom:
+        return LoadObj(assets.Read("models/viking_room.obj"));
+    case BuiltinScene::Stress:
+        return StressMesh();
+    }
+
+    throw std::runtime_error{"unknown scene"};
+}
+
+std::string BuiltinSceneTexture(BuiltinScene scene)
+{
+    return scene == BuiltinScene::VikingRoom ? "models/viking_room.png" : "textures/texture.jpg";
+}
+
+MaterialFeatures BuiltinSceneMaterial(BuiltinScene scene)
+{
+    // the OBJ has no vertex colors, the others are colored per vertex
+    return MaterialFeatures{.Texture = true, .VertexColor = scene != BuiltinScene::VikingRoom};
+}
+
+Mesh LoadObj(std::span<const char> obj)
+{
+    tinyobj::ObjReaderConfig config{};
+    config.triangulate = true;
+    config.vertex_color = false;
+
+    tinyobj::ObjReader reader{};
+    if (!reader.ParseFromString(std::string{obj.begin(), obj.end()}, "", config))
+    {
+        throw std::runtime_error{"failed to parse OBJ: " + reader.Error()};
+    }
+
+    const tinyobj::attrib_t &attrib = reader.GetAttrib();
+
+    Mesh mesh{};
+    // ordered, so that the vertex order doesn't depend on the hash
+    std::map<std::pair<int, int>, uint32_t> vertexIndices{};
+    for (const tinyobj::shape_t &shape : reader.GetShapes())
+    {
+        for (const tinyobj::index_t &index : shape.mesh.indices)
+        {
+            const std::pair key{index.vertex_index, index.texcoord_index};
+            auto [entry, inserted] =
+                vertexIndices.try_emplace(key, static_cast<uint32_t>(mesh.Vertices.size()));
+            if (inserted)
+            {
+                const size_t position = 3 * static_cast<size_t>(index.vertex_index);
+                Vertex vertex{{attrib.vertices[position], attrib.vertices[position + 1],
+                               attrib.vertices[position + 2]},
+                              {1.0f, 1.0f, 1.0f},
+                              {0.0f, 0.0f}};
+                if (index.texcoord_index >= 0)
+                {
+                    // OBJ has v going up, Vulkan images start at the top
+                    const size_t texcoord = 2 * static_cast<size_t>(index.texcoord_index);
+                    vertex.TextureCoordinates = {attrib.texcoords[texcoord],
+                                                 1.0f - attrib.texcoords[texcoord + 1]};
+                }
+                mesh.Vertices.push_back(vertex);
+            }
+
+            mesh.Indices.push_back(entry->second);
+        }
+    }
+
+    return mesh;
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "Mesh.h"
+#include "ShaderVariant.h"
+#include "VirtualFileSystem.h"
+
+namespace vkstart
+{
+
+// What the engine draws. All of them are deterministic, for golden-image tests.
+enum class BuiltinScene
+{
+    // two textured quads, one above the other
+    Quads,
+
+    // models/viking_room.obj with its texture
+    VikingRoom,
+
+    // many stacked, finely tessellated layers, for lots of triangles and overdraw
+    Stress,
+};
+
+// Just the vertices and triangles, without LODs, meshlets or bounds.
+Mesh BuiltinSceneMesh(BuiltinScene scene, const VirtualFileSystem &assets);
+
+// Asset name of the texture the scene's mesh is drawn with.
+std::string BuiltinSceneTexture(BuiltinScene scene);
+
+// What the scene's mesh has to be drawn with: its texture, and its vertex colors where the
+// vertices have any besides white.
+MaterialFeatures BuiltinSceneMaterial(BuiltinScene scene);
+
+// Parses a Wavefront OBJ, with positions and texture coordinates, into a mesh
+// with one vertex per distinct pair of them.
+Mesh LoadObj(std::span<const char> obj);
+
+} // namespace vkstart
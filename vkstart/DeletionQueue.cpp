@@ -0,0 +1,27 @@
+#include "DeletionQueue.h"
+
+namespace vkstart
+{
+
+void DeletionQueue::Release(uint64_t completed)
+{
+    while (!m_entries.empty() && m_entries.front().LastUse <= completed)
+    {
+        m_entries.pop_front();
+    }
+}
+
+void DeletionQueue::ReleaseAll()
+{
+    while (!m_entries.empty())
+    {
+        m_entries.pop_front();
+    }
+}
+
+size_t DeletionQueue::Size() const
+{
+    return m_entries.size();
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// Keeps RAII handles (buffers, images, views, pipelines, memory, ...) alive until the GPU
+// has passed the point of their last use, given as a frame number or a timeline value.
+// Everything retired with the same point is destroyed in the order it was retired.
+struct DeletionQueue
+{
+    // `lastUse` must not be smaller than the one of the previous retirement.
+    template <typename T> void Retire(T &&resource, uint64_t lastUse)
+    {
+        assert(m_entries.empty() || m_entries.back().LastUse <= lastUse);
+        auto shared = std::make_shared<std::decay_t<T>>(std::forward<T>(resource));
+        m_entries.push_back({lastUse, std::move(shared)});
+    }
+
+    // Destroys everything whose last use is at or before `completed`.
+    void Release(uint64_t completed);
+
+    // Destroys everything, once the device is idle.
+    void ReleaseAll();
+
+    size_t Size() const;
+
+  private:
+    struct Entry
+    {
+        uint64_t LastUse;
+        std::shared_ptr<void> Resource;
+    };
+
+    std::deque<Entry> m_entries;
+};
+
+} // namespace vkstart
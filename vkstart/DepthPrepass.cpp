@@ -0,0 +1,103 @@
+#include "DepthPrepass.h"
+
+namespace vkstart
+{
+
+// Scene passes measured each way per probe; the first few after a switch are skipped,
+// while the GPU's caches and clocks settle.
+constexpr uint32_t ProbeFrames = 32;
+constexpr uint32_t SkippedFrames = 4;
+
+// Frames between probes.
+constexpr uint32_t SettledFrames = 1200;
+
+// How much faster the other way has to be to switch to it, so that it doesn't flip back and
+// forth on noise.
+constexpr double SwitchMargin = 0.05;
+
+DepthPrepassSelector::DepthPrepassSelector(DepthPrepassMode mode)
+    : m_mode{mode}, m_enabled{mode == DepthPrepassMode::On}
+{
+    if (m_mode == DepthPrepassMode::Auto)
+    {
+        StartProbe();
+    }
+}
+
+void DepthPrepassSelector::SetMode(DepthPrepassMode mode)
+{
+    m_mode = mode;
+    m_probing = false;
+    m_enabled = mode == DepthPrepassMode::On;
+    if (m_mode == DepthPrepassMode::Auto)
+    {
+        StartProbe();
+    }
+}
+
+DepthPrepassMode DepthPrepassSelector::Mode() const
+{
+    return m_mode;
+}
+
+void DepthPrepassSelector::Update(bool prepass, double cost)
+{
+    if (m_mode != DepthPrepassMode::Auto || cost <= 0.0)
+    {
+        return;
+    }
+
+    if (!m_probing)
+    {
+        if (--m_framesUntilProbe == 0)
+        {
+            StartProbe();
+        }
+        return;
+    }
+
+    // passes recorded before the last switch arrive late, and count for the way they went
+    Samples &samples = m_samples[prepass];
+    ++samples.Count;
+    if (samples.Count > SkippedFrames && samples.Count <= SkippedFrames + ProbeFrames)
+    {
+        samples.Total += cost;
+    }
+
+    const auto measured = [](const Samples &s) { return s.Count >= SkippedFrames + ProbeFrames; };
+    if (!measured(m_samples[m_enabled]))
+    {
+        return;
+    }
+    if (!measured(m_samples[!m_enabled]))
+    {
+        m_enabled = !m_enabled;
+        return;
+    }
+
+    // ended on the way it went before the probe
+    const double current = m_samples[m_enabled].Total / ProbeFrames;
+    const double other = m_samples[!m_enabled].Total / ProbeFrames;
+    if (other < current * (1.0 - SwitchMargin))
+    {
+        m_enabled = !m_enabled;
+    }
+
+    m_probing = false;
+    m_framesUntilProbe = SettledFrames;
+}
+
+bool DepthPrepassSelector::IsEnabled() const
+{
+    return m_enabled;
+}
+
+void DepthPrepassSelector::StartProbe()
+{
+    m_probing = true;
+    m_samples = {};
+    // the other way first, so that the probe ends on the way it went before
+    m_enabled = !m_enabled;
+}
+
+} // namespace vkstart
\ No newline at end of file
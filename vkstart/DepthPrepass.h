@@ -0,0 +1,52 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+enum class DepthPrepassMode
+{
+    Off,
+    On,
+    // on or off, whichever renders the scene faster, see `DepthPrepassSelector`
+    Auto,
+};
+
+// Decides whether the scene gets a depth pre-pass, which costs a second pass over the
+// geometry but shades every pixel just once. Whether that pays off depends on the overdraw,
+// which changes with the view, so in Auto it measures the scene pass both ways every now
+// and then, and keeps the faster one until the next time.
+struct DepthPrepassSelector
+{
+    explicit DepthPrepassSelector(DepthPrepassMode mode);
+
+    void SetMode(DepthPrepassMode mode);
+    DepthPrepassMode Mode() const;
+
+    // Feeds back what a scene pass cost on the GPU, and whether it had the pre-pass.
+    void Update(bool prepass, double cost);
+
+    // whether the next frame gets the pre-pass
+    bool IsEnabled() const;
+
+  private:
+    struct Samples
+    {
+        double Total = 0.0;
+        uint32_t Count = 0;
+    };
+
+    void StartProbe();
+
+    DepthPrepassMode m_mode;
+    bool m_enabled;
+
+    // only in Auto
+    bool m_probing = false;
+    // without and with the pre-pass
+    std::array<Samples, 2> m_samples{};
+    uint32_t m_framesUntilProbe = 0;
+};
+
+} // namespace vkstart
@@ -0,0 +1,227 @@
+#include "DeviceQueues.h"
+
+namespace vkstart
+{
+
+// Graphics comes first when the hardware arbitrates between queues, async compute may
+// delay a frame less than transfers, which are mostly streaming that can run late.
+static constexpr std::array<float, 1> GraphicsPriority{1.0f};
+static constexpr std::array<float, 1> ComputePriority{0.75f};
+static constexpr std::array<float, 1> TransferPriority{0.5f};
+
+std::vector<vk::DeviceQueueCreateInfo> DeviceQueues::CreateInfos(
+    const QueueFamilyIndices &indices)
+{
+    std::vector<vk::DeviceQueueCreateInfo> createInfos{
+        vk::DeviceQueueCreateInfo{{}, indices.GraphicsIndex(), GraphicsPriority}};
+
+    auto add = [&createInfos](uint32_t family, const std::array<float, 1> &priority) {
+        for (const vk::DeviceQueueCreateInfo &createInfo : createInfos)
+        {
+            if (createInfo.queueFamilyIndex == family)
+            {
+                return;
+            }
+        }
+        createInfos.push_back(vk::DeviceQueueCreateInfo{{}, family, priority});
+    };
+
+    add(indices.ComputeIndex(), ComputePriority);
+    add(indices.TransferIndex(), TransferPriority);
+    add(indices.PresentIndex(), GraphicsPriority);
+
+    return createInfos;
+}
+
+DeviceQueues::DeviceQueues(const vk::raii::Device &device, const QueueFamilyIndices &indices)
+    : m_device{device}
+{
+    const std::array<uint32_t, 3> families{indices.GraphicsIndex(), indices.ComputeIndex(),
+                                           indices.TransferIndex()};
+
+    // reserved, so that the states don't move while they get added
+    m_states.reserve(families.size());
+
+    for (size_t type = 0; type < families.size(); ++type)
+    {
+        const uint32_t family = families[type];
+
+        auto existing = std::ranges::find_if(
+            m_states, [family](const QueueState &state) { return state.Family == family; });
+        if (existing != m_states.end())
+        {
+            m_stateIndices[type] = std::distance(m_states.begin(), existing);
+            continue;
+        }
+
+        vk::SemaphoreTypeCreateInfo typeCreateInfo{vk::SemaphoreType::eTimeline, 0};
+        vk::SemaphoreCreateInfo createInfo{{}, &typeCreateInfo};
+
+        QueueState state{family};
+        state.Queue = vk::raii::Queue{device, family, 0};
+        state.Timeline = vk::raii::Semaphore{device, createInfo};
+
+        m_stateIndices[type] = m_states.size();
+        m_states.push_back(std::move(state));
+    }
+}
+
+uint32_t DeviceQueues::FamilyIndex(QueueType queue) const
+{
+    return State(queue).Family;
+}
+
+const vk::raii::Queue &DeviceQueues::Queue(QueueType queue) const
+{
+    return State(queue).Queue;
+}
+
+bool DeviceQueues::IsDedicated(QueueType queue) const
+{
+    return queue == QueueType::Graphics || State(queue).Family != FamilyIndex(QueueType::Graphics);
+}
+
+uint64_t DeviceQueues::Submit(QueueType queue, std::span<const vk::CommandBuffer> commandBuffers,
+                              std::span<const QueueWait> waits,
+                              std::span<const vk::SemaphoreSubmitInfo> semaphoreWaits,
+                              std::span<const vk::SemaphoreSubmitInfo> semaphoreSignals,
+                              vk::Fence fence)
+{
+    QueueState &state = State(queue);
+
+    std::vector<vk::SemaphoreSubmitInfo> waitInfos{semaphoreWaits.begin(), semaphoreWaits.end()};
+    for (const QueueWait &wait : waits)
+    {
+        const QueueState &other = State(wait.Queue);
+        if (&other != &state)
+        {
+            waitInfos.push_back(
+                vk::SemaphoreSubmitInfo{*other.Timeline, wait.Value, wait.Stages});
+        }
+    }
+
+    const uint64_t value = ++state.LastValue;
+
+    std::vector<vk::SemaphoreSubmitInfo> signalInfos{semaphoreSignals.begin(),
+                                                     semaphoreSignals.end()};
+    signalInfos.push_back(
+        vk::SemaphoreSubmitInfo{*state.Timeline, value, vk::PipelineStageFlagBits2::eAllCommands});
+
+    std::vector<vk::CommandBufferSubmitInfo> commandBufferInfos;
+    commandBufferInfos.reserve(commandBuffers.size());
+    for (vk::CommandBuffer commandBuffer : commandBuffers)
+    {
+        commandBufferInfos.push_back(vk::CommandBufferSubmitInfo{commandBuffer});
+    }
+
+    state.Queue.submit2(vk::SubmitInfo2{{}, waitInfos, commandBufferInfos, signalInfos}, fence);
+
+    return value;
+}
+
+void DeviceQueues::Wait(QueueType queue, uint64_t value) const
+{
+    const QueueState &state = State(queue);
+
+    const vk::Semaphore timeline = *state.Timeline;
+    vk::SemaphoreWaitInfo waitInfo{{}, timeline, value};
+    while (m_device.waitSemaphores(waitInfo, UINT64_MAX) == vk::Result::eTimeout)
+    {
+    }
+}
+
+DeviceQueues::QueueState &DeviceQueues::State(QueueType queue)
+{
+    return m_states[m_stateIndices[static_cast<size_t>(queue)]];
+}
+
+const DeviceQueues::QueueState &DeviceQueues::State(QueueType queue) const
+{
+    return m_states[m_stateIndices[static_cast<size_t>(queue)]];
+}
+
+bool OwnershipTransfer::CrossesFamilies() const
+{
+    return SrcFamily != DstFamily;
+}
+
+void OwnershipTransfer::Release(const vk::raii::CommandBuffer &commandBuffer,
+                                vk::Buffer buffer) const
+{
+    if (!CrossesFamilies())
+    {
+        return;
+    }
+
+    vk::BufferMemoryBarrier2 barrier{SrcStages,
+                                     SrcAccess,
+                                     vk::PipelineStageFlagBits2::eNone,
+                                     vk::AccessFlagBits2::eNone,
+                                     SrcFamily,
+                                     DstFamily,
+                                     buffer,
+                                     0,
+                                     vk::WholeSize};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, barrier});
+}
+
+void OwnershipTransfer::Acquire(const vk::raii::CommandBuffer &commandBuffer,
+                                vk::Buffer buffer) const
+{
+    const bool crosses = CrossesFamilies();
+
+    // the release and the semaphore wait already made the source's writes available
+    vk::BufferMemoryBarrier2 barrier{crosses ? vk::PipelineStageFlagBits2::eNone : SrcStages,
+                                     crosses ? vk::AccessFlagBits2::eNone : SrcAccess,
+                                     DstStages,
+                                     DstAccess,
+                                     crosses ? SrcFamily : vk::QueueFamilyIgnored,
+                                     crosses ? DstFamily : vk::QueueFamilyIgnored,
+                                     buffer,
+                                     0,
+                                     vk::WholeSize};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, barrier});
+}
+
+void OwnershipTransfer::Release(const vk::raii::CommandBuffer &commandBuffer, vk::Image image,
+                                const vk::ImageSubresourceRange &range,
+                                vk::ImageLayout oldLayout, vk::ImageLayout newLayout) const
+{
+    if (!CrossesFamilies())
+    {
+        return;
+    }
+
+    vk::ImageMemoryBarrier2 barrier{SrcStages,
+                                    SrcAccess,
+                                    vk::PipelineStageFlagBits2::eNone,
+                                    vk::AccessFlagBits2::eNone,
+                                    oldLayout,
+                                    newLayout,
+                                    SrcFamily,
+                                    DstFamily,
+                                    image,
+                                    range};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, barrier});
+}
+
+void OwnershipTransfer::Acquire(const vk::raii::CommandBuffer &commandBuffer, vk::Image image,
+                                const vk::ImageSubresourceRange &range,
+                                vk::ImageLayout oldLayout, vk::ImageLayout newLayout) const
+{
+    const bool crosses = CrossesFamilies();
+
+    vk::ImageMemoryBarrier2 barrier{crosses ? vk::PipelineStageFlagBits2::eNone : SrcStages,
+                                    crosses ? vk::AccessFlagBits2::eNone : SrcAccess,
+                                    DstStages,
+                                    DstAccess,
+                                    oldLayout,
+                                    newLayout,
+                                    crosses ? SrcFamily : vk::QueueFamilyIgnored,
+                                    crosses ? DstFamily : vk::QueueFamilyIgnored,
+                                    image,
+                                    range};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, barrier});
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "QueueFamilyIndices.h"
+
+namespace vkstart
+{
+
+enum class QueueType
+{
+    Graphics,
+    Compute,
+    Transfer,
+};
+
+// A point on another queue's timeline that a submission waits for, before `Stages`.
+struct QueueWait
+{
+    QueueType Queue;
+    uint64_t Value;
+    vk::PipelineStageFlags2 Stages;
+};
+
+// The graphics queue, and an async-compute and a transfer queue where the device has
+// families dedicated to them. Without those, compute and transfers go to the graphics queue.
+// Every queue has a timeline semaphore that each of its submissions signals with the next
+// value, so that submissions to other queues, or the host, can wait for it.
+struct DeviceQueues
+{
+    // One per distinct family, including the present family; for creating the device.
+    static std::vector<vk::DeviceQueueCreateInfo> CreateInfos(const QueueFamilyIndices &indices);
+
+    DeviceQueues(const vk::raii::Device &device, const QueueFamilyIndices &indices);
+
+    uint32_t FamilyIndex(QueueType queue) const;
+    const vk::raii::Queue &Queue(QueueType queue) const;
+
+    // false if `queue` is the graphics queue under another name
+    bool IsDedicated(QueueType queue) const;
+
+    // Returns the value the queue's timeline gets signaled with once the command buffers
+    // are done. Waits on the same queue are dropped, submission order takes care of those.
+    uint64_t Submit(QueueType queue, std::span<const vk::CommandBuffer> commandBuffers,
+                    std::span<const QueueWait> waits = {},
+                    std::span<const vk::SemaphoreSubmitInfo> semaphoreWaits = {},
+                    std::span<const vk::SemaphoreSubmitInfo> semaphoreSignals = {},
+                    vk::Fence fence = {});
+
+    // Blocks until `queue` has completed the submission that returned `value`.
+    void Wait(QueueType queue, uint64_t value) const;
+
+  private:
+    struct QueueState
+    {
+        uint32_t Family;
+        vk::raii::Queue Queue = nullptr;
+        vk::raii::Semaphore Timeline = nullptr;
+        uint64_t LastValue = 0;
+    };
+
+    QueueState &State(QueueType queue);
+    const QueueState &State(QueueType queue) const;
+
+    const vk::raii::Device &m_device;
+
+    // one per distinct queue
+    std::vector<QueueState> m_states;
+    // per QueueType, into m_states
+    std::array<size_t, 3> m_stateIndices{};
+};
+
+// Hands an exclusive resource from one queue family to another: `Release` gets recorded
+// on the queue giving it up, `Acquire` on the one taking it over, which must wait for the
+// release's submission. Within one family, `Release` records nothing and `Acquire` a
+// plain barrier, so callers needn't tell the two cases apart.
+struct OwnershipTransfer
+{
+    uint32_t SrcFamily;
+    uint32_t DstFamily;
+    vk::PipelineStageFlags2 SrcStages;
+    vk::AccessFlags2 SrcAccess;
+    vk::PipelineStageFlags2 DstStages;
+    vk::AccessFlags2 DstAccess;
+
+    bool CrossesFamilies() const;
+
+    void Release(const vk::raii::CommandBuffer &commandBuffer, vk::Buffer buffer) const;
+    void Acquire(const vk::raii::CommandBuffer &commandBuffer, vk::Buffer buffer) const;
+
+    // The layout transition is part of the transfer, both halves take the same layouts.
+    void Release(const vk::raii::CommandBuffer &commandBuffer, vk::Image image,
+                 const vk::ImageSubresourceRange &range, vk::ImageLayout oldLayout,
+                 vk::ImageLayout newLayout) const;
+    void Acquire(const vk::raii::CommandBuffer &commandBuffer, vk::Image image,
+                 const vk::ImageSubresourceRange &range, vk::ImageLayout oldLayout,
+                 vk::ImageLayout newLayout) const;
+};
+
+} // namespace vkstart
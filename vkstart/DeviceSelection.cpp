@@ -0,0 +1,158 @@
+#include "DeviceSelection.h"
+
+namespace vkstart
+{
+
+// Any discrete GPU outranks any integrated one, whatever else they have.
+static int64_t TypeScore(vk::PhysicalDeviceType type)
+{
+    switch (type)
+    {
+    case vk::PhysicalDeviceType::eDiscreteGpu:
+        return 10000;
+    case vk::PhysicalDeviceType::eIntegratedGpu:
+        return 2000;
+    case vk::PhysicalDeviceType::eVirtualGpu:
+        return 1000;
+    case vk::PhysicalDeviceType::eCpu:
+        return 100;
+    default:
+        return 0;
+    }
+}
+
+// Points per GiB of the largest device local heap.
+constexpr int64_t HeapGibScore = 100;
+constexpr int64_t DedicatedComputeScore = 200;
+constexpr int64_t DedicatedTransferScore = 100;
+constexpr int64_t OptionalExtensionScore = 150;
+
+DeviceRating RatePhysicalDevice(const vk::raii::PhysicalDevice &physicalDevice,
+                                const vk::raii::SurfaceKHR &surface,
+                                const std::unordered_set<std::string> &requiredExtensions,
+                                const std::unordered_set<std::string> &optionalExtensions)
+{
+    DeviceRating rating{};
+    const auto reject = [&rating](std::string reason) {
+        rating.Suitable = false;
+        rating.Reasons.push_back(std::move(reason));
+    };
+    const auto add = [&rating](int64_t score, std::string reason) {
+        rating.Score += score;
+        rating.Reasons.push_back(std::move(reason) + " +" + std::to_string(score));
+    };
+
+    const vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+    if (properties.apiVersion < VK_API_VERSION_1_3)
+    {
+        reject("Vulkan " + std::to_string(VK_API_VERSION_MAJOR(properties.apiVersion)) + "." +
+               std::to_string(VK_API_VERSION_MINOR(properties.apiVersion)) +
+               ", 1.3 is required");
+    }
+
+    const QueueFamilyIndices queueFamilies{physicalDevice, surface};
+    if (!queueFamilies.IsComplete())
+    {
+        reject("no graphics queue, or none that can present");
+    }
+
+    std::unordered_set<std::string> available{};
+    for (const vk::ExtensionProperties &extension :
+         physicalDevice.enumerateDeviceExtensionProperties())
+    {
+        available.insert(extension.extensionName);
+    }
+    for (const std::string &extension : requiredExtensions)
+    {
+        if (!available.contains(extension))
+        {
+            reject("missing " + extension);
+        }
+    }
+
+    if (!rating.Suitable)
+    {
+        return rating;
+    }
+
+    add(TypeScore(properties.deviceType), vk::to_string(properties.deviceType));
+
+    vk::DeviceSize largestHeap = 0;
+    const vk::PhysicalDeviceMemoryProperties memoryProperties =
+        physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+    {
+        const vk::MemoryHeap &heap = memoryProperties.memoryHeaps[i];
+        if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+        {
+            largestHeap = std::max(largestHeap, heap.size);
+        }
+    }
+    const vk::DeviceSize heapMib = largestHeap >> 20;
+    add(static_cast<int64_t>(heapMib) * HeapGibScore / 1024,
+        std::to_string(heapMib) + " MiB device local");
+
+    if (queueFamilies.HasDedicatedCompute())
+    {
+        add(DedicatedComputeScore, "dedicated compute queue");
+    }
+    if (queueFamilies.HasDedicatedTransfer())
+    {
+        add(DedicatedTransferScore, "dedicated transfer queue");
+    }
+
+    // sorted, so that the log reads the same every time
+    std::vector<std::string> optional{optionalExtensions.begin(), optionalExtensions.end()};
+    std::ranges::sort(optional);
+    for (const std::string &extension : optional)
+    {
+        if (available.contains(extension))
+        {
+            add(OptionalExtensionScore, extension);
+        }
+    }
+
+    return rating;
+}
+
+std::string DeviceUuid(const vk::raii::PhysicalDevice &physicalDevice)
+{
+    const auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                                                          vk::PhysicalDeviceIDProperties>();
+    const vk::PhysicalDeviceIDProperties &id = properties.get<vk::PhysicalDeviceIDProperties>();
+
+    constexpr const char *HexDigits = "0123456789abcdef";
+    std::string uuid{};
+    for (uint8_t byte : id.deviceUUID)
+    {
+        uuid += HexDigits[byte >> 4];
+        uuid += HexDigits[byte & 0xf];
+    }
+
+    return uuid;
+}
+
+bool MatchesDeviceSelection(const vk::raii::PhysicalDevice &physicalDevice, uint32_t index,
+                            std::string_view selection)
+{
+    const bool isIndex = !selection.empty() && std::ranges::all_of(selection, [](char c) {
+        return std::isdigit(static_cast<unsigned char>(c));
+    });
+    if (isIndex)
+    {
+        return std::to_string(index) == selection;
+    }
+
+    std::string uuid{};
+    for (char c : selection)
+    {
+        if (c != '-')
+        {
+            uuid += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+
+    return uuid == DeviceUuid(physicalDevice);
+}
+
+} // namespace vkstart
\ No newline at end of file
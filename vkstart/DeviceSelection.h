@@ -0,0 +1,39 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "QueueFamilyIndices.h"
+
+namespace vkstart
+{
+
+// Environment variable that picks the physical device, over `EngineSettings::PhysicalDevice`.
+constexpr const char *PhysicalDeviceVariable = "VKSTART_PHYSICAL_DEVICE";
+
+// How well a physical device suits the engine, and why.
+struct DeviceRating
+{
+    bool Suitable = true;
+    int64_t Score = 0;
+
+    // One entry per criterion that rejected the device or added to its score.
+    std::vector<std::string> Reasons;
+};
+
+// Rejects devices without Vulkan 1.3, graphics and present queues or `requiredExtensions`.
+// Ranks the others by type, then size of the largest device local heap, queue families
+// dedicated to compute or transfers, and `optionalExtensions`.
+DeviceRating RatePhysicalDevice(const vk::raii::PhysicalDevice &physicalDevice,
+                                const vk::raii::SurfaceKHR &surface,
+                                const std::unordered_set<std::string> &requiredExtensions,
+                                const std::unordered_set<std::string> &optionalExtensions);
+
+// The device's UUID as 32 lowercase hex digits.
+std::string DeviceUuid(const vk::raii::PhysicalDevice &physicalDevice);
+
+// `selection` is the device's index in enumeration order, or its UUID, in hex,
+// with or without dashes.
+bool MatchesDeviceSelection(const vk::raii::PhysicalDevice &physicalDevice, uint32_t index,
+                            std::string_view selection);
+
+} // namespace vkstart
@@ -1,14 +1,14 @@
 #include "Engine.h"
 
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
 #include "ValidationLayers.h"
 #include "Vertex.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-
 namespace vkstart
 {
 
@@ -17,68 +17,265 @@ struct UniformBufferObject
     glm::mat4 model;
     glm::mat4 view;
     glm::mat4 proj;
+    // see ShadowCascades
+    std::array<glm::mat4, ShadowCascadeCount> shadowTransforms;
+    glm::vec4 shadowSplits;
+    // see ClusterLookup
+    glm::vec4 clusterLookup;
+    float triangleArea;
 };
 
-const std::vector<Vertex> Vertices = {{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-                                      {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-                                      {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-                                      {{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
+// See upscale.slang.
+struct UpscaleConstants
+{
+    glm::vec2 UvScale;
+    glm::vec2 TexelSize;
+};
 
-                                      {{-0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-                                      {{0.5f, -0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-                                      {{0.5f, 0.5f, -0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-                                      {{-0.5f, 0.5f, -0.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}};
+constexpr uint32_t MaxFramesInFlight = 2;
 
-const std::vector<uint16_t> Indices = {0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4};
+constexpr float NearPlane = 0.1f;
+constexpr float FarPlane = 10.0f;
 
-constexpr uint32_t MaxFramesInFlight = 2;
+// The coarsest LOD whose error projects to at most this many pixels gets drawn.
+constexpr float LodPixelError = 1.0f;
 
 const std::unordered_set<std::string> RequiredDeviceExtensions{
     vk::KHRSwapchainExtensionName, vk::KHRSpirv14ExtensionName,
     vk::KHRSynchronization2ExtensionName, vk::KHRCreateRenderpass2ExtensionName};
 
-Engine::Engine(PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr, IWindow *window)
-
-    : m_context{vkGetInstanceProcAddr}, m_window{window}
+// Enabled when the physical device has them, see `m_optionalDeviceExtensions`.
+const std::unordered_set<std::string> OptionalDeviceExtensions{vk::EXTMeshShaderExtensionName,
+                                                                vk::EXTMemoryBudgetExtensionName};
+
+// Upper limit for the texture manager, which may settle for less if the device is short on memory.
+constexpr vk::DeviceSize TextureBudget = 512ull * 1024 * 1024;
+
+// The specialization constants of shader.slang, and their ids. The vertex color strength
+// only exists in the variants with MaterialFeatures::VertexColor.
+constexpr uint32_t VertexColorStrengthId = 0;
+constexpr float VertexColorStrength = 1.0f;
+constexpr uint32_t DebugViewId = 1;
+
+// Adds up the fragments of the overdraw view, without testing their depth.
+constexpr vk::PipelineColorBlendAttachmentState OverdrawBlendAttachment{
+    vk::True,
+    vk::BlendFactor::eOne,
+    vk::BlendFactor::eOne,
+    vk::BlendOp::eAdd,
+    vk::BlendFactor::eOne,
+    vk::BlendFactor::eZero,
+    vk::BlendOp::eAdd,
+    vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
+
+#ifdef VKSTART_SHADER_HOT_RELOAD
+// All the shaders the build compiles, of which the engine watches the ones it loaded.
+const std::vector<WatchedShader> BuildShaders{
+#include "WatchedShaders.inc"
+};
+#endif
+
+// What the frame's attachments are used for, which picks their load and store ops, and
+// lets the ones that never leave the rendering live in lazily allocated memory.
+// the swapchain image, or the scene color image when the scene gets upscaled
+constexpr AttachmentUsage SceneColorUsage{.Cleared = true, .UsedAfterPass = true};
+// resolved into the swapchain image as the rendering ends, which doesn't count as a use after
+constexpr AttachmentUsage MultisampledColorUsage{.Cleared = true};
+constexpr AttachmentUsage DepthUsage{.Cleared = true};
+
+// Timestamps each frame writes, see `m_gpuTimestamps`.
+constexpr uint32_t FrameBeginTimestamp = 0;
+constexpr uint32_t FrameEndTimestamp = 1;
+// around the scene's rendering, with the depth pre-pass, if any
+constexpr uint32_t SceneBeginTimestamp = 2;
+constexpr uint32_t SceneEndTimestamp = 3;
+constexpr uint32_t TimestampsPerFrame = 4;
+
+// Frames in flight, plus room for captures that are still being encoded.
+constexpr uint32_t CaptureBufferCount = MaxFramesInFlight + 2;
+
+// The specialization constants of upscale.slang, and their ids.
+constexpr uint32_t EdgeAwareUpscaleId = 0;
+
+// The specialization constants of post.slang, and their ids.
+constexpr uint32_t EncodeSrgbId = 0;
+
+// Texels along each side of the color LUT when there is no .cube file to grade with.
+constexpr uint32_t IdentityLutSize = 16;
+
+// Direction the sunlight travels in, which is what casts the shadows.
+const glm::vec3 SunDirection = glm::normalize(glm::vec3{-0.4f, -0.3f, -1.0f});
+
+// Texels along each side of a shadow cascade's square in the atlas.
+constexpr uint32_t ShadowMapResolution = 1024;
+// Shadows reach as far as the view does.
+constexpr float ShadowDistance = FarPlane;
+// How far from the world origin, along the sunlight, casters can be; fixed rather than
+// fitted to the view, so that the cached shadows don't depend on it.
+constexpr float ShadowDepthReach = 2.0f * FarPlane;
+
+// Against shadow acne, in units of the smallest depth difference, and per unit of the
+// caster's depth slope.
+constexpr float ShadowDepthBiasConstant = 1.25f;
+constexpr float ShadowDepthBiasSlope = 1.75f;
+
+// Storage buffers in the meshlet descriptor set, for either geometry path.
+constexpr uint32_t MaxMeshletStorageBuffers = 4;
+// The lights and the clusters, in the frame's descriptor set and in the binning's.
+constexpr uint32_t ClusterStorageBuffers = 3;
+
+Engine::Engine(PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr, IWindow *window,
+               const EngineSettings &settings)
+
+    : m_context{vkGetInstanceProcAddr}, m_window{window}, m_settings{settings},
+      m_material{BuiltinSceneMaterial(settings.Scene)},
+      m_modelShader{ShaderVariantName("shader.slang", m_material)}, m_assets{sdl::GetBasePath()},
+      m_resolutionScaler{settings.RenderScale, settings.DynamicResolution,
+                         settings.TargetFrameTime},
+      m_depthPrepass{settings.DepthPrepass}, m_debugView{settings.Debug}
 {
-    CreateInstance();
-    SetupDebugMessenger();
-
-    m_surface = window->CreateSurface(m_instance);
+    StartupTimer timer{};
 
-    PickPhysicalDevice();
-    CreateDevice();
-
-    m_graphicsQueue = vk::raii::Queue{m_device, m_queueFamilyIndices.GraphicsIndex(), 0};
-    m_presentQueue = vk::raii::Queue{m_device, m_queueFamilyIndices.PresentIndex(), 0};
+    // nothing of this needs the device, so it gets done while the device gets created
+    StartupAssets assets{};
+    JobCounter loading{};
+    try
+    {
+        LoadStartupAssets(timer, assets, loading);
+
+        timer.Measure("instance", [this, window]() {
+            CreateInstance();
+            SetupDebugMessenger();
+            m_surface = window->CreateSurface(m_instance);
+        });
+
+        timer.Measure("device", [this]() {
+            PickPhysicalDevice();
+            CreateDevice();
+            m_sampleCount = ChooseSampleCount(m_settings.SampleCount);
+            m_gpuTimestamps = std::make_unique<GpuTimestamps>(
+                m_physicalDevice, m_device, m_queueFamilyIndices.GraphicsIndex(),
+                MaxFramesInFlight, TimestampsPerFrame);
+            m_depthPrepassUsed.assign(MaxFramesInFlight, 0);
+
+            m_queues = std::make_unique<DeviceQueues>(m_device, m_queueFamilyIndices);
+            m_presentQueue = vk::raii::Queue{m_device, m_queueFamilyIndices.PresentIndex(), 0};
+        });
+
+        timer.Measure("swapchain", [this]() {
+            CreateSwapChain();
+            CreateImageViews();
+        });
+
+        timer.Measure("waiting for assets", [this, &loading]() { m_jobs.Wait(loading); });
+    }
+    catch (...)
+    {
+        // the jobs write into `assets`
+        m_jobs.Wait(loading);
+        throw;
+    }
 
-    CreateSwapChain();
+    for (const std::exception_ptr &error : assets.Errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
 
-    CreateImageViews();
-    CreateDescriptorSetLayout();
-    CreateGraphicsPipeline();
-    CreateCommandPool();
-    CreateDepthResources();
-    CreateTextureImage();
-    CreateTextureImageView();
-    CreateTextureSampler();
-    CreateVertexBuffer();
-    CreateIndexBuffer();
-    CreateUniformBuffers();
-    CreateDescriptorPool();
-    CreateDescriptorSets();
-    CreateCommandBuffer();
-    CreateSyncObjects();
+    timer.Measure("pipelines", [this, &assets]() {
+        m_shaderCode = std::move(assets.Shaders);
+        CreateDescriptorSetLayout();
+        CreateMeshletLayouts();
+        CreateUpscaleLayout();
+        CreatePostLayout();
+        CreateShadowLayout();
+        CreateClusterLayout();
+        m_pipelines = CreatePipelines(m_shaderCode);
+#ifdef VKSTART_SHADER_HOT_RELOAD
+        std::vector<WatchedShader> watched = BuildShaders;
+        std::erase_if(watched, [this](const WatchedShader &shader) {
+            return !m_shaderCode.contains(shader.Name);
+        });
+        m_shaderWatcher = std::make_unique<ShaderWatcher>(VKSTART_SHADER_SOURCE_DIR,
+                                                          VKSTART_SLANGC, std::move(watched));
+#endif
+    });
+
+    timer.Measure("attachments", [this, &assets]() {
+        CreateCommandPool();
+        CreateColorResources();
+        CreateSceneColorResources();
+        CreateDepthResources();
+        CreatePostProcessing(assets.Lut);
+        CreateShadowMaps();
+    });
+
+    timer.Measure("texture", [this, &assets]() {
+        CreateTextureImage(assets.TextureWidth, assets.TextureHeight,
+                           assets.TexturePixels.data());
+        CreateTextureSampler();
+        CreateUpscaleSampler();
+    });
+
+    timer.Measure("geometry", [this, &assets]() {
+        LoadMesh(std::move(assets.SceneMesh));
+        CreateScene();
+        CreateVertexBuffer();
+        CreateIndexBuffer();
+        CreatePositionBuffer();
+        CreateMeshletBuffers();
+        CreateUniformBuffers();
+        CreateLightClusters();
+    });
+
+    timer.Measure("descriptors", [this]() {
+        CreateDescriptorPool();
+        CreateDescriptorSets();
+        CreateMeshletDescriptorSets();
+        CreateUpscaleDescriptorSet();
+        CreateClusterDescriptorSets();
+    });
+
+    timer.Measure("commands", [this]() {
+        CreateCommandBuffer();
+        CreateSyncObjects();
+        m_frameCapture = std::make_unique<FrameCapture>(m_physicalDevice, m_device, m_jobs,
+                                                        CaptureBufferCount);
+    });
+
+    timer.Report();
 }
 
 void Engine::DrawFrame()
 {
+    // the scene only lives on the CPU, so it can be updated while the GPU is still busy
+    JobCounter sceneUpdate{};
+    m_jobs.Submit([this]() { UpdateScene(); }, sceneUpdate);
+
     while (vk::Result::eTimeout == m_device.waitForFences({m_inFlightFences[m_currentFrame]},
                                                           vk::True,
                                                           std::numeric_limits<uint64_t>::max()))
     {
     }
 
+    m_jobs.Wait(sceneUpdate);
+
+    ReleaseCompletedFrames();
+    m_frameCapture->Complete(m_currentFrame);
+    if (m_postProcessing)
+    {
+        // the fence covers the post-processing too, see SubmitFrame
+        m_postProcessing->ReadTimings(m_currentFrame);
+    }
+    ReloadShaders();
+    // the frame that last used these queries has just been waited for
+    m_gpuTimestamps->Read(m_currentFrame);
+    UpdateDepthPrepass();
+    UpdateRenderResolution();
+
     const vk::Semaphore waitSemaphore = m_presentCompleteSemaphores[m_currentImage];
 
     auto [result, imageIndex] =
@@ -99,16 +296,27 @@ void Engine::DrawFrame()
     m_device.resetFences({m_inFlightFences[m_currentFrame]});
 
     m_commandBuffers[m_currentFrame].reset();
+    if (!m_computeCommandBuffers.empty())
+    {
+        m_computeCommandBuffers[m_currentFrame].reset();
+    }
+    if (!m_transferCommandBuffers.empty())
+    {
+        m_transferCommandBuffers[m_currentFrame].reset();
+    }
+    if (!m_postCommandBuffers.empty())
+    {
+        m_postCommandBuffers[m_currentFrame].reset();
+    }
+    if (!m_compositeCommandBuffers.empty())
+    {
+        m_compositeCommandBuffers[m_currentFrame].reset();
+    }
 
     RecordCommandBuffer(imageIndex);
 
-    const vk::PipelineStageFlags waitDestinationStageMask{
-        vk::PipelineStageFlagBits::eColorAttachmentOutput};
-    const vk::CommandBuffer commandBuffer = m_commandBuffers[m_currentFrame];
     const vk::Semaphore signalSemaphore = m_renderFinishedSemaphores[m_currentImage];
-    const vk::SubmitInfo submitInfo{waitSemaphore, waitDestinationStageMask, commandBuffer,
-                                    signalSemaphore};
-    m_graphicsQueue.submit(submitInfo, m_inFlightFences[m_currentFrame]);
+    SubmitFrame(waitSemaphore, signalSemaphore);
 
     const vk::Semaphore waitSemaphore2 = signalSemaphore;
     const vk::PresentInfoKHR presentInfoKHR{waitSemaphore2, *m_swapchain, imageIndex};
@@ -127,6 +335,7 @@ void Engine::DrawFrame()
 
     m_currentFrame = (m_currentFrame + 1) % MaxFramesInFlight;
     m_currentImage = (m_currentImage + 1) % m_swapchainImages.size();
+    ++m_frameNumber;
 }
 
 void Engine::PixelSizeChanged()
@@ -134,9 +343,101 @@ void Engine::PixelSizeChanged()
     m_pixelSizeChanged = true;
 }
 
+void Engine::SetRenderScale(float scale)
+{
+    m_resolutionScaler.SetScale(scale);
+}
+
+void Engine::SetDynamicResolution(bool dynamic)
+{
+    m_resolutionScaler.SetDynamic(dynamic);
+}
+
+void Engine::SetDepthPrepass(DepthPrepassMode mode)
+{
+    m_depthPrepass.SetMode(mode);
+}
+
+void Engine::SetDebugView(DebugView view)
+{
+    m_debugView = view;
+}
+
+void Engine::UpdateRenderResolution()
+{
+    const std::optional<double> gpuFrameTime =
+        m_gpuTimestamps->Elapsed(m_currentFrame, FrameBeginTimestamp, FrameEndTimestamp);
+    if (gpuFrameTime)
+    {
+        m_resolutionScaler.Update(*gpuFrameTime);
+    }
+
+    m_renderExtent = m_resolutionScaler.RenderExtent(m_swapchainExtent);
+}
+
+bool Engine::HasDepthPrepass() const
+{
+    // The pre-pass is drawn by DepthMain, and the scene by MeshMain would have to come out
+    // with the same depths. Only positions decorated Invariant are guaranteed to across
+    // shader stages, which the shaders can't declare.
+    return m_geometryPath != GeometryPath::MeshShader;
+}
+
+void Engine::UpdateDepthPrepass()
+{
+    // the debug views cost differently, and never have the pre-pass
+    if (!HasDepthPrepass() || m_debugView != DebugView::None)
+    {
+        return;
+    }
+
+    const std::optional<double> sceneTime =
+        m_gpuTimestamps->Elapsed(m_currentFrame, SceneBeginTimestamp, SceneEndTimestamp);
+    if (!sceneTime)
+    {
+        return;
+    }
+
+    // per pixel, as dynamic resolution changes how many there are; those of the latest
+    // frame are close enough
+    const double pixelCount = static_cast<double>(m_renderExtent.width) * m_renderExtent.height;
+    m_depthPrepass.Update(m_depthPrepassUsed[m_currentFrame] != 0, *sceneTime / pixelCount);
+}
+
+void Engine::CaptureFrame(const std::filesystem::path &path, CaptureFormat format)
+{
+    if (!m_swapchainCapturable)
+    {
+        throw std::runtime_error{"swapchain images can't be captured"};
+    }
+    m_frameCapture->Request(path, format);
+}
+
+void Engine::CaptureFrame(CaptureCallback callback)
+{
+    if (!m_swapchainCapturable)
+    {
+        throw std::runtime_error{"swapchain images can't be captured"};
+    }
+    m_frameCapture->Request(std::move(callback));
+}
+
+std::optional<double> Engine::PostEffectTime(PostEffect effect) const
+{
+    return m_postProcessing ? m_postProcessing->EffectTime(effect) : std::nullopt;
+}
+
 void Engine::WaitIdle()
 {
+    m_jobs.Wait(m_pipelineRebuild);
     m_device.waitIdle();
+    m_deletionQueue.ReleaseAll();
+
+    for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame)
+    {
+        m_frameCapture->Complete(frame);
+    }
+    m_frameCapture->Wait();
 }
 
 void Engine::CreateInstance()
@@ -198,51 +499,77 @@ void Engine::SetupDebugMessenger()
 
 void Engine::PickPhysicalDevice()
 {
+    const char *variable = SDL_getenv(PhysicalDeviceVariable);
+    const std::string selection = variable ? variable : m_settings.PhysicalDevice;
+
     auto devices = m_instance.enumeratePhysicalDevices();
-    for (const vk::raii::PhysicalDevice &physicalDevice : devices)
+    std::optional<uint32_t> picked{};
+    int64_t pickedScore = 0;
+    for (uint32_t i = 0; i < devices.size(); ++i)
     {
-        if (physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_3)
-        {
-            continue;
-        }
+        const vk::raii::PhysicalDevice &physicalDevice = devices[i];
+        const DeviceRating rating = RatePhysicalDevice(physicalDevice, m_surface,
+                                                       RequiredDeviceExtensions,
+                                                       OptionalDeviceExtensions);
 
-        QueueFamilyIndices familiyIndices{physicalDevice, m_surface};
-        if (!familiyIndices.IsComplete())
+        std::string reasons{};
+        for (const std::string &reason : rating.Reasons)
         {
-            continue;
+            reasons += (reasons.empty() ? "" : ", ") + reason;
         }
-
-        std::unordered_set<std::string> foundExtensions{};
-        auto extensions = physicalDevice.enumerateDeviceExtensionProperties();
-        for (const vk::ExtensionProperties &extension : extensions)
+        const std::string name = physicalDevice.getProperties().deviceName;
+        const bool selected =
+            !selection.empty() && MatchesDeviceSelection(physicalDevice, i, selection);
+        if (!rating.Suitable)
         {
-            if (RequiredDeviceExtensions.contains(extension.extensionName))
+            SDL_Log("device %u %s (%s): rejected, %s", i, name.c_str(),
+                    DeviceUuid(physicalDevice).c_str(), reasons.c_str());
+            if (selected)
             {
-                foundExtensions.insert(extension.extensionName);
+                throw std::runtime_error{"the selected physical device " + selection +
+                                         " isn't suitable: " + reasons};
             }
+            continue;
         }
-        if (foundExtensions == RequiredDeviceExtensions)
-        {
-            m_physicalDevice = physicalDevice;
-            m_queueFamilyIndices = familiyIndices;
 
-            return;
+        SDL_Log("device %u %s (%s): score %lld, %s", i, name.c_str(),
+                DeviceUuid(physicalDevice).c_str(), static_cast<long long>(rating.Score),
+                reasons.c_str());
+
+        // a selection wins over any score
+        if (selected || (selection.empty() && (!picked || rating.Score > pickedScore)))
+        {
+            picked = i;
+            pickedScore = rating.Score;
         }
     }
 
-    throw std::runtime_error{"no suitable physical device found"};
+    if (!picked)
+    {
+        throw std::runtime_error{selection.empty()
+                                     ? "no suitable physical device found"
+                                     : "no physical device matches " + selection};
+    }
+
+    m_physicalDevice = devices[*picked];
+    m_queueFamilyIndices = QueueFamilyIndices{m_physicalDevice, m_surface};
+    SDL_Log("using device %u %s%s", *picked, m_physicalDevice.getProperties().deviceName.data(),
+            selection.empty() ? ", the best rated" : ", as selected");
 }
 
 void Engine::CreateDevice()
 {
-    const uint32_t graphicsIndex = m_queueFamilyIndices.GraphicsIndex();
-    const std::array<float, 1> priorities{0.0f};
-    vk::DeviceQueueCreateInfo queueCreateInfo{{}, graphicsIndex, priorities};
+    const std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos =
+        DeviceQueues::CreateInfos(m_queueFamilyIndices);
 
     // query for Vulkan 1.3 features
     vk::PhysicalDeviceFeatures2 features2 = m_physicalDevice.getFeatures2();
     features2.features.samplerAnisotropy = vk::True;
 
+    // DeviceQueues synchronizes the queues with timeline semaphores
+    vk::PhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.timelineSemaphore = vk::True;
+
     vk::PhysicalDeviceVulkan13Features vulkan13Features{};
     vulkan13Features.dynamicRendering = vk::True;
     vulkan13Features.synchronization2 = vk::True;
@@ -255,15 +582,62 @@ void Engine::CreateDevice()
     {
         deviceExtensions.push_back(extension.c_str());
     }
-    vk::DeviceCreateInfo deviceCreateInfo{{}, queueCreateInfo, {}, deviceExtensions};
+
+    m_optionalDeviceExtensions.clear();
+    for (const vk::ExtensionProperties &extension :
+         m_physicalDevice.enumerateDeviceExtensionProperties())
+    {
+        const auto optionalExtension = OptionalDeviceExtensions.find(extension.extensionName);
+        if (optionalExtension != OptionalDeviceExtensions.end())
+        {
+            m_optionalDeviceExtensions.insert(*optionalExtension);
+            deviceExtensions.push_back(optionalExtension->c_str());
+        }
+    }
+
+    const bool hasMeshShaderExtension =
+        m_optionalDeviceExtensions.contains(vk::EXTMeshShaderExtensionName);
+
+    vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+    if (hasMeshShaderExtension)
+    {
+        auto supportedFeatures = m_physicalDevice.getFeatures2<
+            vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+        const auto &supportedMeshShaderFeatures =
+            supportedFeatures.get<vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+        meshShaderFeatures.taskShader = supportedMeshShaderFeatures.taskShader;
+        meshShaderFeatures.meshShader = supportedMeshShaderFeatures.meshShader;
+    }
+
+    vk::DeviceCreateInfo deviceCreateInfo{{}, queueCreateInfos, {}, deviceExtensions};
 
     vk::StructureChain<vk::DeviceCreateInfo, vk::PhysicalDeviceFeatures2,
-                       vk::PhysicalDeviceVulkan13Features,
-                       vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>
-        createInfos{deviceCreateInfo, features2, vulkan13Features, extendedDynamicStateFeatures};
+                       vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features,
+                       vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT,
+                       vk::PhysicalDeviceMeshShaderFeaturesEXT>
+        createInfos{deviceCreateInfo, features2, vulkan12Features, vulkan13Features,
+                    extendedDynamicStateFeatures, meshShaderFeatures};
+    if (!hasMeshShaderExtension)
+    {
+        createInfos.unlink<vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+    }
     vk::DeviceCreateInfo deviceCreateInfoChained = createInfos.get<vk::DeviceCreateInfo>();
 
     m_device = vk::raii::Device{m_physicalDevice, deviceCreateInfoChained};
+
+    // multiDrawIndirect is already enabled by features2 if the device has it
+    if (meshShaderFeatures.taskShader && meshShaderFeatures.meshShader)
+    {
+        m_geometryPath = GeometryPath::MeshShader;
+    }
+    else if (features2.features.multiDrawIndirect)
+    {
+        m_geometryPath = GeometryPath::CulledIndirect;
+    }
+    else
+    {
+        m_geometryPath = GeometryPath::Vertex;
+    }
 }
 
 static vk::SurfaceFormatKHR ChooseSwapSurfaceFormat(
@@ -281,6 +655,34 @@ static vk::SurfaceFormatKHR ChooseSwapSurfaceFormat(
     return availableFormats[0];
 }
 
+// Storing to an sRGB format isn't allowed, so the post-processing writes to a UNORM format,
+// and encodes sRGB itself.
+static std::optional<vk::SurfaceFormatKHR> ChooseStorageSurfaceFormat(
+    const vk::raii::PhysicalDevice &physicalDevice,
+    const std::vector<vk::SurfaceFormatKHR> &availableFormats)
+{
+    for (const auto &availableFormat : availableFormats)
+    {
+        const bool unorm = availableFormat.format == vk::Format::eB8G8R8A8Unorm ||
+                           availableFormat.format == vk::Format::eR8G8B8A8Unorm;
+        const vk::FormatFeatureFlags features =
+            physicalDevice.getFormatProperties(availableFormat.format).optimalTilingFeatures;
+        if (unorm && availableFormat.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear &&
+            (features & vk::FormatFeatureFlagBits::eStorageImage))
+        {
+            return availableFormat;
+        }
+    }
+
+    return std::nullopt;
+}
+
+static bool IsSrgb(vk::Format format)
+{
+    return format == vk::Format::eB8G8R8A8Srgb || format == vk::Format::eR8G8B8A8Srgb ||
+           format == vk::Format::eA8B8G8R8SrgbPack32;
+}
+
 static vk::PresentModeKHR ChooseSwapPresentMode(
     const std::vector<vk::PresentModeKHR> &availablePresentModes)
 {
@@ -308,7 +710,7 @@ static vk::Extent2D ChooseSwapExtent(const vk::SurfaceCapabilitiesKHR &capabilit
                                  capabilities.maxImageExtent.height)};
 }
 
-void Engine::CreateSwapChain()
+void Engine::CreateSwapChain(vk::SwapchainKHR oldSwapchain)
 {
     int pixelWidth, pixelHeight;
     m_window->GetPixelDimensions(&pixelWidth, &pixelHeight);
@@ -316,10 +718,36 @@ void Engine::CreateSwapChain()
     vk::SurfaceCapabilitiesKHR surfaceCapabilities =
         m_physicalDevice.getSurfaceCapabilitiesKHR(m_surface);
 
+    const std::vector<vk::SurfaceFormatKHR> surfaceFormats =
+        m_physicalDevice.getSurfaceFormatsKHR(m_surface);
+
+    // post-processing writes the swapchain images where it can, and gets blitted into them
+    // where it can't
+    const bool storage = m_settings.PostProcessing && (surfaceCapabilities.supportedUsageFlags &
+                                                       vk::ImageUsageFlagBits::eStorage);
+    const std::optional<vk::SurfaceFormatKHR> storageFormat =
+        storage ? ChooseStorageSurfaceFormat(m_physicalDevice, surfaceFormats) : std::nullopt;
+    m_postToSwapchain = storageFormat.has_value();
+    vk::ImageUsageFlags postUsage{};
+    if (m_postToSwapchain)
+    {
+        postUsage = vk::ImageUsageFlagBits::eStorage;
+    }
+    else if (m_settings.PostProcessing)
+    {
+        if (!(surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst))
+        {
+            throw std::runtime_error{"swapchain images can't take the post-processing's output"};
+        }
+        postUsage = vk::ImageUsageFlagBits::eTransferDst;
+    }
+
     vk::SurfaceFormatKHR swapChainImageFormat =
-        ChooseSwapSurfaceFormat(m_physicalDevice.getSurfaceFormatsKHR(m_surface));
+        storageFormat ? *storageFormat : ChooseSwapSurfaceFormat(surfaceFormats);
 
     m_swapchainImageFormat = swapChainImageFormat.format;
+    m_sceneColorFormat =
+        m_settings.PostProcessing ? PostProcessing::SceneFormat : swapChainImageFormat.format;
     m_swapchainExtent = ChooseSwapExtent(surfaceCapabilities, pixelWidth, pixelHeight);
 
     uint32_t minImageCount = std::max(3u, surfaceCapabilities.minImageCount);
@@ -334,19 +762,32 @@ void Engine::CreateSwapChain()
         imageCount = surfaceCapabilities.maxImageCount;
     }
 
-    bool separateQueues =
-        m_queueFamilyIndices.GraphicsIndex() != m_queueFamilyIndices.PresentIndex();
+    // with post-processing into them, the swapchain images get written on the compute queue
+    std::vector<uint32_t> queueFamilyIndices{m_queueFamilyIndices.GraphicsIndex(),
+                                             m_queueFamilyIndices.PresentIndex()};
+    if (m_postToSwapchain)
+    {
+        queueFamilyIndices.push_back(m_queues->FamilyIndex(QueueType::Compute));
+    }
+    std::ranges::sort(queueFamilyIndices);
+    queueFamilyIndices.erase(std::ranges::unique(queueFamilyIndices).begin(),
+                             queueFamilyIndices.end());
 
-    std::vector<uint32_t> queueFamilyIndices{};
-    if (separateQueues)
+    bool separateQueues = queueFamilyIndices.size() > 1;
+    if (!separateQueues)
     {
-        queueFamilyIndices = {m_queueFamilyIndices.GraphicsIndex(),
-                              m_queueFamilyIndices.PresentIndex()};
+        queueFamilyIndices.clear();
     }
 
     const uint32_t imageArrayLayers = 1;
     const auto clipped = vk::True;
-    const auto imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+    // copied from for frame capture, where supported
+    const vk::ImageUsageFlags transferSrc =
+        surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc;
+    const vk::ImageUsageFlags imageUsage =
+        vk::ImageUsageFlagBits::eColorAttachment | transferSrc | postUsage;
+    m_swapchainCapturable =
+        transferSrc && FrameCapture::IsFormatSupported(swapChainImageFormat.format);
     const auto imageColorSpace = vk::ColorSpaceKHR::eSrgbNonlinear;
     const vk::PresentModeKHR presentMode =
         ChooseSwapPresentMode(m_physicalDevice.getSurfacePresentModesKHR(m_surface));
@@ -369,27 +810,108 @@ void Engine::CreateSwapChain()
         compositeAlpha,
         presentMode,
         clipped,
+        oldSwapchain,
     };
 
     m_swapchain = vk::raii::SwapchainKHR{m_device, swapChainCreateInfo};
     m_swapchainImages = m_swapchain.getImages();
-}
 
-void Engine::CleanupSwapChain()
-{
-    m_swapchainImageViews.clear();
-    m_swapchain = nullptr;
+    m_renderExtent = m_resolutionScaler.RenderExtent(m_swapchainExtent);
 }
 
 void Engine::ReCreateSwapChain()
 {
-    m_device.waitIdle();
+    // a pipeline rebuild reads the swapchain's extent and formats, which are about to change
+    m_jobs.Wait(m_pipelineRebuild);
+
+    // no waiting for the device, the frames in flight keep using the old resources
+    m_deletionQueue.Retire(std::move(m_swapchainImageViews), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_colorImageView), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_colorImage), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_colorImageMemory), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_upscaleDescriptorSet), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_sceneColorImageView), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_sceneColorImage), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_sceneColorImageMemory), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_depthImageView), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_depthImage), m_frameNumber);
+    m_deletionQueue.Retire(std::move(m_depthImageMemory), m_frameNumber);
+
+    vk::raii::SwapchainKHR oldSwapchain = std::move(m_swapchain);
+    CreateSwapChain(*oldSwapchain);
+    m_deletionQueue.Retire(std::move(oldSwapchain), m_frameNumber);
 
-    CleanupSwapChain();
-
-    CreateSwapChain();
     CreateImageViews();
+    CreateColorResources();
+    CreateSceneColorResources();
     CreateDepthResources();
+    CreateUpscaleDescriptorSet();
+    if (m_postProcessing)
+    {
+        ResizePostProcessing();
+    }
+
+    const vk::SemaphoreCreateInfo semaphoreCreateInfo{};
+    while (m_presentCompleteSemaphores.size() < m_swapchainImages.size())
+    {
+        m_presentCompleteSemaphores.emplace_back(m_device, semaphoreCreateInfo);
+        m_renderFinishedSemaphores.emplace_back(m_device, semaphoreCreateInfo);
+    }
+    m_currentImage %= m_swapchainImages.size();
+}
+
+void Engine::ReleaseCompletedFrames()
+{
+    // the fence just waited for belongs to the frame MaxFramesInFlight before this one,
+    // and so do all the frames before it
+    if (m_frameNumber >= MaxFramesInFlight)
+    {
+        m_deletionQueue.Release(m_frameNumber - MaxFramesInFlight);
+    }
+}
+
+void Engine::ReloadShaders()
+{
+    if (!m_shaderWatcher || m_pipelineRebuild.Pending != 0)
+    {
+        return;
+    }
+
+    // frames still in flight keep using the pipelines they were recorded with
+    if (m_rebuiltPipelines)
+    {
+        m_deletionQueue.Retire(std::move(m_pipelines), m_frameNumber);
+        m_pipelines = std::move(*m_rebuiltPipelines);
+        m_rebuiltPipelines.reset();
+    }
+
+    std::vector<CompiledShader> compiled = m_shaderWatcher->TakeCompiled();
+    if (compiled.empty())
+    {
+        return;
+    }
+
+    // no pipelines are being built, which would still reflect the replaced code
+    for (CompiledShader &shader : compiled)
+    {
+        std::vector<char> &code = m_shaderCode[shader.Name];
+        m_layouts.Evict(code);
+        code = std::move(shader.Code);
+    }
+
+    // layouts stay as they are, so only changes that keep the shaders' interfaces take effect
+    m_jobs.Submit(
+        [this, shaderCode = m_shaderCode]() {
+            try
+            {
+                m_rebuiltPipelines = CreatePipelines(shaderCode);
+            }
+            catch (const std::exception &e)
+            {
+                SDL_Log("failed to rebuild pipelines: %s", e.what());
+            }
+        },
+        m_pipelineRebuild);
 }
 
 void Engine::CreateImageViews()
@@ -419,72 +941,276 @@ void Engine::CreateImageViews()
     }
 }
 
-static std::vector<char> ReadFile(const std::filesystem::path &filename)
+vk::raii::ShaderModule Engine::CreateShaderModule(const std::vector<char> &code) const
+{
+    const auto codeSize = static_cast<const uint32_t>(code.size());
+    const auto *pCode = reinterpret_cast<const uint32_t *>(code.data());
+    vk::ShaderModuleCreateInfo createInfo{{}, codeSize, pCode};
+
+    vk::raii::ShaderModule shaderModule{m_device, createInfo};
+
+    return shaderModule;
+}
+
+void Engine::CreateDescriptorSetLayout()
+{
+    const ShaderReflection &shader = m_layouts.Reflect(m_shaderCode.at(m_modelShader));
+    std::vector<const EntryPointReflection *> entryPoints{&shader.EntryPoint("VertexMain"),
+                                                          &shader.EntryPoint("FragmentMain"),
+                                                          &shader.EntryPoint("DepthMain")};
+
+    // set 0 is shared with the mesh shader pipeline, so it has to be the same layout for both
+    if (m_geometryPath == GeometryPath::MeshShader)
+    {
+        const ShaderReflection &meshlet =
+            m_layouts.Reflect(m_shaderCode.at("shaders/meshlet.slang.spv"));
+        entryPoints.push_back(&meshlet.EntryPoint("TaskMain"));
+        entryPoints.push_back(&meshlet.EntryPoint("MeshMain"));
+    }
+
+    const std::array sets{MergeBindings(entryPoints, 0)};
+    m_descriptorSetLayout = m_layouts.SetLayout(sets[0]);
+    m_pipelineLayout = m_layouts.PipelineLayout(sets, std::nullopt);
+}
+
+void Engine::CreateMeshletLayouts()
 {
-    std::filesystem::path basePath{sdl::GetBasePath()};
-    std::filesystem::path filePath = basePath / filename;
+    std::vector<const EntryPointReflection *> entryPoints{};
+    std::vector<std::vector<ReflectedBinding>> sets{};
 
-    std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+    switch (m_geometryPath)
+    {
+    case GeometryPath::Vertex:
+        return;
+    case GeometryPath::CulledIndirect: {
+        // meshlets, draw commands
+        const ShaderReflection &cull = m_layouts.Reflect(m_shaderCode.at("shaders/cull.slang.spv"));
+        entryPoints.push_back(&cull.EntryPoint("CullMain"));
+        sets.push_back(MergeBindings(entryPoints, 0));
+        break;
+    }
+    case GeometryPath::MeshShader: {
+        // vertices, meshlets, meshlet vertices, meshlet triangles
+        const ShaderReflection &shader =
+            m_layouts.Reflect(m_shaderCode.at(m_modelShader));
+        const ShaderReflection &meshlet =
+            m_layouts.Reflect(m_shaderCode.at("shaders/meshlet.slang.spv"));
+        entryPoints = {&meshlet.EntryPoint("TaskMain"), &meshlet.EntryPoint("MeshMain"),
+                       &shader.EntryPoint("FragmentMain")};
+        // set 0 is shared with the vertex pipeline
+        std::vector<const EntryPointReflection *> setZeroEntryPoints = entryPoints;
+        setZeroEntryPoints.push_back(&shader.EntryPoint("VertexMain"));
+        setZeroEntryPoints.push_back(&shader.EntryPoint("DepthMain"));
+        sets.push_back(MergeBindings(setZeroEntryPoints, 0));
+        sets.push_back(MergeBindings(entryPoints, 1));
+        break;
+    }
+    }
 
-    if (!file.is_open())
+    const std::optional<vk::PushConstantRange> pushConstants = MergePushConstants(entryPoints);
+    if (!pushConstants || pushConstants->size != sizeof(MeshletCullConstants))
     {
-        throw std::runtime_error("failed to open file!");
+        throw std::runtime_error{"meshlet shaders don't take MeshletCullConstants"};
     }
 
-    size_t fileSize = file.tellg();
-    std::vector<char> buffer(fileSize);
+    m_meshletDescriptorSetLayout = m_layouts.SetLayout(sets.back());
+    m_meshletPipelineLayout = m_layouts.PipelineLayout(sets, pushConstants);
+    m_cullConstantStages = pushConstants->stageFlags;
+}
 
-    file.seekg(0, std::ios::beg);
-    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+void Engine::CreateUpscaleLayout()
+{
+    const ShaderReflection &upscale =
+        m_layouts.Reflect(m_shaderCode.at("shaders/upscale.slang.spv"));
+    const std::array entryPoints{&upscale.EntryPoint("VertexMain"),
+                                 &upscale.EntryPoint("FragmentMain")};
 
-    file.close();
+    const std::optional<vk::PushConstantRange> pushConstants = MergePushConstants(entryPoints);
+    if (!pushConstants || pushConstants->size != sizeof(UpscaleConstants))
+    {
+        throw std::runtime_error{"upscale shader doesn't take UpscaleConstants"};
+    }
 
-    return buffer;
+    const std::array sets{MergeBindings(entryPoints, 0)};
+    m_upscaleDescriptorSetLayout = m_layouts.SetLayout(sets[0]);
+    m_upscalePipelineLayout = m_layouts.PipelineLayout(sets, pushConstants);
+    m_upscaleConstantStages = pushConstants->stageFlags;
 }
 
-vk::raii::ShaderModule Engine::CreateShaderModule(const std::vector<char> &code) const
+void Engine::CreatePostLayout()
 {
-    const auto codeSize = static_cast<const uint32_t>(code.size());
-    const auto *pCode = reinterpret_cast<const uint32_t *>(code.data());
-    vk::ShaderModuleCreateInfo createInfo{{}, codeSize, pCode};
+    if (!m_settings.PostProcessing)
+    {
+        return;
+    }
 
-    vk::raii::ShaderModule shaderModule{m_device, createInfo};
+    const ShaderReflection &post = m_layouts.Reflect(m_shaderCode.at("shaders/post.slang.spv"));
+    const std::array entryPoints{&post.EntryPoint("TonemapMain"), &post.EntryPoint("GradeMain"),
+                                 &post.EntryPoint("SharpenMain")};
 
-    return shaderModule;
+    const std::optional<vk::PushConstantRange> pushConstants = MergePushConstants(entryPoints);
+    if (!pushConstants || pushConstants->size != sizeof(PostConstants))
+    {
+        throw std::runtime_error{"post-processing shader doesn't take PostConstants"};
+    }
+
+    const std::array sets{MergeBindings(entryPoints, 0)};
+    m_postDescriptorSetLayout = m_layouts.SetLayout(sets[0]);
+    m_postPipelineLayout = m_layouts.PipelineLayout(sets, pushConstants);
+    m_postConstantStages = pushConstants->stageFlags;
 }
 
-void Engine::CreateDescriptorSetLayout()
+void Engine::CreateShadowLayout()
+{
+    if (!m_settings.Shadows)
+    {
+        return;
+    }
+
+    const ShaderReflection &shadow =
+        m_layouts.Reflect(m_shaderCode.at("shaders/shadow.slang.spv"));
+    const std::array entryPoints{&shadow.EntryPoint("VertexMain")};
+
+    const std::optional<vk::PushConstantRange> pushConstants = MergePushConstants(entryPoints);
+    if (!pushConstants || pushConstants->size != sizeof(glm::mat4))
+    {
+        throw std::runtime_error{"shadow shader doesn't take a transform"};
+    }
+
+    m_shadowPipelineLayout = m_layouts.PipelineLayout({}, pushConstants);
+    m_shadowConstantStages = pushConstants->stageFlags;
+}
+
+void Engine::CreateClusterLayout()
+{
+    // lights, light counts, light indices
+    const ShaderReflection &clusters =
+        m_layouts.Reflect(m_shaderCode.at("shaders/clusters.slang.spv"));
+    const std::array entryPoints{&clusters.EntryPoint("ClusterMain")};
+
+    const std::optional<vk::PushConstantRange> pushConstants = MergePushConstants(entryPoints);
+    if (!pushConstants || pushConstants->size != sizeof(ClusterConstants))
+    {
+        throw std::runtime_error{"light binning shader doesn't take ClusterConstants"};
+    }
+
+    const std::array sets{MergeBindings(entryPoints, 0)};
+    m_clusterDescriptorSetLayout = m_layouts.SetLayout(sets[0]);
+    m_clusterPipelineLayout = m_layouts.PipelineLayout(sets, pushConstants);
+    m_clusterConstantStages = pushConstants->stageFlags;
+}
+
+void Engine::LoadStartupAssets(StartupTimer &timer, StartupAssets &assets, JobCounter &loading)
 {
-    const uint32_t binding = 0;
-    vk::DescriptorSetLayoutBinding uboLayoutBinding{
-        binding, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eVertex, {}};
+    // which of them get used depends on the device, but they are small
+    const std::array shaderNames{m_modelShader, std::string{"shaders/meshlet.slang.spv"},
+                                 std::string{"shaders/cull.slang.spv"},
+                                 std::string{"shaders/upscale.slang.spv"},
+                                 std::string{"shaders/post.slang.spv"},
+                                 std::string{"shaders/shadow.slang.spv"},
+                                 std::string{"shaders/clusters.slang.spv"}};
+    for (const std::string &name : shaderNames)
+    {
+        // inserted up front, so that the jobs don't modify the map
+        std::vector<char> &code = assets.Shaders[name];
+        SubmitStartupJob(
+            timer, assets, name,
+            [this, name, &code]() {
+                code = m_assets.Read(name);
+                // warms the cache for creating the layouts
+                m_layouts.Reflect(code);
+            },
+            loading);
+    }
 
-    // This is weird. The above constructor bases this on the number of vk::Samplers.
-    uboLayoutBinding.descriptorCount = 1;
+    const std::string textureName = BuiltinSceneTexture(m_settings.Scene);
+    SubmitStartupJob(
+        timer, assets, textureName,
+        [this, textureName, &assets]() {
+            const std::vector<char> image = m_assets.Read(textureName);
+
+            int texWidth, texHeight, texChannels;
+            stbi_uc *pixels = stbi_load_from_memory(
+                reinterpret_cast<const stbi_uc *>(image.data()), static_cast<int>(image.size()),
+                &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            if (!pixels)
+            {
+                throw std::runtime_error("failed to load texture image");
+            }
 
-    vk::DescriptorSetLayoutBinding samplerLayoutBinding{binding + 1,
-                                                        vk::DescriptorType::eCombinedImageSampler,
-                                                        vk::ShaderStageFlagBits::eFragment,
-                                                        {}};
-    samplerLayoutBinding.descriptorCount = 1;
+            assets.TextureWidth = static_cast<uint32_t>(texWidth);
+            assets.TextureHeight = static_cast<uint32_t>(texHeight);
+            assets.TexturePixels.assign(pixels,
+                                        pixels + static_cast<size_t>(texWidth) * texHeight * 4);
+            stbi_image_free(pixels);
+        },
+        loading);
+
+    SubmitStartupJob(
+        timer, assets, "scene mesh",
+        [this, &assets]() {
+            Mesh mesh = BuiltinSceneMesh(m_settings.Scene, m_assets);
+            MeshSimplifier::GenerateLods(mesh);
+            MeshOptimizer::Optimize(mesh);
+            mesh.ComputeBounds();
+            assets.SceneMesh = std::move(mesh);
+        },
+        loading);
+
+    SubmitStartupJob(
+        timer, assets, "color LUT",
+        [this, &assets]() {
+            assets.Lut = m_settings.ColorLut.empty()
+                             ? IdentityColorLut(IdentityLutSize)
+                             : ParseCubeLut(m_assets.Read(m_settings.ColorLut));
+        },
+        loading);
+}
 
-    std::array bindings{uboLayoutBinding, samplerLayoutBinding};
-    vk::DescriptorSetLayoutCreateInfo layoutCreateInfo{{}, bindings};
-    m_descriptorSetLayout = vk::raii::DescriptorSetLayout{m_device, layoutCreateInfo};
+void Engine::SubmitStartupJob(StartupTimer &timer, StartupAssets &assets, std::string name,
+                              std::function<void()> job, JobCounter &loading)
+{
+    std::exception_ptr &error = assets.Errors.emplace_back();
+    m_jobs.Submit(
+        [&timer, &error, name = std::move(name), job = std::move(job)]() {
+            try
+            {
+                timer.Measure(name, job);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        },
+        loading);
 }
 
-void Engine::CreateGraphicsPipeline()
+Engine::ShaderPipelines Engine::CreatePipelines(const ShaderCode &shaderCode) const
 {
-    auto shaderCode = ReadFile(std::filesystem::path{"shaders"} / "shader.slang.spv");
-    vk::raii::ShaderModule shaderModule = CreateShaderModule(shaderCode);
+    ShaderPipelines pipelines{};
+
+    // also catches a hot-reloaded shader that no longer matches `Vertex`
+    const std::vector<char> &code = shaderCode.at(m_modelShader);
+    CheckVertexInput(m_layouts.Reflect(code).EntryPoint("VertexMain"),
+                     Vertex::GetAttributeDescriptions());
+    CheckVertexInput(m_layouts.Reflect(code).EntryPoint("DepthMain"),
+                     std::array{Vertex::GetPositionAttributeDescription()});
+
+    vk::raii::ShaderModule shaderModule = CreateShaderModule(code);
 
     const auto vertexStageFlags = vk::ShaderStageFlagBits::eVertex;
     vk::PipelineShaderStageCreateInfo vertexShaderStageCreateInfo{
         {}, vertexStageFlags, shaderModule, "VertexMain"};
 
     const auto fragmentStageFlags = vk::ShaderStageFlagBits::eFragment;
+    // per material, so that the driver can fold the fragment shader's constants
+    SpecializationConstants fragmentConstants{};
+    if (m_material.VertexColor)
+    {
+        fragmentConstants.Set(VertexColorStrengthId, VertexColorStrength);
+    }
     vk::PipelineShaderStageCreateInfo fragmentShaderStageCreateInfo{
-        {}, fragmentStageFlags, shaderModule, "FragmentMain"};
+        {}, fragmentStageFlags, shaderModule, "FragmentMain", fragmentConstants.Info()};
 
     std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStageCreateInfos{
         vertexShaderStageCreateInfo, fragmentShaderStageCreateInfo};
@@ -523,7 +1249,7 @@ void Engine::CreateGraphicsPipeline()
         {},        depthClampEnable, rasterizerDiscardEnable, polygonMode, cullMode,
         frontFace, depthBiasEnable,  depthBiasSlopeFactor,    lineWidth};
 
-    const auto rasterizationSamples = vk::SampleCountFlagBits::e1;
+    const auto rasterizationSamples = m_sampleCount;
     const auto sampleShadingEnabled = vk::False;
     vk::PipelineMultisampleStateCreateInfo multisampleStateCreateInfo{
         {}, rasterizationSamples, sampleShadingEnabled};
@@ -546,13 +1272,10 @@ void Engine::CreateGraphicsPipeline()
     vk::PipelineColorBlendStateCreateInfo colorBlendStateCreateInfo{
         {}, logicOpEnabled, logicOp, {colorBlendAttachment}};
 
-    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo{{}, *m_descriptorSetLayout, {}};
-    m_pipelineLayout = vk::raii::PipelineLayout{m_device, pipelineLayoutCreateInfo};
-
     const uint32_t viewMask = 0;
     const vk::Format depthAttachmentFormat = FindDepthFormat();
-    vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{
-        viewMask, {m_swapchainImageFormat.format}, depthAttachmentFormat};
+    vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{viewMask, {m_sceneColorFormat},
+                                                                depthAttachmentFormat};
 
     const vk::Bool32 depthTestEnable = vk::True;
     const vk::Bool32 depthWriteEnable = vk::True;
@@ -586,14 +1309,363 @@ void Engine::CreateGraphicsPipeline()
         pipelineCreateInfo, pipelineRenderingCreateInfo};
     vk::GraphicsPipelineCreateInfo createInfo = createInfos.get<vk::GraphicsPipelineCreateInfo>();
 
-    m_graphicsPipeline = vk::raii::Pipeline{m_device, nullptr, createInfo};
-}
+    pipelines.Graphics = vk::raii::Pipeline{m_device, nullptr, createInfo};
+    pipelines.DepthPrepass = CreateDepthPrepassPipeline(shaderModule, createInfos);
+
+    // the pre-pass has written the closest depths already, which only pass as equal
+    const vk::PipelineDepthStencilStateCreateInfo afterPrepassDepthStencilStateCreateInfo{
+        {}, depthTestEnable, vk::False, vk::CompareOp::eEqual, depthBoundsTestEnable,
+        stencilTestEnable};
+    vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo>
+        afterPrepassCreateInfos = createInfos;
+    afterPrepassCreateInfos.get<vk::GraphicsPipelineCreateInfo>().pDepthStencilState =
+        &afterPrepassDepthStencilStateCreateInfo;
+    pipelines.GraphicsAfterPrepass = vk::raii::Pipeline{
+        m_device, nullptr, afterPrepassCreateInfos.get<vk::GraphicsPipelineCreateInfo>()};
+
+    if (m_geometryPath == GeometryPath::MeshShader)
+    {
+        pipelines.MeshShader =
+            CreateMeshShaderPipeline(shaderCode, fragmentShaderStageCreateInfo, createInfos);
+    }
 
-void Engine::CreateCommandPool()
+    CreateDebugViewPipelines(pipelines, shaderCode, vertexShaderStageCreateInfo,
+                             fragmentShaderStageCreateInfo, createInfos);
+
+    if (m_geometryPath == GeometryPath::CulledIndirect)
+    {
+        pipelines.Cull = CreateCullPipeline(shaderCode);
+    }
+
+    pipelines.Upscale = CreateUpscalePipeline(shaderCode);
+
+    if (m_settings.PostProcessing)
+    {
+        pipelines.Tonemap = CreatePostPipeline(shaderCode, "TonemapMain");
+        pipelines.Grade = CreatePostPipeline(shaderCode, "GradeMain");
+        pipelines.Sharpen = CreatePostPipeline(shaderCode, "SharpenMain");
+    }
+
+    if (m_settings.Shadows)
+    {
+        pipelines.Shadow = CreateShadowPipeline(shaderCode);
+    }
+
+    pipelines.Clusters = CreateClusterPipeline(shaderCode);
+
+    return pipelines;
+}
+
+vk::raii::Pipeline Engine::CreateMeshShaderPipeline(
+    const ShaderCode &shaderCode, const vk::PipelineShaderStageCreateInfo &fragmentStage,
+    vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo> createInfos)
+    const
+{
+    // same state, with task and mesh shaders instead of vertex input
+    vk::raii::ShaderModule meshletShaderModule =
+        CreateShaderModule(shaderCode.at("shaders/meshlet.slang.spv"));
+
+    vk::PipelineShaderStageCreateInfo taskShaderStageCreateInfo{
+        {}, vk::ShaderStageFlagBits::eTaskEXT, meshletShaderModule, "TaskMain"};
+    vk::PipelineShaderStageCreateInfo meshShaderStageCreateInfo{
+        {}, vk::ShaderStageFlagBits::eMeshEXT, meshletShaderModule, "MeshMain"};
+    const std::array<vk::PipelineShaderStageCreateInfo, 3> meshStages{
+        taskShaderStageCreateInfo, meshShaderStageCreateInfo, fragmentStage};
+
+    vk::GraphicsPipelineCreateInfo &meshPipelineCreateInfo =
+        createInfos.get<vk::GraphicsPipelineCreateInfo>();
+    meshPipelineCreateInfo.setStages(meshStages);
+    meshPipelineCreateInfo.pVertexInputState = nullptr;
+    meshPipelineCreateInfo.pInputAssemblyState = nullptr;
+    meshPipelineCreateInfo.layout = m_meshletPipelineLayout;
+
+    return vk::raii::Pipeline{m_device, nullptr, meshPipelineCreateInfo};
+}
+
+vk::raii::Pipeline Engine::CreateDepthPrepassPipeline(
+    const vk::raii::ShaderModule &shaderModule,
+    vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo> createInfos)
+    const
+{
+    // same state and attachments as the scene, depth only, from the stream of just the positions
+    const vk::PipelineShaderStageCreateInfo stage{
+        {}, vk::ShaderStageFlagBits::eVertex, shaderModule, "DepthMain"};
+
+    const vk::VertexInputBindingDescription bindingDescription =
+        Vertex::GetPositionBindingDescription();
+    const vk::VertexInputAttributeDescription attributeDescription =
+        Vertex::GetPositionAttributeDescription();
+    vk::PipelineVertexInputStateCreateInfo vertexInputStateCreateInfo{
+        {}, bindingDescription, attributeDescription};
+
+    // the color attachment is left alone
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = {};
+    vk::PipelineColorBlendStateCreateInfo colorBlendStateCreateInfo{
+        {}, vk::False, vk::LogicOp::eCopy, {colorBlendAttachment}};
+
+    vk::GraphicsPipelineCreateInfo &pipelineCreateInfo =
+        createInfos.get<vk::GraphicsPipelineCreateInfo>();
+    pipelineCreateInfo.setStages(stage);
+    pipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
+    pipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
+
+    return vk::raii::Pipeline{m_device, nullptr, pipelineCreateInfo};
+}
+
+void Engine::CreateDebugViewPipelines(
+    ShaderPipelines &pipelines, const ShaderCode &shaderCode,
+    const vk::PipelineShaderStageCreateInfo &vertexStage,
+    const vk::PipelineShaderStageCreateInfo &fragmentStage,
+    const vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo>
+        &createInfos) const
+{
+    const vk::PipelineDepthStencilStateCreateInfo overdrawDepthStencilStateCreateInfo{
+        {}, vk::False, vk::False, vk::CompareOp::eAlways};
+    const vk::PipelineColorBlendStateCreateInfo overdrawColorBlendStateCreateInfo{
+        {}, vk::False, vk::LogicOp::eCopy, OverdrawBlendAttachment};
+
+    pipelines.GraphicsDebugViews.emplace_back(nullptr);
+    pipelines.MeshShaderDebugViews.emplace_back(nullptr);
+    for (uint32_t view = 1; view < DebugViewCount; ++view)
+    {
+        // the same state as the scene's, but for the overdraw view's
+        SpecializationConstants fragmentConstants{};
+        if (m_material.VertexColor)
+        {
+            fragmentConstants.Set(VertexColorStrengthId, VertexColorStrength);
+        }
+        fragmentConstants.Set(DebugViewId, view);
+        vk::PipelineShaderStageCreateInfo debugFragmentStage = fragmentStage;
+        debugFragmentStage.pSpecializationInfo = fragmentConstants.Info();
+
+        vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo>
+            debugCreateInfos = createInfos;
+        vk::GraphicsPipelineCreateInfo &debugCreateInfo =
+            debugCreateInfos.get<vk::GraphicsPipelineCreateInfo>();
+        const std::array<vk::PipelineShaderStageCreateInfo, 2> stages{vertexStage,
+                                                                      debugFragmentStage};
+        debugCreateInfo.setStages(stages);
+        if (static_cast<DebugView>(view) == DebugView::Overdraw)
+        {
+            debugCreateInfo.pDepthStencilState = &overdrawDepthStencilStateCreateInfo;
+            debugCreateInfo.pColorBlendState = &overdrawColorBlendStateCreateInfo;
+        }
+
+        pipelines.GraphicsDebugViews.emplace_back(m_device, nullptr, debugCreateInfo);
+        pipelines.MeshShaderDebugViews.push_back(
+            m_geometryPath == GeometryPath::MeshShader
+                ? CreateMeshShaderPipeline(shaderCode, debugFragmentStage, debugCreateInfos)
+                : vk::raii::Pipeline{nullptr});
+    }
+}
+
+vk::raii::Pipeline Engine::CreateCullPipeline(const ShaderCode &shaderCode) const
+{
+    vk::raii::ShaderModule shaderModule =
+        CreateShaderModule(shaderCode.at("shaders/cull.slang.spv"));
+
+    vk::PipelineShaderStageCreateInfo computeShaderStageCreateInfo{
+        {}, vk::ShaderStageFlagBits::eCompute, shaderModule, "CullMain"};
+    vk::ComputePipelineCreateInfo pipelineCreateInfo{
+        {}, computeShaderStageCreateInfo, m_meshletPipelineLayout};
+
+    return vk::raii::Pipeline{m_device, nullptr, pipelineCreateInfo};
+}
+
+vk::raii::Pipeline Engine::CreateUpscalePipeline(const ShaderCode &shaderCode) const
+{
+    vk::raii::ShaderModule shaderModule =
+        CreateShaderModule(shaderCode.at("shaders/upscale.slang.spv"));
+
+    SpecializationConstants fragmentConstants{};
+    fragmentConstants.Set(EdgeAwareUpscaleId, m_settings.EdgeAwareUpscale);
+    const std::array<vk::PipelineShaderStageCreateInfo, 2> stages{
+        vk::PipelineShaderStageCreateInfo{
+            {}, vk::ShaderStageFlagBits::eVertex, shaderModule, "VertexMain"},
+        vk::PipelineShaderStageCreateInfo{{},
+                                          vk::ShaderStageFlagBits::eFragment,
+                                          shaderModule,
+                                          "FragmentMain",
+                                          fragmentConstants.Info()}};
+
+    // a single triangle covering the output, made up by the vertex shader
+    vk::PipelineVertexInputStateCreateInfo vertexInputStateCreateInfo{};
+    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo{
+        {}, vk::PrimitiveTopology::eTriangleList};
+
+    const uint32_t viewportCount = 1;
+    const uint32_t scissorCount = 1;
+    vk::PipelineViewportStateCreateInfo viewportStateCreateInfo{
+        {}, viewportCount, nullptr, scissorCount, nullptr};
+
+    vk::PipelineRasterizationStateCreateInfo rasterizationStateCreateInfo{};
+    rasterizationStateCreateInfo.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizationStateCreateInfo.lineWidth = 1.0f;
+
+    vk::PipelineMultisampleStateCreateInfo multisampleStateCreateInfo{
+        {}, vk::SampleCountFlagBits::e1};
+
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+    vk::PipelineColorBlendStateCreateInfo colorBlendStateCreateInfo{
+        {}, vk::False, vk::LogicOp::eCopy, {colorBlendAttachment}};
+
+    std::vector dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo{{}, dynamicStates};
+
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo{{},
+                                                      stages,
+                                                      &vertexInputStateCreateInfo,
+                                                      &inputAssemblyStateCreateInfo,
+                                                      nullptr,
+                                                      &viewportStateCreateInfo,
+                                                      &rasterizationStateCreateInfo,
+                                                      &multisampleStateCreateInfo,
+                                                      nullptr,
+                                                      &colorBlendStateCreateInfo,
+                                                      &dynamicStateCreateInfo,
+                                                      m_upscalePipelineLayout};
+
+    const uint32_t viewMask = 0;
+    vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{
+        viewMask, {m_swapchainImageFormat.format}};
+
+    vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo> createInfos{
+        pipelineCreateInfo, pipelineRenderingCreateInfo};
+
+    return vk::raii::Pipeline{m_device, nullptr, createInfos.get<vk::GraphicsPipelineCreateInfo>()};
+}
+
+vk::raii::Pipeline Engine::CreatePostPipeline(const ShaderCode &shaderCode,
+                                              const char *entryPoint) const
+{
+    vk::raii::ShaderModule shaderModule =
+        CreateShaderModule(shaderCode.at("shaders/post.slang.spv"));
+
+    // an sRGB swapchain image encodes by itself, whether stored to or blitted into
+    SpecializationConstants computeConstants{};
+    computeConstants.Set(EncodeSrgbId, !IsSrgb(m_swapchainImageFormat.format));
+    vk::PipelineShaderStageCreateInfo computeShaderStageCreateInfo{
+        {}, vk::ShaderStageFlagBits::eCompute, shaderModule, entryPoint, computeConstants.Info()};
+    vk::ComputePipelineCreateInfo pipelineCreateInfo{
+        {}, computeShaderStageCreateInfo, m_postPipelineLayout};
+
+    return vk::raii::Pipeline{m_device, nullptr, pipelineCreateInfo};
+}
+
+vk::raii::Pipeline Engine::CreateShadowPipeline(const ShaderCode &shaderCode) const
+{
+    vk::raii::ShaderModule shaderModule =
+        CreateShaderModule(shaderCode.at("shaders/shadow.slang.spv"));
+
+    // depth only, without a fragment shader
+    const vk::PipelineShaderStageCreateInfo stage{
+        {}, vk::ShaderStageFlagBits::eVertex, shaderModule, "VertexMain"};
+
+    // from the stream of just the positions
+    const vk::VertexInputBindingDescription bindingDescription =
+        Vertex::GetPositionBindingDescription();
+    const vk::VertexInputAttributeDescription positionDescription =
+        Vertex::GetPositionAttributeDescription();
+    vk::PipelineVertexInputStateCreateInfo vertexInputStateCreateInfo{
+        {}, bindingDescription, positionDescription};
+    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo{
+        {}, vk::PrimitiveTopology::eTriangleList};
+
+    const uint32_t viewportCount = 1;
+    const uint32_t scissorCount = 1;
+    vk::PipelineViewportStateCreateInfo viewportStateCreateInfo{
+        {}, viewportCount, nullptr, scissorCount, nullptr};
+
+    // back faces cast shadows too, the quads only have one side
+    vk::PipelineRasterizationStateCreateInfo rasterizationStateCreateInfo{};
+    rasterizationStateCreateInfo.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizationStateCreateInfo.depthBiasEnable = vk::True;
+    rasterizationStateCreateInfo.depthBiasConstantFactor = ShadowDepthBiasConstant;
+    rasterizationStateCreateInfo.depthBiasSlopeFactor = ShadowDepthBiasSlope;
+    rasterizationStateCreateInfo.lineWidth = 1.0f;
+
+    vk::PipelineMultisampleStateCreateInfo multisampleStateCreateInfo{
+        {}, vk::SampleCountFlagBits::e1};
+
+    const vk::PipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo{
+        {}, vk::True, vk::True, vk::CompareOp::eLess};
+
+    vk::PipelineColorBlendStateCreateInfo colorBlendStateCreateInfo{};
+
+    std::vector dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo{{}, dynamicStates};
+
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo{{},
+                                                      stage,
+                                                      &vertexInputStateCreateInfo,
+                                                      &inputAssemblyStateCreateInfo,
+                                                      nullptr,
+                                                      &viewportStateCreateInfo,
+                                                      &rasterizationStateCreateInfo,
+                                                      &multisampleStateCreateInfo,
+                                                      &depthStencilStateCreateInfo,
+                                                      &colorBlendStateCreateInfo,
+                                                      &dynamicStateCreateInfo,
+                                                      m_shadowPipelineLayout};
+
+    const uint32_t viewMask = 0;
+    vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{viewMask, {}, ShadowMaps::Format};
+
+    vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo> createInfos{
+        pipelineCreateInfo, pipelineRenderingCreateInfo};
+
+    return vk::raii::Pipeline{m_device, nullptr, createInfos.get<vk::GraphicsPipelineCreateInfo>()};
+}
+
+vk::raii::Pipeline Engine::CreateClusterPipeline(const ShaderCode &shaderCode) const
+{
+    vk::raii::ShaderModule shaderModule =
+        CreateShaderModule(shaderCode.at("shaders/clusters.slang.spv"));
+
+    vk::PipelineShaderStageCreateInfo computeShaderStageCreateInfo{
+        {}, vk::ShaderStageFlagBits::eCompute, shaderModule, "ClusterMain"};
+    vk::ComputePipelineCreateInfo pipelineCreateInfo{
+        {}, computeShaderStageCreateInfo, m_clusterPipelineLayout};
+
+    return vk::raii::Pipeline{m_device, nullptr, pipelineCreateInfo};
+}
+
+void Engine::CreateCommandPool()
 {
     vk::CommandPoolCreateInfo poolCreateInfo{vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
                                              m_queueFamilyIndices.GraphicsIndex()};
     m_commandPool = vk::raii::CommandPool{m_device, poolCreateInfo};
+
+    for (QueueType queue : {QueueType::Compute, QueueType::Transfer})
+    {
+        if (!m_queues->IsDedicated(queue))
+        {
+            continue;
+        }
+
+        vk::CommandPoolCreateInfo dedicatedCreateInfo{
+            vk::CommandPoolCreateFlagBits::eResetCommandBuffer, m_queues->FamilyIndex(queue)};
+        (queue == QueueType::Compute ? m_computeCommandPool : m_transferCommandPool) =
+            vk::raii::CommandPool{m_device, dedicatedCreateInfo};
+    }
+}
+
+const vk::raii::CommandPool &Engine::CommandPool(QueueType queue) const
+{
+    if (queue == QueueType::Compute && m_queues->IsDedicated(queue))
+    {
+        return m_computeCommandPool;
+    }
+    if (queue == QueueType::Transfer && m_queues->IsDedicated(queue))
+    {
+        return m_transferCommandPool;
+    }
+
+    return m_commandPool;
 }
 
 vk::raii::ImageView Engine::CreateImageView(vk::raii::Image &image, vk::Format format,
@@ -610,9 +1682,10 @@ vk::raii::ImageView Engine::CreateImageView(vk::raii::Image &image, vk::Format f
     return vk::raii::ImageView(m_device, viewCreateInfo);
 }
 
-void Engine::TransitionImageLayout(vk::Image image, vk::ImageAspectFlags aspectMask,
-                                   vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
-                                   vk::AccessFlags2 srcAccessMask, vk::AccessFlags2 dstAccessMask,
+void Engine::TransitionImageLayout(const vk::raii::CommandBuffer &commandBuffer, vk::Image image,
+                                   vk::ImageAspectFlags aspectMask, vk::ImageLayout oldLayout,
+                                   vk::ImageLayout newLayout, vk::AccessFlags2 srcAccessMask,
+                                   vk::AccessFlags2 dstAccessMask,
                                    vk::PipelineStageFlags2 srcStageMask,
                                    vk::PipelineStageFlags2 dstStageMask)
 {
@@ -636,7 +1709,17 @@ void Engine::TransitionImageLayout(vk::Image image, vk::ImageAspectFlags aspectM
 
     vk::DependencyInfo dependencyInfo = {{}, {}, {}, {barrier}};
 
-    m_commandBuffers[m_currentFrame].pipelineBarrier2(dependencyInfo);
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+void Engine::TransitionImageLayout(vk::Image image, vk::ImageAspectFlags aspectMask,
+                                   vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+                                   vk::AccessFlags2 srcAccessMask, vk::AccessFlags2 dstAccessMask,
+                                   vk::PipelineStageFlags2 srcStageMask,
+                                   vk::PipelineStageFlags2 dstStageMask)
+{
+    TransitionImageLayout(m_commandBuffers[m_currentFrame], image, aspectMask, oldLayout,
+                          newLayout, srcAccessMask, dstAccessMask, srcStageMask, dstStageMask);
 }
 
 void Engine::TransitionImageLayout(uint32_t imageIndex, vk::ImageLayout oldLayout,
@@ -736,12 +1819,67 @@ bool Engine::HasStencilComponent(vk::Format format)
     return format == vk::Format::eD32SfloatS8Uint || format == vk::Format::eD24UnormS8Uint;
 }
 
+vk::SampleCountFlagBits Engine::ChooseSampleCount(uint32_t requested) const
+{
+    const vk::PhysicalDeviceLimits limits = m_physicalDevice.getProperties().limits;
+    const vk::SampleCountFlags supported =
+        limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+
+    for (vk::SampleCountFlagBits samples : {vk::SampleCountFlagBits::e8,
+                                            vk::SampleCountFlagBits::e4,
+                                            vk::SampleCountFlagBits::e2})
+    {
+        if (static_cast<uint32_t>(samples) <= requested && (supported & samples))
+        {
+            return samples;
+        }
+    }
+
+    return vk::SampleCountFlagBits::e1;
+}
+
+void Engine::CreateColorResources()
+{
+    if (m_sampleCount == vk::SampleCountFlagBits::e1)
+    {
+        return;
+    }
+
+    const vk::Format colorFormat = m_sceneColorFormat;
+    CreateImage(m_swapchainExtent.width, m_swapchainExtent.height, colorFormat, m_sampleCount,
+                vk::ImageTiling::eOptimal,
+                ImageUsage(MultisampledColorUsage, vk::ImageUsageFlagBits::eColorAttachment),
+                MemoryProperties(MultisampledColorUsage), m_colorImage, m_colorImageMemory);
+    m_colorImageView =
+        CreateImageView(m_colorImage, colorFormat, vk::ImageAspectFlagBits::eColor);
+}
+
+void Engine::CreateSceneColorResources()
+{
+    // the post-processing has scene images of its own, and does the upscaling
+    if (m_settings.PostProcessing)
+    {
+        return;
+    }
+
+    // the whole swapchain extent, so that changing the render scale needs no new image
+    const vk::Format colorFormat = m_swapchainImageFormat.format;
+    CreateImage(m_swapchainExtent.width, m_swapchainExtent.height, colorFormat,
+                vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+                ImageUsage(SceneColorUsage, vk::ImageUsageFlagBits::eColorAttachment |
+                                                vk::ImageUsageFlagBits::eSampled),
+                MemoryProperties(SceneColorUsage), m_sceneColorImage, m_sceneColorImageMemory);
+    m_sceneColorImageView =
+        CreateImageView(m_sceneColorImage, colorFormat, vk::ImageAspectFlagBits::eColor);
+}
+
 void Engine::CreateDepthResources()
 {
     vk::Format depthFormat = FindDepthFormat();
-    CreateImage(m_swapchainExtent.width, m_swapchainExtent.height, depthFormat,
-                vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                vk::MemoryPropertyFlagBits::eDeviceLocal, m_depthImage, m_depthImageMemory);
+    CreateImage(m_swapchainExtent.width, m_swapchainExtent.height, depthFormat, m_sampleCount,
+                vk::ImageTiling::eOptimal,
+                ImageUsage(DepthUsage, vk::ImageUsageFlagBits::eDepthStencilAttachment),
+                MemoryProperties(DepthUsage), m_depthImage, m_depthImageMemory);
     m_depthImageView = CreateImageView(m_depthImage, depthFormat, vk::ImageAspectFlagBits::eDepth);
 }
 
@@ -769,7 +1907,8 @@ void Engine::CopyBufferToImage(const vk::raii::Buffer &buffer, vk::raii::Image &
     EndSingleTimeCommands(commandBuffer);
 }
 
-void Engine::CreateImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling,
+void Engine::CreateImage(uint32_t width, uint32_t height, vk::Format format,
+                         vk::SampleCountFlagBits samples, vk::ImageTiling tiling,
                          vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties,
                          vk::raii::Image &image, vk::raii::DeviceMemory &imageMemory)
 {
@@ -781,7 +1920,7 @@ void Engine::CreateImage(uint32_t width, uint32_t height, vk::Format format, vk:
                                         {width, height, 1},
                                         miplevels,
                                         arrayLayers,
-                                        vk::SampleCountFlagBits::e1,
+                                        samples,
                                         tiling,
                                         usage,
                                         vk::SharingMode::eExclusive,
@@ -791,54 +1930,44 @@ void Engine::CreateImage(uint32_t width, uint32_t height, vk::Format format, vk:
     image = vk::raii::Image{m_device, imageCreateInfo};
 
     vk::MemoryRequirements memRequirements = image.getMemoryRequirements();
+
+    // mostly tilers have lazily allocated memory, elsewhere transient images get the real thing
+    if (!HasMemoryType(memRequirements.memoryTypeBits, properties))
+    {
+        properties &= ~vk::MemoryPropertyFlags{vk::MemoryPropertyFlagBits::eLazilyAllocated};
+    }
+
     vk::MemoryAllocateInfo allocInfo{memRequirements.size,
                                      FindMemoryType(memRequirements.memoryTypeBits, properties)};
     imageMemory = vk::raii::DeviceMemory{m_device, allocInfo};
     image.bindMemory(imageMemory, 0);
 }
 
-void Engine::CreateTextureImage()
+void Engine::CreateTextureImage(uint32_t width, uint32_t height, const uint8_t *pixels)
 {
-    std::filesystem::path basePath{sdl::GetBasePath()};
-    std::filesystem::path filePath = basePath / "textures" / "texture.jpg";
-    std::string filePathString = filePath.string();
-
-    int texWidth, texHeight, texChannels;
-    stbi_uc *pixels =
-        stbi_load(filePathString.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    vk::DeviceSize imageSize = static_cast<vk::DeviceSize>(texWidth) * texHeight * 4;
-
-    if (!pixels)
+    const bool hasMemoryBudget =
+        m_optionalDeviceExtensions.contains(vk::EXTMemoryBudgetExtensionName);
+    m_textureManager = std::make_unique<TextureManager>(
+        m_physicalDevice, m_device, m_deletionQueue, hasMemoryBudget,
+        m_queues->FamilyIndex(QueueType::Transfer), m_queues->FamilyIndex(QueueType::Graphics),
+        TextureBudget);
+    m_texture = m_textureManager->Add(width, height, pixels);
+
+    // makes the smallest mips resident, the rest streams in once the texture gets drawn
+    vk::raii::CommandBuffer upload = BeginSingleTimeCommands(QueueType::Transfer);
+    if (!m_queues->IsDedicated(QueueType::Transfer))
     {
-        throw std::runtime_error("failed to load texture image");
+        m_textureManager->Update(upload, upload, m_frameNumber);
+        EndSingleTimeCommands(upload, QueueType::Transfer);
+        return;
     }
 
-    vk::raii::Buffer stagingBuffer = nullptr;
-    vk::raii::DeviceMemory stagingBufferMemory = nullptr;
-
-    CreateBuffer(imageSize, vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible |
-                     vk::MemoryPropertyFlagBits::eHostCoherent,
-                 stagingBuffer, stagingBufferMemory);
-
-    void *data = stagingBufferMemory.mapMemory(0, imageSize);
-    memcpy(data, pixels, imageSize);
-    stagingBufferMemory.unmapMemory();
-
-    stbi_image_free(pixels);
-
-    CreateImage(texWidth, texHeight, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-                vk::MemoryPropertyFlagBits::eDeviceLocal, m_textureImage, m_textureImageMemory);
-
-    TransitionImageLayout(m_textureImage, vk::ImageLayout::eUndefined,
-                          vk::ImageLayout::eTransferDstOptimal);
-
-    CopyBufferToImage(stagingBuffer, m_textureImage, static_cast<uint32_t>(texWidth),
-                      static_cast<uint32_t>(texHeight));
-
-    TransitionImageLayout(m_textureImage, vk::ImageLayout::eTransferDstOptimal,
-                          vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::raii::CommandBuffer acquire = BeginSingleTimeCommands();
+    m_textureManager->Update(upload, acquire, m_frameNumber);
+    const QueueWait uploaded{QueueType::Transfer,
+                             SubmitSingleTimeCommands(upload, QueueType::Transfer),
+                             vk::PipelineStageFlagBits2::eFragmentShader};
+    EndSingleTimeCommands(acquire, QueueType::Graphics, {&uploaded, 1});
 }
 
 void Engine::CreateTextureSampler()
@@ -856,7 +1985,7 @@ void Engine::CreateTextureSampler()
     const vk::Bool32 compareEnable = vk::False;
     const vk::CompareOp compareOp = vk::CompareOp::eAlways;
     const float minLod = 0.f;
-    const float maxLod = 0.f;
+    const float maxLod = vk::LodClampNone;
     const vk::BorderColor borderColor = vk::BorderColor::eIntOpaqueBlack;
     const vk::Bool32 unnormalizedCoordinates = vk::False;
     vk::SamplerCreateInfo samplerCreateInfo{{},
@@ -879,10 +2008,18 @@ void Engine::CreateTextureSampler()
     m_textureSampler = vk::raii::Sampler{m_device, samplerCreateInfo};
 }
 
-void Engine::CreateTextureImageView()
+void Engine::CreateUpscaleSampler()
 {
-    m_textureImageView =
-        CreateImageView(m_textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor);
+    // never mipmapped, and clamped so that the output's edges don't wrap around
+    vk::SamplerCreateInfo samplerCreateInfo{{},
+                                            vk::Filter::eLinear,
+                                            vk::Filter::eLinear,
+                                            vk::SamplerMipmapMode::eNearest,
+                                            vk::SamplerAddressMode::eClampToEdge,
+                                            vk::SamplerAddressMode::eClampToEdge,
+                                            vk::SamplerAddressMode::eClampToEdge};
+
+    m_upscaleSampler = vk::raii::Sampler{m_device, samplerCreateInfo};
 }
 
 uint32_t Engine::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
@@ -900,12 +2037,48 @@ uint32_t Engine::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags pro
     throw std::runtime_error("no suitable memory type found");
 }
 
+bool Engine::HasMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const
+{
+    vk::PhysicalDeviceMemoryProperties memProperties = m_physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) &&
+            (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void Engine::CopyBuffer(vk::raii::Buffer &srcBuffer, vk::raii::Buffer &dstBuffer,
-                        vk::DeviceSize size)
+                        vk::DeviceSize size, QueueType consumer)
 {
-    vk::raii::CommandBuffer commandCopyBuffer = BeginSingleTimeCommands();
+    // only used while starting up, no need to narrow down how the consumer reads it
+    const OwnershipTransfer transfer{m_queues->FamilyIndex(QueueType::Transfer),
+                                     m_queues->FamilyIndex(consumer),
+                                     vk::PipelineStageFlagBits2::eCopy,
+                                     vk::AccessFlagBits2::eTransferWrite,
+                                     vk::PipelineStageFlagBits2::eAllCommands,
+                                     vk::AccessFlagBits2::eMemoryRead};
+
+    vk::raii::CommandBuffer commandCopyBuffer = BeginSingleTimeCommands(QueueType::Transfer);
     commandCopyBuffer.copyBuffer(srcBuffer, dstBuffer, vk::BufferCopy{0, 0, size});
-    EndSingleTimeCommands(commandCopyBuffer);
+    transfer.Release(commandCopyBuffer, dstBuffer);
+    if (!transfer.CrossesFamilies())
+    {
+        transfer.Acquire(commandCopyBuffer, dstBuffer);
+        EndSingleTimeCommands(commandCopyBuffer, QueueType::Transfer);
+        return;
+    }
+
+    const QueueWait copied{QueueType::Transfer,
+                           SubmitSingleTimeCommands(commandCopyBuffer, QueueType::Transfer),
+                           transfer.DstStages};
+    vk::raii::CommandBuffer acquire = BeginSingleTimeCommands(consumer);
+    transfer.Acquire(acquire, dstBuffer);
+    EndSingleTimeCommands(acquire, consumer, {&copied, 1});
 }
 
 void Engine::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
@@ -921,31 +2094,67 @@ void Engine::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
     buffer.bindMemory(*bufferMemory, 0);
 }
 
-void Engine::CreateVertexBuffer()
+void Engine::CreateDeviceLocalBuffer(const void *data, vk::DeviceSize size,
+                                     vk::BufferUsageFlags usage, vk::raii::Buffer &buffer,
+                                     vk::raii::DeviceMemory &bufferMemory, QueueType consumer)
 {
-    vk::DeviceSize bufferSize = sizeof(Vertices[0]) * Vertices.size();
-
     vk::raii::Buffer stagingBuffer = nullptr;
     vk::raii::DeviceMemory stagingBufferMemory = nullptr;
-    CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
+    CreateBuffer(size, vk::BufferUsageFlagBits::eTransferSrc,
                  vk::MemoryPropertyFlagBits::eHostVisible |
                      vk::MemoryPropertyFlagBits::eHostCoherent,
                  stagingBuffer, stagingBufferMemory);
 
-    void *dataStaging = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(dataStaging, Vertices.data(), bufferSize);
+    void *dataStaging = stagingBufferMemory.mapMemory(0, size);
+    memcpy(dataStaging, data, size);
     stagingBufferMemory.unmapMemory();
 
-    CreateBuffer(bufferSize,
-                 vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-                 vk::MemoryPropertyFlagBits::eDeviceLocal, m_vertexBuffer, m_vertexBufferMemory);
+    CreateBuffer(size, usage | vk::BufferUsageFlagBits::eTransferDst,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, buffer, bufferMemory);
+
+    CopyBuffer(stagingBuffer, buffer, size, consumer);
+}
+
+void Engine::LoadMesh(Mesh mesh)
+{
+    m_mesh = std::move(mesh);
+
+    if (m_geometryPath != GeometryPath::Vertex)
+    {
+        MeshletBuilder::Build(m_mesh);
+    }
+
+    m_lodTriangleAreas.clear();
+    for (size_t level = 0; level < m_mesh.LodCount(); ++level)
+    {
+        m_lodTriangleAreas.push_back(m_mesh.MeanTriangleArea(m_mesh.Lod(level)));
+    }
+}
+
+void Engine::CreateScene()
+{
+    m_modelNode = m_scene.AddNode(glm::mat4{1.0f});
+    m_scene.SetLocalBounds(m_modelNode, m_mesh.BoundsCenter, m_mesh.BoundsRadius);
+    // a fixed animation time never moves it, so its shadows can be cached
+    m_scene.SetStatic(m_modelNode, m_settings.AnimationTime.has_value());
+}
+
+void Engine::CreateVertexBuffer()
+{
+    vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eVertexBuffer;
+    if (m_geometryPath == GeometryPath::MeshShader)
+    {
+        // mesh shaders fetch vertices themselves
+        usage |= vk::BufferUsageFlagBits::eStorageBuffer;
+    }
 
-    CopyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
+    CreateDeviceLocalBuffer(m_mesh.Vertices.data(), m_mesh.VertexBufferSize(), usage,
+                            m_vertexBuffer, m_vertexBufferMemory);
 }
 
 void Engine::CreateIndexBuffer()
 {
-    vk::DeviceSize bufferSize = sizeof(Indices[0]) * Indices.size();
+    vk::DeviceSize bufferSize = m_mesh.IndexBufferSize();
 
     vk::raii::Buffer stagingBuffer = nullptr;
     vk::raii::DeviceMemory stagingBufferMemory = nullptr;
@@ -955,7 +2164,7 @@ void Engine::CreateIndexBuffer()
                  stagingBuffer, stagingBufferMemory);
 
     void *data = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(data, Indices.data(), bufferSize);
+    m_mesh.WriteIndices(data);
     stagingBufferMemory.unmapMemory();
 
     CreateBuffer(bufferSize,
@@ -965,6 +2174,64 @@ void Engine::CreateIndexBuffer()
     CopyBuffer(stagingBuffer, m_indexBuffer, bufferSize);
 }
 
+void Engine::CreatePositionBuffer()
+{
+    std::vector<glm::vec3> positions(m_mesh.Vertices.size());
+    std::ranges::transform(m_mesh.Vertices, positions.begin(),
+                           [](const Vertex &vertex) { return vertex.Position; });
+
+    CreateDeviceLocalBuffer(positions.data(), sizeof(glm::vec3) * positions.size(),
+                            vk::BufferUsageFlagBits::eVertexBuffer, m_positionBuffer,
+                            m_positionBufferMemory);
+}
+
+void Engine::CreateMeshletBuffers()
+{
+    if (m_geometryPath == GeometryPath::Vertex)
+    {
+        return;
+    }
+
+    // read by the culling pass, or by the mesh shaders
+    const QueueType meshletConsumer = m_geometryPath == GeometryPath::CulledIndirect
+                                          ? QueueType::Compute
+                                          : QueueType::Graphics;
+    CreateDeviceLocalBuffer(m_mesh.Meshlets.data(), sizeof(Meshlet) * m_mesh.Meshlets.size(),
+                            vk::BufferUsageFlagBits::eStorageBuffer, m_meshletBuffer,
+                            m_meshletBufferMemory, meshletConsumer);
+
+    if (m_geometryPath == GeometryPath::MeshShader)
+    {
+        CreateDeviceLocalBuffer(m_mesh.MeshletVertices.data(),
+                                sizeof(uint32_t) * m_mesh.MeshletVertices.size(),
+                                vk::BufferUsageFlagBits::eStorageBuffer, m_meshletVertexBuffer,
+                                m_meshletVertexBufferMemory);
+        CreateDeviceLocalBuffer(m_mesh.MeshletTriangles.data(),
+                                sizeof(uint32_t) * m_mesh.MeshletTriangles.size(),
+                                vk::BufferUsageFlagBits::eStorageBuffer, m_meshletTriangleBuffer,
+                                m_meshletTriangleBufferMemory);
+        return;
+    }
+
+    // written by the culling pass, one per frame in flight
+    m_drawCommandBuffers.clear();
+    m_drawCommandBuffersMemory.clear();
+
+    const vk::DeviceSize bufferSize =
+        sizeof(vk::DrawIndexedIndirectCommand) * m_mesh.Meshlets.size();
+    for (size_t i = 0; i < MaxFramesInFlight; i++)
+    {
+        vk::raii::Buffer buffer = nullptr;
+        vk::raii::DeviceMemory bufferMem = nullptr;
+        CreateBuffer(bufferSize,
+                     vk::BufferUsageFlagBits::eStorageBuffer |
+                         vk::BufferUsageFlagBits::eIndirectBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal, buffer, bufferMem);
+        m_drawCommandBuffers.emplace_back(std::move(buffer));
+        m_drawCommandBuffersMemory.emplace_back(std::move(bufferMem));
+    }
+}
+
 void Engine::CreateUniformBuffers()
 {
     m_uniformBuffers.clear();
@@ -989,18 +2256,27 @@ void Engine::CreateUniformBuffers()
 void Engine::CreateDescriptorPool()
 {
     vk::DescriptorPoolSize uboPoolSize{vk::DescriptorType::eUniformBuffer, MaxFramesInFlight};
+    // the upscale set, plus the ones up to two swapchain recreations per frame retire, which
+    // stay allocated for the frames in flight
+    const uint32_t upscaleSets = (MaxFramesInFlight + 1) * 2;
+    // the texture and the shadow atlas of each frame's set
     vk::DescriptorPoolSize samplerPoolSize{vk::DescriptorType::eCombinedImageSampler,
-                                           MaxFramesInFlight};
-    std::array poolSizes{uboPoolSize, samplerPoolSize};
-
+                                           MaxFramesInFlight * 2 + upscaleSets};
+    vk::DescriptorPoolSize storagePoolSize{
+        vk::DescriptorType::eStorageBuffer,
+        MaxFramesInFlight * (MaxMeshletStorageBuffers + ClusterStorageBuffers * 2)};
+    std::array poolSizes{uboPoolSize, samplerPoolSize, storagePoolSize};
+
+    // the frame's descriptor set, the one of the meshlet pipelines, and the light binning's
+    const uint32_t maxSets = MaxFramesInFlight * 3 + upscaleSets;
     vk::DescriptorPoolCreateInfo poolCreateInfo{
-        vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, MaxFramesInFlight, poolSizes};
+        vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, maxSets, poolSizes};
     m_descriptorPool = vk::raii::DescriptorPool{m_device, poolCreateInfo};
 }
 
 void Engine::CreateDescriptorSets()
 {
-    std::vector<vk::DescriptorSetLayout> layouts{MaxFramesInFlight, *m_descriptorSetLayout};
+    std::vector<vk::DescriptorSetLayout> layouts{MaxFramesInFlight, m_descriptorSetLayout};
     vk::DescriptorSetAllocateInfo allocInfo{m_descriptorPool, layouts};
     m_descriptorSets.clear();
     m_descriptorSets = m_device.allocateDescriptorSets(allocInfo);
@@ -1010,7 +2286,8 @@ void Engine::CreateDescriptorSets()
         vk::DescriptorBufferInfo bufferInfo{m_uniformBuffers[i], offset,
                                             sizeof(UniformBufferObject)};
 
-        vk::DescriptorImageInfo imageInfo{m_textureSampler, m_textureImageView,
+        vk::DescriptorImageInfo imageInfo{m_textureSampler,
+                                          m_textureManager->ImageView(m_texture),
                                           vk::ImageLayout::eShaderReadOnlyOptimal};
 
         const uint32_t dstBinding = 0;
@@ -1028,53 +2305,338 @@ void Engine::CreateDescriptorSets()
             dstArrayElement,     vk::DescriptorType::eCombinedImageSampler,
             imageInfo,           {}};
 
-        std::array writeDescriptors{uboWriteDescriptor, samplerWriteDescriptor};
+        vk::DescriptorImageInfo shadowImageInfo{m_shadowMaps->Sampler(),
+                                                m_shadowMaps->AtlasView(),
+                                                vk::ImageLayout::eShaderReadOnlyOptimal};
+        vk::WriteDescriptorSet shadowWriteDescriptor{
+            m_descriptorSets[i], dstBinding + 2,
+            dstArrayElement,     vk::DescriptorType::eCombinedImageSampler,
+            shadowImageInfo,     {}};
+
+        const std::array lightBufferInfos{m_lightClusters->LightBuffer(i),
+                                          m_lightClusters->LightCountBuffer(i),
+                                          m_lightClusters->LightIndexBuffer(i)};
+        vk::WriteDescriptorSet lightWriteDescriptor{m_descriptorSets[i],
+                                                    dstBinding + 3,
+                                                    dstArrayElement,
+                                                    vk::DescriptorType::eStorageBuffer,
+                                                    {},
+                                                    lightBufferInfos,
+                                                    {}};
+
+        std::array writeDescriptors{uboWriteDescriptor, samplerWriteDescriptor,
+                                    shadowWriteDescriptor, lightWriteDescriptor};
 
         m_device.updateDescriptorSets(writeDescriptors, {});
     }
-}
 
-void Engine::CreateCommandBuffer()
-{
-    const uint32_t commandBufferCount = MaxFramesInFlight;
-    vk::CommandBufferAllocateInfo allocInfo{m_commandPool, vk::CommandBufferLevel::ePrimary,
-                                            commandBufferCount};
-    m_commandBuffers = vk::raii::CommandBuffers{m_device, allocInfo};
+    m_boundTextureViews.assign(MaxFramesInFlight, m_textureManager->ImageView(m_texture));
 }
 
-vk::raii::CommandBuffer Engine::BeginSingleTimeCommands()
+void Engine::UpdateTextureDescriptor()
 {
-    vk::CommandBufferAllocateInfo allocInfo{m_commandPool, vk::CommandBufferLevel::ePrimary, 1};
-    vk::raii::CommandBuffer commandBuffer =
-        std::move(m_device.allocateCommandBuffers(allocInfo).front());
-
+    // streaming replaces the view, and the other frame's set may still be in use,
+    // so every set catches up on its own turn
+    const vk::ImageView imageView = m_textureManager->ImageView(m_texture);
+    if (m_boundTextureViews[m_currentFrame] == imageView)
+    {
+        return;
+    }
+
+    vk::DescriptorImageInfo imageInfo{m_textureSampler, imageView,
+                                      vk::ImageLayout::eShaderReadOnlyOptimal};
+    const uint32_t dstBinding = 1;
+    const uint32_t dstArrayElement = 0;
+    vk::WriteDescriptorSet samplerWriteDescriptor{
+        m_descriptorSets[m_currentFrame], dstBinding, dstArrayElement,
+        vk::DescriptorType::eCombinedImageSampler, imageInfo};
+    m_device.updateDescriptorSets(samplerWriteDescriptor, {});
+
+    m_boundTextureViews[m_currentFrame] = imageView;
+}
+
+void Engine::CreateMeshletDescriptorSets()
+{
+    if (m_geometryPath == GeometryPath::Vertex)
+    {
+        return;
+    }
+
+    std::vector<vk::DescriptorSetLayout> layouts{MaxFramesInFlight, m_meshletDescriptorSetLayout};
+    vk::DescriptorSetAllocateInfo allocInfo{m_descriptorPool, layouts};
+    m_meshletDescriptorSets.clear();
+    m_meshletDescriptorSets = m_device.allocateDescriptorSets(allocInfo);
+    for (size_t i = 0; i < MaxFramesInFlight; i++)
+    {
+        std::vector<vk::DescriptorBufferInfo> bufferInfos{};
+        if (m_geometryPath == GeometryPath::CulledIndirect)
+        {
+            bufferInfos = {{m_meshletBuffer, 0, vk::WholeSize},
+                           {m_drawCommandBuffers[i], 0, vk::WholeSize}};
+        }
+        else
+        {
+            bufferInfos = {{m_vertexBuffer, 0, vk::WholeSize},
+                           {m_meshletBuffer, 0, vk::WholeSize},
+                           {m_meshletVertexBuffer, 0, vk::WholeSize},
+                           {m_meshletTriangleBuffer, 0, vk::WholeSize}};
+        }
+
+        std::vector<vk::WriteDescriptorSet> writeDescriptors{};
+        for (uint32_t binding = 0; binding < bufferInfos.size(); ++binding)
+        {
+            const uint32_t dstArrayElement = 0;
+            writeDescriptors.push_back(vk::WriteDescriptorSet{m_meshletDescriptorSets[i],
+                                                              binding,
+                                                              dstArrayElement,
+                                                              vk::DescriptorType::eStorageBuffer,
+                                                              {},
+                                                              bufferInfos[binding],
+                                                              {}});
+        }
+
+        m_device.updateDescriptorSets(writeDescriptors, {});
+    }
+}
+
+void Engine::CreateUpscaleDescriptorSet()
+{
+    if (m_settings.PostProcessing)
+    {
+        return;
+    }
+
+    vk::DescriptorSetAllocateInfo allocInfo{m_descriptorPool, m_upscaleDescriptorSetLayout};
+    m_upscaleDescriptorSet = std::move(m_device.allocateDescriptorSets(allocInfo).front());
+
+    vk::DescriptorImageInfo imageInfo{m_upscaleSampler, m_sceneColorImageView,
+                                      vk::ImageLayout::eShaderReadOnlyOptimal};
+    const uint32_t dstBinding = 0;
+    const uint32_t dstArrayElement = 0;
+    vk::WriteDescriptorSet samplerWriteDescriptor{m_upscaleDescriptorSet, dstBinding,
+                                                  dstArrayElement,
+                                                  vk::DescriptorType::eCombinedImageSampler,
+                                                  imageInfo};
+    m_device.updateDescriptorSets(samplerWriteDescriptor, {});
+}
+
+void Engine::CreatePostProcessing(const ColorLut &lut)
+{
+    if (!m_settings.PostProcessing)
+    {
+        return;
+    }
+
+    m_postProcessing = std::make_unique<PostProcessing>(
+        m_physicalDevice, m_device, m_deletionQueue, m_queues->FamilyIndex(QueueType::Compute),
+        m_postDescriptorSetLayout, MaxFramesInFlight, lut);
+
+    vk::raii::CommandBuffer commandBuffer = BeginSingleTimeCommands(QueueType::Compute);
+    m_postProcessing->RecordLutUpload(commandBuffer, m_frameNumber);
+    EndSingleTimeCommands(commandBuffer, QueueType::Compute);
+
+    ResizePostProcessing();
+}
+
+void Engine::ResizePostProcessing()
+{
+    std::vector<vk::ImageView> outputViews{};
+    if (m_postToSwapchain)
+    {
+        for (const vk::raii::ImageView &imageView : m_swapchainImageViews)
+        {
+            outputViews.push_back(imageView);
+        }
+    }
+
+    m_postProcessing->Resize(m_swapchainExtent, outputViews, m_frameNumber);
+}
+
+void Engine::CreateShadowMaps()
+{
+    // the frame's descriptor set samples the atlas either way
+    const uint32_t resolution = m_settings.Shadows ? ShadowMapResolution : 1;
+    m_shadowMaps = std::make_unique<ShadowMaps>(m_physicalDevice, m_device, resolution);
+}
+
+void Engine::CreateLightClusters()
+{
+    m_lightClusters =
+        std::make_unique<LightClusters>(m_physicalDevice, m_device, MaxFramesInFlight);
+    m_lights.resize(std::min(m_settings.LightCount, MaxLights));
+}
+
+void Engine::CreateClusterDescriptorSets()
+{
+    std::vector<vk::DescriptorSetLayout> layouts{MaxFramesInFlight, m_clusterDescriptorSetLayout};
+    vk::DescriptorSetAllocateInfo allocInfo{m_descriptorPool, layouts};
+    m_clusterDescriptorSets.clear();
+    m_clusterDescriptorSets = m_device.allocateDescriptorSets(allocInfo);
+    for (uint32_t i = 0; i < MaxFramesInFlight; i++)
+    {
+        const std::array bufferInfos{m_lightClusters->LightBuffer(i),
+                                     m_lightClusters->LightCountBuffer(i),
+                                     m_lightClusters->LightIndexBuffer(i)};
+        const uint32_t dstBinding = 0;
+        const uint32_t dstArrayElement = 0;
+        vk::WriteDescriptorSet writeDescriptor{m_clusterDescriptorSets[i],
+                                               dstBinding,
+                                               dstArrayElement,
+                                               vk::DescriptorType::eStorageBuffer,
+                                               {},
+                                               bufferInfos,
+                                               {}};
+        m_device.updateDescriptorSets(writeDescriptor, {});
+    }
+}
+
+void Engine::CreateCommandBuffer()
+{
+    const uint32_t commandBufferCount = MaxFramesInFlight;
+    vk::CommandBufferAllocateInfo allocInfo{m_commandPool, vk::CommandBufferLevel::ePrimary,
+                                            commandBufferCount};
+    m_commandBuffers = vk::raii::CommandBuffers{m_device, allocInfo};
+
+    m_computeCommandBuffers.clear();
+    if (m_queues->IsDedicated(QueueType::Compute) &&
+        m_geometryPath == GeometryPath::CulledIndirect)
+    {
+        vk::CommandBufferAllocateInfo computeAllocInfo{
+            m_computeCommandPool, vk::CommandBufferLevel::ePrimary, commandBufferCount};
+        m_computeCommandBuffers = vk::raii::CommandBuffers{m_device, computeAllocInfo};
+    }
+
+    m_transferCommandBuffers.clear();
+    if (m_queues->IsDedicated(QueueType::Transfer))
+    {
+        vk::CommandBufferAllocateInfo transferAllocInfo{
+            m_transferCommandPool, vk::CommandBufferLevel::ePrimary, commandBufferCount};
+        m_transferCommandBuffers = vk::raii::CommandBuffers{m_device, transferAllocInfo};
+    }
+
+    m_postCommandBuffers.clear();
+    m_compositeCommandBuffers.clear();
+    if (m_postProcessing && m_queues->IsDedicated(QueueType::Compute))
+    {
+        vk::CommandBufferAllocateInfo postAllocInfo{
+            m_computeCommandPool, vk::CommandBufferLevel::ePrimary, commandBufferCount};
+        m_postCommandBuffers = vk::raii::CommandBuffers{m_device, postAllocInfo};
+
+        if (!m_postToSwapchain)
+        {
+            m_compositeCommandBuffers = vk::raii::CommandBuffers{m_device, allocInfo};
+        }
+    }
+}
+
+vk::raii::CommandBuffer Engine::BeginSingleTimeCommands(QueueType queue)
+{
+    vk::CommandBufferAllocateInfo allocInfo{CommandPool(queue), vk::CommandBufferLevel::ePrimary,
+                                            1};
+    vk::raii::CommandBuffer commandBuffer =
+        std::move(m_device.allocateCommandBuffers(allocInfo).front());
+
     vk::CommandBufferBeginInfo beginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
     commandBuffer.begin(beginInfo);
 
     return commandBuffer;
 }
 
-void Engine::EndSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer)
+uint64_t Engine::SubmitSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer,
+                                          QueueType queue, std::span<const QueueWait> waits)
 {
     commandBuffer.end();
 
-    vk::SubmitInfo submitInfo{{}, {}, *commandBuffer, {}};
-    m_graphicsQueue.submit(submitInfo, nullptr);
-    m_graphicsQueue.waitIdle();
+    const vk::CommandBuffer submitted = commandBuffer;
+    return m_queues->Submit(queue, {&submitted, 1}, waits);
+}
+
+void Engine::EndSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer, QueueType queue,
+                                   std::span<const QueueWait> waits)
+{
+    m_queues->Wait(queue, SubmitSingleTimeCommands(commandBuffer, queue, waits));
 }
 
 void Engine::RecordCommandBuffer(uint32_t imageIndex)
 {
     m_commandBuffers[m_currentFrame].begin({});
 
-    // Before starting rendering, transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL
-    TransitionImageLayout(imageIndex, vk::ImageLayout::eUndefined,
-                          vk::ImageLayout::eColorAttachmentOptimal,
-                          {}, // srcAccessMask (no need to wait for previous operations)
-                          vk::AccessFlagBits2::eColorAttachmentWrite,        // dstAccessMask
-                          vk::PipelineStageFlagBits2::eTopOfPipe,            // srcStage
-                          vk::PipelineStageFlagBits2::eColorAttachmentOutput // dstStage
-    );
+    if (m_gpuTimestamps->IsSupported())
+    {
+        m_gpuTimestamps->Reset(m_commandBuffers[m_currentFrame], m_currentFrame);
+        m_gpuTimestamps->Write(m_commandBuffers[m_currentFrame], m_currentFrame,
+                               FrameBeginTimestamp, vk::PipelineStageFlagBits2::eTopOfPipe);
+    }
+
+    // streams on the transfer queue when there is one, the textures get acquired right here
+    if (!m_transferCommandBuffers.empty())
+    {
+        m_transferCommandBuffers[m_currentFrame].begin({});
+        m_textureManager->Update(m_transferCommandBuffers[m_currentFrame],
+                                 m_commandBuffers[m_currentFrame], m_frameNumber);
+        m_transferCommandBuffers[m_currentFrame].end();
+    }
+    else
+    {
+        m_textureManager->Update(m_commandBuffers[m_currentFrame],
+                                 m_commandBuffers[m_currentFrame], m_frameNumber);
+    }
+    UpdateTextureDescriptor();
+
+    if (m_geometryPath == GeometryPath::CulledIndirect)
+    {
+        RecordMeshletCulling();
+    }
+
+    RecordShadows();
+    RecordLightClusters();
+
+    if (m_postProcessing)
+    {
+        // last read by the post-processing of the frame before last, which the fence covered
+        TransitionImageLayout(m_postProcessing->SceneImage(m_currentFrame),
+                              vk::ImageAspectFlagBits::eColor, vk::ImageLayout::eUndefined,
+                              vk::ImageLayout::eColorAttachmentOptimal,
+                              vk::AccessFlagBits2::eShaderSampledRead,
+                              vk::AccessFlagBits2::eColorAttachmentWrite,
+                              vk::PipelineStageFlagBits2::eComputeShader,
+                              vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+    }
+    else
+    {
+        // Before starting rendering, transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL
+        TransitionImageLayout(imageIndex, vk::ImageLayout::eUndefined,
+                              vk::ImageLayout::eColorAttachmentOptimal,
+                              {}, // srcAccessMask (no need to wait for previous operations)
+                              vk::AccessFlagBits2::eColorAttachmentWrite,        // dstAccessMask
+                              vk::PipelineStageFlagBits2::eTopOfPipe,            // srcStage
+                              vk::PipelineStageFlagBits2::eColorAttachmentOutput // dstStage
+        );
+    }
+
+    // below full resolution, the scene goes into its own image first
+    const bool upscaled = !m_postProcessing && m_renderExtent != m_swapchainExtent;
+    if (upscaled)
+    {
+        TransitionImageLayout(*m_sceneColorImage, vk::ImageAspectFlagBits::eColor,
+                              vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal,
+                              vk::AccessFlagBits2::eShaderSampledRead,
+                              vk::AccessFlagBits2::eColorAttachmentWrite,
+                              vk::PipelineStageFlagBits2::eFragmentShader,
+                              vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+    }
+
+    const bool multisampled = m_sampleCount != vk::SampleCountFlagBits::e1;
+    if (multisampled)
+    {
+        // the previous frame's samples are of no interest
+        TransitionImageLayout(*m_colorImage, vk::ImageAspectFlagBits::eColor,
+                              vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal,
+                              vk::AccessFlagBits2::eColorAttachmentWrite,
+                              vk::AccessFlagBits2::eColorAttachmentWrite,
+                              vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                              vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+    }
 
     // Transition depth image to depth attachment optimal layout
     TransitionImageLayout(*m_depthImage, vk::ImageAspectFlagBits::eDepth,
@@ -1087,13 +2649,25 @@ void Engine::RecordCommandBuffer(uint32_t imageIndex)
                               vk::PipelineStageFlagBits2::eLateFragmentTests);
 
     const auto clearValue = vk::ClearColorValue{0.0f, 0.0f, 0.0f, 1.0f};
-    const auto &imageView = m_swapchainImageViews[imageIndex];
+    vk::ImageView sceneImageView =
+        upscaled ? *m_sceneColorImageView : m_swapchainImageViews[imageIndex];
+    if (m_postProcessing)
+    {
+        sceneImageView = m_postProcessing->SceneImageView(m_currentFrame);
+    }
     const auto imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
-    const auto resolveMode = vk::ResolveModeFlagBits::eNone;
-    const vk::ImageView resolveImageView = {};
-    const auto resolveImageLayout = vk::ImageLayout::eUndefined;
-    const auto loadOp = vk::AttachmentLoadOp::eClear;
-    const auto storeOp = vk::AttachmentStoreOp::eStore;
+
+    // with MSAA, the samples get resolved into the scene image as the rendering ends,
+    // and are never stored
+    const AttachmentUsage &colorUsage = multisampled ? MultisampledColorUsage : SceneColorUsage;
+    const auto loadOp = LoadOp(colorUsage);
+    const auto storeOp = StoreOp(colorUsage);
+    const vk::ImageView imageView = multisampled ? *m_colorImageView : sceneImageView;
+    const auto resolveMode =
+        multisampled ? vk::ResolveModeFlagBits::eAverage : vk::ResolveModeFlagBits::eNone;
+    const vk::ImageView resolveImageView = multisampled ? sceneImageView : vk::ImageView{};
+    const auto resolveImageLayout =
+        multisampled ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::eUndefined;
     vk::RenderingAttachmentInfo attachmentInfo{imageView,        imageLayout,        resolveMode,
                                                resolveImageView, resolveImageLayout, loadOp,
                                                storeOp,          clearValue};
@@ -1102,56 +2676,546 @@ void Engine::RecordCommandBuffer(uint32_t imageIndex)
     vk::RenderingAttachmentInfo depthAttachmentInfo{m_depthImageView,
                                                     vk::ImageLayout::eDepthStencilAttachmentOptimal,
                                                     vk::ResolveModeFlagBits::eNone,
-                                                    resolveImageView,
-                                                    resolveImageLayout,
-                                                    vk::AttachmentLoadOp::eClear,
-                                                    vk::AttachmentStoreOp::eDontCare,
+                                                    {},
+                                                    vk::ImageLayout::eUndefined,
+                                                    LoadOp(DepthUsage),
+                                                    StoreOp(DepthUsage),
                                                     clearDepth};
 
-    const vk::Rect2D renderArea{{0, 0}, m_swapchainExtent};
+    const vk::Rect2D renderArea{{0, 0}, m_renderExtent};
     const uint32_t layerCount = 1;
     const uint32_t viewMask = 0;
     vk::RenderingInfo renderingInfo = {{},       renderArea,       layerCount,
                                        viewMask, {attachmentInfo}, &depthAttachmentInfo};
 
+    // decided on measurements of earlier frames, which this one gets measured for in turn
+    const bool debugView = m_debugView != DebugView::None;
+    const bool depthPrepass = !debugView && HasDepthPrepass() && m_depthPrepass.IsEnabled();
+    m_depthPrepassUsed[m_currentFrame] = depthPrepass;
+    if (m_gpuTimestamps->IsSupported())
+    {
+        m_gpuTimestamps->Write(m_commandBuffers[m_currentFrame], m_currentFrame,
+                               SceneBeginTimestamp, vk::PipelineStageFlagBits2::eTopOfPipe);
+    }
+
     m_commandBuffers[m_currentFrame].beginRendering(renderingInfo);
 
-    m_commandBuffers[m_currentFrame].bindPipeline(vk::PipelineBindPoint::eGraphics,
-                                                  m_graphicsPipeline);
+    m_commandBuffers[m_currentFrame].setViewport(
+        0, vk::Viewport{0.0f, 0.0f, static_cast<float>(m_renderExtent.width),
+                        static_cast<float>(m_renderExtent.height), 0.0f, 1.0f});
+    m_commandBuffers[m_currentFrame].setScissor(0, renderArea);
 
-    m_commandBuffers[m_currentFrame].bindVertexBuffers(0, {m_vertexBuffer}, {0});
-    m_commandBuffers[m_currentFrame].bindIndexBuffer(m_indexBuffer, 0, vk::IndexType::eUint16);
+    const MeshLod lod = m_mesh.Lod(m_currentLod);
 
-    m_commandBuffers[m_currentFrame].setViewport(
-        0, vk::Viewport{0.0f, 0.0f, static_cast<float>(m_swapchainExtent.width),
-                        static_cast<float>(m_swapchainExtent.height), 0.0f, 1.0f});
-    m_commandBuffers[m_currentFrame].setScissor(0,
-                                                vk::Rect2D{vk::Offset2D{0, 0}, m_swapchainExtent});
+    if (depthPrepass && m_scene.IsVisible(m_modelNode))
+    {
+        RecordDepthPrepass();
+    }
 
-    m_commandBuffers[m_currentFrame].bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-                                                        m_pipelineLayout, 0,
-                                                        {m_descriptorSets[m_currentFrame]}, {});
+    if (!m_scene.IsVisible(m_modelNode))
+    {
+        // nothing to draw, the frame is just cleared
+    }
+    else if (m_geometryPath == GeometryPath::MeshShader)
+    {
+        vk::Pipeline pipeline = m_pipelines.MeshShader;
+        if (debugView)
+        {
+            pipeline = m_pipelines.MeshShaderDebugViews[static_cast<size_t>(m_debugView)];
+        }
+        m_commandBuffers[m_currentFrame].bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+        m_commandBuffers[m_currentFrame].bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics, m_meshletPipelineLayout, 0,
+            {m_descriptorSets[m_currentFrame], m_meshletDescriptorSets[m_currentFrame]}, {});
+        m_commandBuffers[m_currentFrame].pushConstants<MeshletCullConstants>(
+            m_meshletPipelineLayout, m_cullConstantStages, 0, m_cullConstants);
+
+        const uint32_t groupCount = (lod.MeshletCount + TaskGroupSize - 1) / TaskGroupSize;
+        m_commandBuffers[m_currentFrame].drawMeshTasksEXT(groupCount, 1, 1);
+    }
+    else
+    {
+        vk::Pipeline pipeline =
+            depthPrepass ? *m_pipelines.GraphicsAfterPrepass : *m_pipelines.Graphics;
+        if (debugView)
+        {
+            pipeline = m_pipelines.GraphicsDebugViews[static_cast<size_t>(m_debugView)];
+        }
+        m_commandBuffers[m_currentFrame].bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+
+        m_commandBuffers[m_currentFrame].bindVertexBuffers(0, {m_vertexBuffer}, {0});
+        m_commandBuffers[m_currentFrame].bindIndexBuffer(m_indexBuffer, 0, m_mesh.IndexType());
+
+        m_commandBuffers[m_currentFrame].bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics, m_pipelineLayout, 0,
+            {m_descriptorSets[m_currentFrame]}, {});
+
+        if (m_geometryPath == GeometryPath::CulledIndirect)
+        {
+            const uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+            m_commandBuffers[m_currentFrame].drawIndexedIndirect(
+                m_drawCommandBuffers[m_currentFrame], 0, lod.MeshletCount, stride);
+        }
+        else
+        {
+            const uint32_t indexCount = lod.IndexCount;
+            const uint32_t instanceCount = 1;
+            const uint32_t firstIndex = lod.FirstIndex;
+            const uint32_t vertexOffset = 0;
+            const uint32_t firstInstance = 0;
+            m_commandBuffers[m_currentFrame].drawIndexed(indexCount, instanceCount, firstIndex,
+                                                         vertexOffset, firstInstance);
+        }
+    }
 
-    const uint32_t indexCount = static_cast<uint32_t>(Indices.size());
+    m_commandBuffers[m_currentFrame].endRendering();
+
+    if (m_gpuTimestamps->IsSupported())
+    {
+        m_gpuTimestamps->Write(m_commandBuffers[m_currentFrame], m_currentFrame,
+                               SceneEndTimestamp, vk::PipelineStageFlagBits2::eBottomOfPipe);
+    }
+
+    if (upscaled)
+    {
+        RecordUpscale(imageIndex);
+    }
+
+    if (m_postProcessing)
+    {
+        // writes the swapchain image, and hands it on for presenting
+        RecordPostProcessing(imageIndex);
+    }
+    else if (m_frameCapture->IsCapturing())
+    {
+        RecordCapture(m_commandBuffers[m_currentFrame], imageIndex,
+                      vk::ImageLayout::eColorAttachmentOptimal,
+                      vk::AccessFlagBits2::eColorAttachmentWrite,
+                      vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+    }
+    else
+    {
+        // After rendering, transition the swapchain image to PRESENT_SRC
+        TransitionImageLayout(imageIndex, vk::ImageLayout::eColorAttachmentOptimal,
+                              vk::ImageLayout::ePresentSrcKHR,
+                              vk::AccessFlagBits2::eColorAttachmentWrite,         // srcAccessMask
+                              {},                                                 // dstAccessMask
+                              vk::PipelineStageFlagBits2::eColorAttachmentOutput, // srcStage
+                              vk::PipelineStageFlagBits2::eBottomOfPipe           // dstStage
+        );
+    }
+
+    if (m_gpuTimestamps->IsSupported())
+    {
+        m_gpuTimestamps->Write(m_commandBuffers[m_currentFrame], m_currentFrame,
+                               FrameEndTimestamp, vk::PipelineStageFlagBits2::eBottomOfPipe);
+    }
+
+    m_commandBuffers[m_currentFrame].end();
+}
+
+void Engine::RecordDepthPrepass()
+{
+    vk::raii::CommandBuffer &commandBuffer = m_commandBuffers[m_currentFrame];
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines.DepthPrepass);
+    commandBuffer.bindVertexBuffers(0, {m_positionBuffer}, {0});
+    commandBuffer.bindIndexBuffer(m_indexBuffer, 0, m_mesh.IndexType());
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pipelineLayout, 0,
+                                     {m_descriptorSets[m_currentFrame]}, {});
+
+    // the same triangles the scene draws next, or with mesh shaders, all of the LOD's,
+    // where the meshlets they cull would have been hidden anyway
+    const MeshLod lod = m_mesh.Lod(m_currentLod);
+    if (m_geometryPath == GeometryPath::CulledIndirect)
+    {
+        const uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+        commandBuffer.drawIndexedIndirect(m_drawCommandBuffers[m_currentFrame], 0,
+                                          lod.MeshletCount, stride);
+    }
+    else
+    {
+        const uint32_t instanceCount = 1;
+        const uint32_t vertexOffset = 0;
+        const uint32_t firstInstance = 0;
+        commandBuffer.drawIndexed(lod.IndexCount, instanceCount, lod.FirstIndex, vertexOffset,
+                                  firstInstance);
+    }
+}
+
+void Engine::RecordUpscale(uint32_t imageIndex)
+{
+    vk::raii::CommandBuffer &commandBuffer = m_commandBuffers[m_currentFrame];
+
+    TransitionImageLayout(*m_sceneColorImage, vk::ImageAspectFlagBits::eColor,
+                          vk::ImageLayout::eColorAttachmentOptimal,
+                          vk::ImageLayout::eShaderReadOnlyOptimal,
+                          vk::AccessFlagBits2::eColorAttachmentWrite,
+                          vk::AccessFlagBits2::eShaderSampledRead,
+                          vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                          vk::PipelineStageFlagBits2::eFragmentShader);
+
+    // every pixel of the output gets written
+    vk::RenderingAttachmentInfo attachmentInfo{m_swapchainImageViews[imageIndex],
+                                               vk::ImageLayout::eColorAttachmentOptimal,
+                                               vk::ResolveModeFlagBits::eNone,
+                                               {},
+                                               vk::ImageLayout::eUndefined,
+                                               vk::AttachmentLoadOp::eDontCare,
+                                               vk::AttachmentStoreOp::eStore};
+
+    const vk::Rect2D renderArea{{0, 0}, m_swapchainExtent};
+    const uint32_t layerCount = 1;
+    const uint32_t viewMask = 0;
+    vk::RenderingInfo renderingInfo = {{}, renderArea, layerCount, viewMask, {attachmentInfo}};
+
+    commandBuffer.beginRendering(renderingInfo);
+
+    commandBuffer.setViewport(0, vk::Viewport{0.0f, 0.0f,
+                                              static_cast<float>(m_swapchainExtent.width),
+                                              static_cast<float>(m_swapchainExtent.height),
+                                              0.0f, 1.0f});
+    commandBuffer.setScissor(0, renderArea);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines.Upscale);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_upscalePipelineLayout, 0,
+                                     {m_upscaleDescriptorSet}, {});
+
+    const glm::vec2 outputSize{m_swapchainExtent.width, m_swapchainExtent.height};
+    const UpscaleConstants constants{
+        glm::vec2{m_renderExtent.width, m_renderExtent.height} / outputSize, 1.0f / outputSize};
+    commandBuffer.pushConstants<UpscaleConstants>(m_upscalePipelineLayout,
+                                                  m_upscaleConstantStages, 0, constants);
+
+    const uint32_t vertexCount = 3;
+    commandBuffer.draw(vertexCount, 1, 0, 0);
+
+    commandBuffer.endRendering();
+}
+
+void Engine::RecordPostProcessing(uint32_t imageIndex)
+{
+    const vk::raii::CommandBuffer &graphics = m_commandBuffers[m_currentFrame];
+    const bool asyncCompute = !m_postCommandBuffers.empty();
+    const vk::raii::CommandBuffer &commandBuffer =
+        asyncCompute ? m_postCommandBuffers[m_currentFrame] : graphics;
+    const uint32_t graphicsFamily = m_queues->FamilyIndex(QueueType::Graphics);
+    const uint32_t computeFamily = m_queues->FamilyIndex(QueueType::Compute);
+
+    const uint32_t baseMipLevel = 0;
+    const uint32_t levelCount = 1;
+    const uint32_t baseArrayLayer = 0;
+    const uint32_t layerCount = 1;
+    const vk::ImageSubresourceRange subresourceRange{
+        vk::ImageAspectFlagBits::eColor, baseMipLevel, levelCount, baseArrayLayer, layerCount};
+
+    // the scene image never comes back, the next frame to render into it discards it
+    const OwnershipTransfer scene{graphicsFamily,
+                                  computeFamily,
+                                  vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                                  vk::AccessFlagBits2::eColorAttachmentWrite,
+                                  vk::PipelineStageFlagBits2::eComputeShader,
+                                  vk::AccessFlagBits2::eShaderSampledRead};
+    const vk::Image sceneImage = m_postProcessing->SceneImage(m_currentFrame);
+    scene.Release(graphics, sceneImage, subresourceRange, vk::ImageLayout::eColorAttachmentOptimal,
+                  vk::ImageLayout::eShaderReadOnlyOptimal);
+    if (asyncCompute)
+    {
+        commandBuffer.begin({});
+    }
+    scene.Acquire(commandBuffer, sceneImage, subresourceRange,
+                  vk::ImageLayout::eColorAttachmentOptimal,
+                  vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    const PostPipelines pipelines{m_pipelines.Tonemap, m_pipelines.Grade, m_pipelines.Sharpen,
+                                  m_postPipelineLayout, m_postConstantStages};
+    const vk::Image swapchainImage = m_swapchainImages[imageIndex];
+
+    if (m_postToSwapchain)
+    {
+        // every pixel of the output gets written
+        TransitionImageLayout(commandBuffer, swapchainImage, vk::ImageAspectFlagBits::eColor,
+                              vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, {},
+                              vk::AccessFlagBits2::eShaderStorageWrite,
+                              vk::PipelineStageFlagBits2::eComputeShader,
+                              vk::PipelineStageFlagBits2::eComputeShader);
+        m_postProcessing->Record(commandBuffer, m_currentFrame, imageIndex, m_renderExtent,
+                                 pipelines, m_settings.Exposure, m_settings.Sharpness);
+
+        if (m_frameCapture->IsCapturing())
+        {
+            RecordCapture(commandBuffer, imageIndex, vk::ImageLayout::eGeneral,
+                          vk::AccessFlagBits2::eShaderStorageWrite,
+                          vk::PipelineStageFlagBits2::eComputeShader);
+        }
+        else
+        {
+            TransitionImageLayout(commandBuffer, swapchainImage, vk::ImageAspectFlagBits::eColor,
+                                  vk::ImageLayout::eGeneral, vk::ImageLayout::ePresentSrcKHR,
+                                  vk::AccessFlagBits2::eShaderStorageWrite, {},
+                                  vk::PipelineStageFlagBits2::eComputeShader,
+                                  vk::PipelineStageFlagBits2::eBottomOfPipe);
+        }
+
+        if (asyncCompute)
+        {
+            commandBuffer.end();
+        }
+        return;
+    }
+
+    // the swapchain images can't be stored to, so the output gets blitted into them,
+    // on the graphics queue
+    m_postProcessing->Record(commandBuffer, m_currentFrame, 0, m_renderExtent, pipelines,
+                             m_settings.Exposure, m_settings.Sharpness);
+
+    const OwnershipTransfer output{computeFamily,
+                                   graphicsFamily,
+                                   vk::PipelineStageFlagBits2::eComputeShader,
+                                   vk::AccessFlagBits2::eShaderStorageWrite,
+                                   vk::PipelineStageFlagBits2::eBlit,
+                                   vk::AccessFlagBits2::eTransferRead};
+    const vk::Image outputImage = m_postProcessing->OutputImage();
+    output.Release(commandBuffer, outputImage, subresourceRange, vk::ImageLayout::eGeneral,
+                   vk::ImageLayout::eTransferSrcOptimal);
+    if (asyncCompute)
+    {
+        commandBuffer.end();
+    }
+
+    const vk::raii::CommandBuffer &composite =
+        asyncCompute ? m_compositeCommandBuffers[m_currentFrame] : graphics;
+    if (asyncCompute)
+    {
+        composite.begin({});
+    }
+    output.Acquire(composite, outputImage, subresourceRange, vk::ImageLayout::eGeneral,
+                   vk::ImageLayout::eTransferSrcOptimal);
+
+    TransitionImageLayout(composite, swapchainImage, vk::ImageAspectFlagBits::eColor,
+                          vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, {},
+                          vk::AccessFlagBits2::eTransferWrite, vk::PipelineStageFlagBits2::eBlit,
+                          vk::PipelineStageFlagBits2::eBlit);
+
+    const uint32_t mipLevel = 0;
+    const vk::ImageSubresourceLayers subresourceLayers{vk::ImageAspectFlagBits::eColor, mipLevel,
+                                                       baseArrayLayer, layerCount};
+    const std::array<vk::Offset3D, 2> bounds{
+        vk::Offset3D{0, 0, 0}, vk::Offset3D{static_cast<int32_t>(m_swapchainExtent.width),
+                                            static_cast<int32_t>(m_swapchainExtent.height), 1}};
+    // same size, the blit only converts the format
+    const vk::ImageBlit2 region{subresourceLayers, bounds, subresourceLayers, bounds};
+    composite.blitImage2(vk::BlitImageInfo2{outputImage, vk::ImageLayout::eTransferSrcOptimal,
+                                            swapchainImage, vk::ImageLayout::eTransferDstOptimal,
+                                            region, vk::Filter::eNearest});
+
+    if (m_frameCapture->IsCapturing())
+    {
+        RecordCapture(composite, imageIndex, vk::ImageLayout::eTransferDstOptimal,
+                      vk::AccessFlagBits2::eTransferWrite, vk::PipelineStageFlagBits2::eBlit);
+    }
+    else
+    {
+        TransitionImageLayout(composite, swapchainImage, vk::ImageAspectFlagBits::eColor,
+                              vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::ePresentSrcKHR,
+                              vk::AccessFlagBits2::eTransferWrite, {},
+                              vk::PipelineStageFlagBits2::eBlit,
+                              vk::PipelineStageFlagBits2::eBottomOfPipe);
+    }
+
+    if (asyncCompute)
+    {
+        composite.end();
+    }
+}
+
+void Engine::RecordShadows()
+{
+    ShadowCasterRecorder staticCasters{};
+    ShadowCasterRecorder dynamicCasters{};
+    if (m_settings.Shadows)
+    {
+        staticCasters = [this](const vk::raii::CommandBuffer &commandBuffer,
+                               const glm::mat4 &viewProj) {
+            RecordShadowCaster(commandBuffer, viewProj, true);
+        };
+        if (!m_scene.IsStatic(m_modelNode))
+        {
+            dynamicCasters = [this](const vk::raii::CommandBuffer &commandBuffer,
+                                    const glm::mat4 &viewProj) {
+                RecordShadowCaster(commandBuffer, viewProj, false);
+            };
+        }
+    }
+
+    // the model is the only caster
+    const glm::vec4 staticBounds = m_scene.IsStatic(m_modelNode)
+                                       ? m_scene.WorldBounds(m_modelNode)
+                                       : glm::vec4{0.0f, 0.0f, 0.0f, -1.0f};
+    m_shadowMaps->Record(m_commandBuffers[m_currentFrame], m_shadowCascades,
+                         m_scene.StaticVersion(), staticBounds, staticCasters, dynamicCasters);
+}
+
+void Engine::RecordShadowCaster(const vk::raii::CommandBuffer &commandBuffer,
+                                const glm::mat4 &viewProj, bool staticCasters)
+{
+    // casts shadows whether it is visible or not
+    if (m_scene.IsStatic(m_modelNode) != staticCasters)
+    {
+        return;
+    }
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines.Shadow);
+    commandBuffer.bindVertexBuffers(0, {m_positionBuffer}, {0});
+    commandBuffer.bindIndexBuffer(m_indexBuffer, 0, m_mesh.IndexType());
+
+    const glm::mat4 transform = viewProj * m_scene.WorldTransform(m_modelNode);
+    commandBuffer.pushConstants<glm::mat4>(m_shadowPipelineLayout, m_shadowConstantStages, 0,
+                                           transform);
+
+    // the cache outlives LOD changes, so it always gets the finest one
+    const MeshLod lod = m_mesh.Lod(staticCasters ? 0 : m_currentLod);
     const uint32_t instanceCount = 1;
-    const uint32_t firstIndex = 0;
     const uint32_t vertexOffset = 0;
     const uint32_t firstInstance = 0;
-    m_commandBuffers[m_currentFrame].drawIndexed(indexCount, instanceCount, firstIndex,
-                                                 vertexOffset, firstInstance);
+    commandBuffer.drawIndexed(lod.IndexCount, instanceCount, lod.FirstIndex, vertexOffset,
+                              firstInstance);
+}
 
-    m_commandBuffers[m_currentFrame].endRendering();
+void Engine::RecordLightClusters()
+{
+    const vk::raii::CommandBuffer &commandBuffer = m_commandBuffers[m_currentFrame];
+
+    // the clusters were last read by the frame before last, which the fence covered
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipelines.Clusters);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_clusterPipelineLayout, 0,
+                                     {m_clusterDescriptorSets[m_currentFrame]}, {});
+    commandBuffer.pushConstants<ClusterConstants>(m_clusterPipelineLayout,
+                                                  m_clusterConstantStages, 0, m_clusterConstants);
+
+    const uint32_t groupCount = (ClusterCount + ClusterGroupSize - 1) / ClusterGroupSize;
+    commandBuffer.dispatch(groupCount, 1, 1);
+
+    const vk::MemoryBarrier2 barrier{vk::PipelineStageFlagBits2::eComputeShader,
+                                     vk::AccessFlagBits2::eShaderStorageWrite,
+                                     vk::PipelineStageFlagBits2::eFragmentShader,
+                                     vk::AccessFlagBits2::eShaderStorageRead};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, barrier});
+}
 
-    // After rendering, transition the swapchain image to PRESENT_SRC
-    TransitionImageLayout(imageIndex, vk::ImageLayout::eColorAttachmentOptimal,
-                          vk::ImageLayout::ePresentSrcKHR,
-                          vk::AccessFlagBits2::eColorAttachmentWrite,         // srcAccessMask
-                          {},                                                 // dstAccessMask
-                          vk::PipelineStageFlagBits2::eColorAttachmentOutput, // srcStage
-                          vk::PipelineStageFlagBits2::eBottomOfPipe           // dstStage
-    );
+void Engine::RecordCapture(const vk::raii::CommandBuffer &commandBuffer, uint32_t imageIndex,
+                           vk::ImageLayout layout, vk::AccessFlags2 access,
+                           vk::PipelineStageFlags2 stage)
+{
+    const vk::Image image = m_swapchainImages[imageIndex];
+    TransitionImageLayout(commandBuffer, image, vk::ImageAspectFlagBits::eColor, layout,
+                          vk::ImageLayout::eTransferSrcOptimal, access,
+                          vk::AccessFlagBits2::eTransferRead, stage,
+                          vk::PipelineStageFlagBits2::eTransfer);
+
+    m_frameCapture->Record(commandBuffer, m_currentFrame, image, m_swapchainImageFormat.format,
+                           m_swapchainExtent);
+
+    TransitionImageLayout(commandBuffer, image, vk::ImageAspectFlagBits::eColor,
+                          vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::ePresentSrcKHR,
+                          {}, {}, vk::PipelineStageFlagBits2::eTransfer,
+                          vk::PipelineStageFlagBits2::eBottomOfPipe);
+}
 
-    m_commandBuffers[m_currentFrame].end();
+void Engine::RecordMeshletCulling()
+{
+    const bool asyncCompute = !m_computeCommandBuffers.empty();
+    vk::raii::CommandBuffer &commandBuffer =
+        asyncCompute ? m_computeCommandBuffers[m_currentFrame] : m_commandBuffers[m_currentFrame];
+    if (asyncCompute)
+    {
+        // the previous draw commands are overwritten, so the buffer needn't come back first
+        commandBuffer.begin({});
+    }
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipelines.Cull);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_meshletPipelineLayout, 0,
+                                     {m_meshletDescriptorSets[m_currentFrame]}, {});
+    commandBuffer.pushConstants<MeshletCullConstants>(
+        m_meshletPipelineLayout, m_cullConstantStages, 0, m_cullConstants);
+
+    const uint32_t groupCount = (m_cullConstants.MeshletCount + CullGroupSize - 1) / CullGroupSize;
+    commandBuffer.dispatch(groupCount, 1, 1);
+
+    // the draw commands are consumed by drawIndexedIndirect
+    const OwnershipTransfer drawCommands{m_queues->FamilyIndex(QueueType::Compute),
+                                         m_queues->FamilyIndex(QueueType::Graphics),
+                                         vk::PipelineStageFlagBits2::eComputeShader,
+                                         vk::AccessFlagBits2::eShaderStorageWrite,
+                                         vk::PipelineStageFlagBits2::eDrawIndirect,
+                                         vk::AccessFlagBits2::eIndirectCommandRead};
+    const vk::Buffer drawCommandBuffer = m_drawCommandBuffers[m_currentFrame];
+    drawCommands.Release(commandBuffer, drawCommandBuffer);
+    if (asyncCompute)
+    {
+        commandBuffer.end();
+    }
+    drawCommands.Acquire(m_commandBuffers[m_currentFrame], drawCommandBuffer);
+}
+
+void Engine::SubmitFrame(vk::Semaphore presentComplete, vk::Semaphore renderFinished)
+{
+    std::vector<QueueWait> waits{};
+    if (!m_transferCommandBuffers.empty())
+    {
+        const vk::CommandBuffer upload = m_transferCommandBuffers[m_currentFrame];
+        waits.push_back({QueueType::Transfer,
+                         m_queues->Submit(QueueType::Transfer, {&upload, 1}),
+                         vk::PipelineStageFlagBits2::eFragmentShader});
+    }
+    if (!m_computeCommandBuffers.empty())
+    {
+        // culling overlaps with whatever the graphics queue still works on
+        const vk::CommandBuffer cull = m_computeCommandBuffers[m_currentFrame];
+        waits.push_back({QueueType::Compute, m_queues->Submit(QueueType::Compute, {&cull, 1}),
+                         vk::PipelineStageFlagBits2::eDrawIndirect});
+    }
+
+    const vk::SemaphoreSubmitInfo presentWait{presentComplete, 0, SwapchainWaitStage()};
+    const vk::SemaphoreSubmitInfo renderSignal{renderFinished, 0,
+                                               vk::PipelineStageFlagBits2::eAllCommands};
+    const vk::CommandBuffer commandBuffer = m_commandBuffers[m_currentFrame];
+    if (m_postCommandBuffers.empty())
+    {
+        m_queues->Submit(QueueType::Graphics, {&commandBuffer, 1}, waits, {&presentWait, 1},
+                         {&renderSignal, 1}, m_inFlightFences[m_currentFrame]);
+        return;
+    }
+
+    // the next frame's scene can start on the graphics queue while this one gets post-processed
+    const QueueWait rendered{QueueType::Graphics,
+                             m_queues->Submit(QueueType::Graphics, {&commandBuffer, 1}, waits),
+                             vk::PipelineStageFlagBits2::eComputeShader};
+    const vk::CommandBuffer post = m_postCommandBuffers[m_currentFrame];
+    if (m_compositeCommandBuffers.empty())
+    {
+        // presented straight from the compute queue
+        m_queues->Submit(QueueType::Compute, {&post, 1}, {&rendered, 1}, {&presentWait, 1},
+                         {&renderSignal, 1}, m_inFlightFences[m_currentFrame]);
+        return;
+    }
+
+    const QueueWait processed{QueueType::Compute,
+                              m_queues->Submit(QueueType::Compute, {&post, 1}, {&rendered, 1}),
+                              vk::PipelineStageFlagBits2::eBlit};
+    const vk::CommandBuffer composite = m_compositeCommandBuffers[m_currentFrame];
+    m_queues->Submit(QueueType::Graphics, {&composite, 1}, {&processed, 1}, {&presentWait, 1},
+                     {&renderSignal, 1}, m_inFlightFences[m_currentFrame]);
+}
+
+vk::PipelineStageFlags2 Engine::SwapchainWaitStage() const
+{
+    if (!m_postProcessing)
+    {
+        return vk::PipelineStageFlagBits2::eColorAttachmentOutput;
+    }
+
+    return m_postToSwapchain ? vk::PipelineStageFlagBits2::eComputeShader
+                             : vk::PipelineStageFlagBits2::eBlit;
 }
 
 void Engine::CreateSyncObjects()
@@ -1173,26 +3237,104 @@ void Engine::CreateSyncObjects()
     }
 }
 
-void Engine::UpdateUniformBuffer(uint32_t currentImage)
+void Engine::UpdateScene()
 {
     static auto startTime = std::chrono::high_resolution_clock::now();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
-    float time =
+    const float clockTime =
         std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    const float time = m_settings.AnimationTime.value_or(clockTime);
 
+    m_scene.SetLocalTransform(m_modelNode, glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f),
+                                                       glm::vec3(0.0f, 0.0f, 1.0f)));
+
+    m_view = lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+                    glm::vec3(0.0f, 0.0f, 1.0f));
+    m_proj = glm::perspective(glm::radians(45.0f),
+                              static_cast<float>(m_swapchainExtent.width) /
+                                  static_cast<float>(m_swapchainExtent.height),
+                              NearPlane, FarPlane);
+    m_proj[1][1] *= -1; // !!! correct for vulkan's inverted y-axis !!!
+
+    m_scene.UpdateWorldTransforms(m_jobs);
+    m_scene.CullFrustum(FrustumPlanes(m_proj * m_view), m_jobs);
+
+    AnimateLights(m_lights, time);
+
+    if (m_settings.Shadows)
+    {
+        m_shadowCascades = FitShadowCascades(m_view, m_proj, NearPlane, FarPlane, ShadowDistance,
+                                             SunDirection, ShadowDepthReach,
+                                             ShadowMapResolution);
+    }
+}
+
+void Engine::UpdateUniformBuffer(uint32_t currentImage)
+{
     UniformBufferObject ubo{};
-    ubo.model =
-        glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    ubo.view = lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f),
-                      glm::vec3(0.0f, 0.0f, 1.0f));
-    ubo.proj = glm::perspective(glm::radians(45.0f),
-                                static_cast<float>(m_swapchainExtent.width) /
-                                    static_cast<float>(m_swapchainExtent.height),
-                                0.1f, 10.0f);
-    ubo.proj[1][1] *= -1; // !!! correct for vulkan's inverted y-axis !!!
+    ubo.model = m_scene.WorldTransform(m_modelNode);
+    ubo.view = m_view;
+    ubo.proj = m_proj;
+    ubo.shadowTransforms = m_shadowCascades.AtlasTransforms;
+    ubo.shadowSplits = m_shadowCascades.Splits;
+    ubo.clusterLookup = ClusterLookup(ubo.proj, m_renderExtent);
+
+    m_currentLod = SelectLod(ubo.view * ubo.model, ubo.proj);
+    // scaled like areas get by the model's transform
+    const float areaScale =
+        std::pow(std::abs(glm::determinant(glm::mat3{ubo.model})), 2.0f / 3.0f);
+    ubo.triangleArea = m_lodTriangleAreas[m_currentLod] * areaScale;
 
     memcpy(m_uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+
+    // the frame's fence has been waited for, so its slot of the ring is no longer read
+    std::ranges::copy(m_lights, m_lightClusters->Lights(currentImage).begin());
+    m_clusterConstants = ClusterConstants::Create(ubo.view, ubo.proj,
+                                                  static_cast<uint32_t>(m_lights.size()));
+
+    m_cullConstants =
+        MeshletCullConstants::Create(ubo.model, ubo.view, ubo.proj, m_mesh.Lod(m_currentLod));
+
+    if (m_scene.IsVisible(m_modelNode))
+    {
+        // the texture is assumed to stretch across the mesh
+        const float projectedSize =
+            2.0f * m_mesh.BoundsRadius * PixelsPerUnit(ubo.view * ubo.model, ubo.proj);
+        m_textureManager->Request(m_texture, projectedSize, m_frameNumber);
+    }
+}
+
+// Screen pixels per object space unit, at the closest point of the mesh's bounding sphere.
+float Engine::PixelsPerUnit(const glm::mat4 &modelView, const glm::mat4 &proj) const
+{
+    const float scale = std::max({glm::length(glm::vec3{modelView[0]}),
+                                  glm::length(glm::vec3{modelView[1]}),
+                                  glm::length(glm::vec3{modelView[2]})});
+
+    // distance to the closest point of the bounding sphere, in view space
+    const glm::vec4 center = modelView * glm::vec4{m_mesh.BoundsCenter, 1.0f};
+    const float distance = std::max(-center.z - m_mesh.BoundsRadius * scale, NearPlane);
+
+    return scale * std::abs(proj[1][1]) * 0.5f * static_cast<float>(m_renderExtent.height) /
+           distance;
+}
+
+uint32_t Engine::SelectLod(const glm::mat4 &modelView, const glm::mat4 &proj) const
+{
+    const float pixelsPerUnit = PixelsPerUnit(modelView, proj);
+
+    uint32_t lod = 0;
+    for (uint32_t level = 1; level < m_mesh.LodCount(); ++level)
+    {
+        if (m_mesh.Lod(level).Error * pixelsPerUnit > LodPixelError)
+        {
+            break;
+        }
+        lod = level;
+    }
+
+    return lod;
 }
 
 } // namespace vkstart
\ No newline at end of file
@@ -2,38 +2,235 @@
 
 #include "stdafx.h"
 
+#include "AttachmentUsage.h"
+#include "BuiltinScenes.h"
 #include "DebugMessenger.h"
+#include "DeletionQueue.h"
+#include "DepthPrepass.h"
+#include "DeviceQueues.h"
+#include "DeviceSelection.h"
+#include "FrameCapture.h"
+#include "GpuTimestamps.h"
 #include "IWindow.h"
+#include "JobSystem.h"
+#include "LightClusters.h"
+#include "Mesh.h"
+#include "MeshletCulling.h"
+#include "PostProcessing.h"
 #include "QueueFamilyIndices.h"
+#include "ResolutionScaler.h"
+#include "Scene.h"
+#include "ShaderReflection.h"
+#include "ShaderVariant.h"
+#include "ShaderWatcher.h"
+#include "ShadowMaps.h"
+#include "StartupTimer.h"
+#include "TextureManager.h"
+#include "VirtualFileSystem.h"
 
 namespace vkstart
 {
 
+enum class GeometryPath
+{
+    // one indexed draw of the whole LOD
+    Vertex,
+
+    // meshlets culled by a compute pass into indirect draws
+    CulledIndirect,
+
+    // meshlets culled in task shaders and drawn by mesh shaders
+    MeshShader,
+};
+
+// What the model's fragments show instead of their shading, to find where the GPU time
+// goes. See shader.slang.
+enum class DebugView
+{
+    None,
+
+    // how many fragments get shaded per pixel, additively, darker red to white
+    Overdraw,
+
+    // triangles per pixel of the drawn LOD, blue at 1/64 or fewer to red at one or more
+    TriangleDensity,
+
+    // mip level the texture gets sampled at, blue for the finest to red for the eighth
+    MipLevel,
+};
+
+constexpr uint32_t DebugViewCount = 4;
+
+struct EngineSettings
+{
+    // Index or UUID of the physical device to use, see `MatchesDeviceSelection`, instead of
+    // the best rated one. The environment variable `PhysicalDeviceVariable` overrides it.
+    std::string PhysicalDevice;
+
+    // MSAA samples per pixel, 1 (off), 2, 4 or 8; clamped to what the device supports
+    uint32_t SampleCount = 4;
+
+    // Fraction of the window's resolution the scene gets rendered at, from 0.5 to 1,
+    // and then upscaled. At 1, the scene goes straight into the swapchain image.
+    float RenderScale = 1.0f;
+    // Adjusts the render scale to keep the GPU frame time within `TargetFrameTime`.
+    bool DynamicResolution = false;
+    // In milliseconds.
+    float TargetFrameTime = 1000.0f / 60.0f;
+    // Edge-aware upscaling instead of bilinear.
+    bool EdgeAwareUpscale = true;
+
+    // Renders the scene in HDR, then tonemaps, grades and sharpens it in compute passes,
+    // on the async compute queue where there is one. The sharpening does the upscaling.
+    bool PostProcessing = true;
+    float Exposure = 1.0f;
+    // 0 (off) to 1
+    float Sharpness = 0.3f;
+    // Asset name of a .cube file to grade with, see `ParseCubeLut`; none leaves colors as they are.
+    std::string ColorLut;
+
+    // Cascaded shadows of a directional light. The static nodes' shadows get cached, see
+    // `ShadowMaps`.
+    bool Shadows = true;
+
+    // Point lights orbiting the scene, up to MaxLights, each fragment shaded with just the
+    // ones of its cluster, see `LightClusters`.
+    uint32_t LightCount = 1024;
+
+    // A depth-only pass over the scene's geometry first, so that the scene's fragments get
+    // shaded at most once per pixel. Never with GeometryPath::MeshShader.
+    DepthPrepassMode DepthPrepass = DepthPrepassMode::Auto;
+
+    DebugView Debug = DebugView::None;
+
+    BuiltinScene Scene = BuiltinScene::Quads;
+    // Seconds into the scene's animation that every frame shows, instead of following
+    // the clock, so that frames can be reproduced.
+    std::optional<float> AnimationTime;
+};
+
 struct Engine
 {
-    Engine(PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr, IWindow *window);
+    Engine(PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr, IWindow *window,
+           const EngineSettings &settings = {});
+
+    // the job system's workers and the texture manager point back into the engine
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
 
     void DrawFrame();
     void PixelSizeChanged();
     void WaitIdle();
 
+    // Fixes the render scale, see `EngineSettings::RenderScale`, which ends dynamic resolution.
+    void SetRenderScale(float scale);
+    void SetDynamicResolution(bool dynamic);
+    void SetDepthPrepass(DepthPrepassMode mode);
+    // Every view's pipelines are there from the start, so switching takes effect right away.
+    void SetDebugView(DebugView view);
+
+    // Captures the next frame that gets presented, without waiting for it.
+    // `WaitIdle` waits for the captures to be written.
+    void CaptureFrame(const std::filesystem::path &path, CaptureFormat format = CaptureFormat::Png);
+    void CaptureFrame(CaptureCallback callback);
+
+    // GPU time of one of the post-processing effects in a recent frame, in milliseconds.
+    // Nothing without post-processing, or where the queue it runs on has no timestamps.
+    std::optional<double> PostEffectTime(PostEffect effect) const;
+
   private:
+    // Built from the shaders, and replaced as a whole when they get hot-reloaded.
+    struct ShaderPipelines
+    {
+        vk::raii::Pipeline Graphics = nullptr;
+        vk::raii::Pipeline MeshShader = nullptr;
+        // the same, testing for the depths of the pre-pass without writing any
+        vk::raii::Pipeline GraphicsAfterPrepass = nullptr;
+        vk::raii::Pipeline DepthPrepass = nullptr;
+        // by DebugView, with nothing for None
+        std::vector<vk::raii::Pipeline> GraphicsDebugViews;
+        std::vector<vk::raii::Pipeline> MeshShaderDebugViews;
+        vk::raii::Pipeline Cull = nullptr;
+        vk::raii::Pipeline Upscale = nullptr;
+        vk::raii::Pipeline Tonemap = nullptr;
+        vk::raii::Pipeline Grade = nullptr;
+        vk::raii::Pipeline Sharpen = nullptr;
+        vk::raii::Pipeline Shadow = nullptr;
+        vk::raii::Pipeline Clusters = nullptr;
+    };
+
+    // SPIR-V by asset name
+    using ShaderCode = std::unordered_map<std::string, std::vector<char>>;
+
+    // Everything from disk the engine starts with, loaded and decoded on jobs while the
+    // device gets created. Each job writes only its own part.
+    struct StartupAssets
+    {
+        ShaderCode Shaders;
+
+        uint32_t TextureWidth = 0;
+        uint32_t TextureHeight = 0;
+        // 8-bit sRGB RGBA
+        std::vector<uint8_t> TexturePixels;
+
+        // with LODs and bounds, but no meshlets, which depend on the device
+        Mesh SceneMesh;
+
+        ColorLut Lut;
+
+        // one per job, rethrown once they are all done
+        std::deque<std::exception_ptr> Errors;
+    };
+
     void CreateInstance();
     void SetupDebugMessenger();
     void PickPhysicalDevice();
     void CreateDevice();
-    void CreateSwapChain();
-    void CleanupSwapChain();
+    void CreateSwapChain(vk::SwapchainKHR oldSwapchain = nullptr);
     void ReCreateSwapChain();
+    void ReleaseCompletedFrames();
+    void ReloadShaders();
     void CreateImageViews();
     vk::raii::ShaderModule CreateShaderModule(const std::vector<char> &code) const;
     void CreateDescriptorSetLayout();
-    void CreateGraphicsPipeline();
+    void CreateMeshletLayouts();
+    void CreateUpscaleLayout();
+    void LoadStartupAssets(StartupTimer &timer, StartupAssets &assets, JobCounter &loading);
+    void SubmitStartupJob(StartupTimer &timer, StartupAssets &assets, std::string name,
+                          std::function<void()> job, JobCounter &loading);
+    ShaderPipelines CreatePipelines(const ShaderCode &shaderCode) const;
+    vk::raii::Pipeline CreateMeshShaderPipeline(
+        const ShaderCode &shaderCode, const vk::PipelineShaderStageCreateInfo &fragmentStage,
+        vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo>
+            createInfos) const;
+    vk::raii::Pipeline CreateDepthPrepassPipeline(
+        const vk::raii::ShaderModule &shaderModule,
+        vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo>
+            createInfos) const;
+    void CreateDebugViewPipelines(
+        ShaderPipelines &pipelines, const ShaderCode &shaderCode,
+        const vk::PipelineShaderStageCreateInfo &vertexStage,
+        const vk::PipelineShaderStageCreateInfo &fragmentStage,
+        const vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo>
+            &createInfos) const;
+    vk::raii::Pipeline CreateCullPipeline(const ShaderCode &shaderCode) const;
+    vk::raii::Pipeline CreateUpscalePipeline(const ShaderCode &shaderCode) const;
+    vk::raii::Pipeline CreatePostPipeline(const ShaderCode &shaderCode,
+                                          const char *entryPoint) const;
+    vk::raii::Pipeline CreateShadowPipeline(const ShaderCode &shaderCode) const;
+    vk::raii::Pipeline CreateClusterPipeline(const ShaderCode &shaderCode) const;
     void CreateCommandPool();
+    const vk::raii::CommandPool &CommandPool(QueueType queue) const;
 
     vk::raii::ImageView CreateImageView(vk::raii::Image &image, vk::Format format,
                                         vk::ImageAspectFlags aspectFlags) const;
 
+    void TransitionImageLayout(const vk::raii::CommandBuffer &commandBuffer, vk::Image image,
+                               vk::ImageAspectFlags aspectMask, vk::ImageLayout oldLayout,
+                               vk::ImageLayout newLayout, vk::AccessFlags2 srcAccessMask,
+                               vk::AccessFlags2 dstAccessMask,
+                               vk::PipelineStageFlags2 srcStageMask,
+                               vk::PipelineStageFlags2 dstStageMask);
     void TransitionImageLayout(vk::Image image, vk::ImageAspectFlags aspectMask,
                                vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
                                vk::AccessFlags2 srcAccessMask, vk::AccessFlags2 dstAccessMask,
@@ -49,42 +246,106 @@ struct Engine
     vk::Format FindSupportedFormat(const std::vector<vk::Format> &candidates,
                                    vk::ImageTiling tiling, vk::FormatFeatureFlags features);
     vk::Format FindDepthFormat();
+    vk::SampleCountFlagBits ChooseSampleCount(uint32_t requested) const;
     bool HasStencilComponent(vk::Format format);
+    void CreateColorResources();
+    void CreateSceneColorResources();
     void CreateDepthResources();
 
-    vk::raii::CommandBuffer BeginSingleTimeCommands();
-    void EndSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer);
+    vk::raii::CommandBuffer BeginSingleTimeCommands(QueueType queue = QueueType::Graphics);
+    // returns the value to wait for on `queue`'s timeline
+    uint64_t SubmitSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer,
+                                      QueueType queue = QueueType::Graphics,
+                                      std::span<const QueueWait> waits = {});
+    void EndSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer,
+                               QueueType queue = QueueType::Graphics,
+                               std::span<const QueueWait> waits = {});
 
     void CopyBufferToImage(const vk::raii::Buffer &buffer, vk::raii::Image &image, uint32_t width,
                            uint32_t height);
-    void CreateImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling,
+    void CreateImage(uint32_t width, uint32_t height, vk::Format format,
+                     vk::SampleCountFlagBits samples, vk::ImageTiling tiling,
                      vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties,
                      vk::raii::Image &image, vk::raii::DeviceMemory &imageMemory);
-    void CreateTextureImage();
+    void CreateTextureImage(uint32_t width, uint32_t height, const uint8_t *pixels);
     void CreateTextureSampler();
-
-    void CreateTextureImageView();
+    void UpdateTextureDescriptor();
 
     uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
-    void CopyBuffer(vk::raii::Buffer &srcBuffer, vk::raii::Buffer &dstBuffer, vk::DeviceSize size);
+    bool HasMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+    // copies on the transfer queue, and hands `dstBuffer` over to `consumer`
+    void CopyBuffer(vk::raii::Buffer &srcBuffer, vk::raii::Buffer &dstBuffer, vk::DeviceSize size,
+                    QueueType consumer = QueueType::Graphics);
     void CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
                       vk::MemoryPropertyFlags properties, vk::raii::Buffer &buffer,
                       vk::raii::DeviceMemory &bufferMemory);
+    void CreateDeviceLocalBuffer(const void *data, vk::DeviceSize size,
+                                 vk::BufferUsageFlags usage, vk::raii::Buffer &buffer,
+                                 vk::raii::DeviceMemory &bufferMemory,
+                                 QueueType consumer = QueueType::Graphics);
+    void LoadMesh(Mesh mesh);
+    void CreateScene();
     void CreateVertexBuffer();
     void CreateIndexBuffer();
+    void CreatePositionBuffer();
+    void CreateMeshletBuffers();
 
     void CreateUniformBuffers();
     void CreateDescriptorPool();
     void CreateDescriptorSets();
+    void CreateMeshletDescriptorSets();
+    void CreateUpscaleSampler();
+    void CreateUpscaleDescriptorSet();
+    void CreatePostLayout();
+    void CreateShadowLayout();
+    void CreateShadowMaps();
+    void CreateClusterLayout();
+    void CreateLightClusters();
+    void CreateClusterDescriptorSets();
+    void CreatePostProcessing(const ColorLut &lut);
+    void ResizePostProcessing();
 
     void CreateCommandBuffer();
     void RecordCommandBuffer(uint32_t imageIndex);
+    // on the compute queue when there is a dedicated one, see m_computeCommandBuffers
+    void RecordMeshletCulling();
+    // submits whatever got recorded for the frame; its last submission signals the fence
+    void SubmitFrame(vk::Semaphore presentComplete, vk::Semaphore renderFinished);
+    // where the frame's first use of the swapchain image waits for it to be acquired
+    vk::PipelineStageFlags2 SwapchainWaitStage() const;
+    void RecordUpscale(uint32_t imageIndex);
+    // within the scene's rendering, before the model gets drawn
+    void RecordDepthPrepass();
+    void RecordShadows();
+    // bins the frame's lights, before the rendering that shades with them
+    void RecordLightClusters();
+    // draws the model into a cascade, if it is static or dynamic as asked for
+    void RecordShadowCaster(const vk::raii::CommandBuffer &commandBuffer,
+                            const glm::mat4 &viewProj, bool staticCasters);
+    // Runs after the scene, on the compute queue if it is a dedicated one, see SubmitFrame.
+    void RecordPostProcessing(uint32_t imageIndex);
+    // copies the swapchain image for m_frameCapture, and transitions it for presenting;
+    // `layout`, `access` and `stage` are how the image was last written
+    void RecordCapture(const vk::raii::CommandBuffer &commandBuffer, uint32_t imageIndex,
+                       vk::ImageLayout layout, vk::AccessFlags2 access,
+                       vk::PipelineStageFlags2 stage);
     void CreateSyncObjects();
 
+    void UpdateRenderResolution();
+    bool HasDepthPrepass() const;
+    void UpdateDepthPrepass();
+    void UpdateScene();
     void UpdateUniformBuffer(uint32_t currentImage);
+    float PixelsPerUnit(const glm::mat4 &modelView, const glm::mat4 &proj) const;
+    uint32_t SelectLod(const glm::mat4 &modelView, const glm::mat4 &proj) const;
 
     vk::raii::Context m_context;
     IWindow *m_window;
+    EngineSettings m_settings;
+    // the scene's material, and the variant of shader.slang it gets drawn with
+    MaterialFeatures m_material;
+    std::string m_modelShader;
+    VirtualFileSystem m_assets;
     vk::raii::Instance m_instance = nullptr;
 
     std::unique_ptr<DebugMessenger> m_debugMessenger = nullptr;
@@ -95,41 +356,152 @@ struct Engine
     QueueFamilyIndices m_queueFamilyIndices;
 
     vk::raii::Device m_device = nullptr;
+    std::unordered_set<std::string> m_optionalDeviceExtensions;
+    GeometryPath m_geometryPath = GeometryPath::Vertex;
 
     vk::raii::SwapchainKHR m_swapchain = nullptr;
     vk::SurfaceFormatKHR m_swapchainImageFormat;
     vk::Extent2D m_swapchainExtent;
     std::vector<vk::Image> m_swapchainImages;
     std::vector<vk::raii::ImageView> m_swapchainImageViews;
-
-    vk::raii::DescriptorSetLayout m_descriptorSetLayout = nullptr;
-    vk::raii::PipelineLayout m_pipelineLayout = nullptr;
-    vk::raii::Pipeline m_graphicsPipeline = nullptr;
+    // whether the surface allows copying from the swapchain images
+    bool m_swapchainCapturable = false;
+    // whether post-processing writes straight into the swapchain images, as storage images
+    bool m_postToSwapchain = false;
+    // of the scene's color attachments, HDR with post-processing
+    vk::Format m_sceneColorFormat = vk::Format::eUndefined;
+
+    // owns the layouts below, built from what the shaders declare
+    ShaderLayoutCache m_layouts{m_device};
+
+    vk::DescriptorSetLayout m_descriptorSetLayout;
+    vk::PipelineLayout m_pipelineLayout;
+
+    vk::DescriptorSetLayout m_meshletDescriptorSetLayout;
+    vk::PipelineLayout m_meshletPipelineLayout;
+    vk::ShaderStageFlags m_cullConstantStages;
+
+    vk::DescriptorSetLayout m_upscaleDescriptorSetLayout;
+    vk::PipelineLayout m_upscalePipelineLayout;
+    vk::ShaderStageFlags m_upscaleConstantStages;
+    vk::DescriptorSetLayout m_postDescriptorSetLayout;
+    vk::PipelineLayout m_postPipelineLayout;
+    vk::ShaderStageFlags m_postConstantStages;
+    vk::PipelineLayout m_shadowPipelineLayout;
+    vk::ShaderStageFlags m_shadowConstantStages;
+    vk::DescriptorSetLayout m_clusterDescriptorSetLayout;
+    vk::PipelineLayout m_clusterPipelineLayout;
+    vk::ShaderStageFlags m_clusterConstantStages;
+
+    ShaderCode m_shaderCode;
+    ShaderPipelines m_pipelines;
+    // only with VKSTART_SHADER_HOT_RELOAD
+    std::unique_ptr<ShaderWatcher> m_shaderWatcher;
+    // written by the rebuild job, swapped in by the frame that finds it done
+    std::optional<ShaderPipelines> m_rebuiltPipelines;
+    JobCounter m_pipelineRebuild;
 
     vk::raii::DescriptorPool m_descriptorPool = nullptr;
     std::vector<vk::raii::DescriptorSet> m_descriptorSets;
+    std::vector<vk::raii::DescriptorSet> m_meshletDescriptorSets;
+    std::vector<vk::raii::DescriptorSet> m_clusterDescriptorSets;
 
     vk::raii::CommandPool m_commandPool = nullptr;
+    // only with dedicated families, see CommandPool()
+    vk::raii::CommandPool m_computeCommandPool = nullptr;
+    vk::raii::CommandPool m_transferCommandPool = nullptr;
+
+    vk::SampleCountFlagBits m_sampleCount = vk::SampleCountFlagBits::e1;
+
+    // multisampled, resolved into the swapchain image; only with MSAA
+    vk::raii::Image m_colorImage = nullptr;
+    vk::raii::DeviceMemory m_colorImageMemory = nullptr;
+    vk::raii::ImageView m_colorImageView = nullptr;
+
+    ResolutionScaler m_resolutionScaler;
+    // what the scene gets rendered at, in the top left corner of the attachments
+    vk::Extent2D m_renderExtent;
+    std::unique_ptr<GpuTimestamps> m_gpuTimestamps;
+
+    DepthPrepassSelector m_depthPrepass;
+    // per frame in flight, whether its scene pass had the pre-pass
+    std::vector<uint8_t> m_depthPrepassUsed;
+    DebugView m_debugView = DebugView::None;
+
+    // the scene when it gets upscaled, sized like the swapchain
+    vk::raii::Image m_sceneColorImage = nullptr;
+    vk::raii::DeviceMemory m_sceneColorImageMemory = nullptr;
+    vk::raii::ImageView m_sceneColorImageView = nullptr;
+    vk::raii::Sampler m_upscaleSampler = nullptr;
+    vk::raii::DescriptorSet m_upscaleDescriptorSet = nullptr;
+
+    // only with EngineSettings::PostProcessing, which replaces the upscaling above
+    std::unique_ptr<PostProcessing> m_postProcessing;
+
+    // tiny, and never drawn into, without EngineSettings::Shadows
+    std::unique_ptr<ShadowMaps> m_shadowMaps;
+    ShadowCascades m_shadowCascades{};
+
+    std::unique_ptr<LightClusters> m_lightClusters;
+    // animated along with the scene, then copied into the frame's slot of the ring
+    std::vector<PointLight> m_lights;
+    ClusterConstants m_clusterConstants{};
 
     vk::raii::Image m_depthImage = nullptr;
     vk::raii::DeviceMemory m_depthImageMemory = nullptr;
     vk::raii::ImageView m_depthImageView = nullptr;
 
-    vk::raii::Image m_textureImage = nullptr;
-    vk::raii::DeviceMemory m_textureImageMemory = nullptr;
-    vk::raii::ImageView m_textureImageView = nullptr;
+    std::unique_ptr<TextureManager> m_textureManager;
+    TextureHandle m_texture = 0;
     vk::raii::Sampler m_textureSampler = nullptr;
+    // per frame in flight, what its descriptor set currently points to
+    std::vector<vk::ImageView> m_boundTextureViews;
+
+    Mesh m_mesh;
+    // per LOD, see Mesh::MeanTriangleArea
+    std::vector<float> m_lodTriangleAreas;
+
+    JobSystem m_jobs;
+    // encodes on m_jobs
+    std::unique_ptr<FrameCapture> m_frameCapture;
+    Scene m_scene;
+    uint32_t m_modelNode = NoParent;
+    glm::mat4 m_view{1.0f};
+    glm::mat4 m_proj{1.0f};
 
     vk::raii::Buffer m_vertexBuffer = nullptr;
     vk::raii::DeviceMemory m_vertexBufferMemory = nullptr;
     vk::raii::Buffer m_indexBuffer = nullptr;
     vk::raii::DeviceMemory m_indexBufferMemory = nullptr;
+    // just the positions of the vertices, for the depth-only passes
+    vk::raii::Buffer m_positionBuffer = nullptr;
+    vk::raii::DeviceMemory m_positionBufferMemory = nullptr;
+
+    vk::raii::Buffer m_meshletBuffer = nullptr;
+    vk::raii::DeviceMemory m_meshletBufferMemory = nullptr;
+    vk::raii::Buffer m_meshletVertexBuffer = nullptr;
+    vk::raii::DeviceMemory m_meshletVertexBufferMemory = nullptr;
+    vk::raii::Buffer m_meshletTriangleBuffer = nullptr;
+    vk::raii::DeviceMemory m_meshletTriangleBufferMemory = nullptr;
+
+    std::vector<vk::raii::Buffer> m_drawCommandBuffers;
+    std::vector<vk::raii::DeviceMemory> m_drawCommandBuffersMemory;
+
+    MeshletCullConstants m_cullConstants{};
 
     std::vector<vk::raii::Buffer> m_uniformBuffers;
     std::vector<vk::raii::DeviceMemory> m_uniformBuffersMemory;
     std::vector<void *> m_uniformBuffersMapped;
 
     std::vector<vk::raii::CommandBuffer> m_commandBuffers;
+    // per frame in flight, for the dedicated queues; the graphics submission waits for them,
+    // so the in-flight fences cover them too
+    std::vector<vk::raii::CommandBuffer> m_computeCommandBuffers;
+    std::vector<vk::raii::CommandBuffer> m_transferCommandBuffers;
+    // with post-processing on the dedicated compute queue, the post-processing, and the
+    // graphics work after it, when its output doesn't go straight to the swapchain
+    std::vector<vk::raii::CommandBuffer> m_postCommandBuffers;
+    std::vector<vk::raii::CommandBuffer> m_compositeCommandBuffers;
 
     std::vector<vk::raii::Semaphore> m_presentCompleteSemaphores;
     std::vector<vk::raii::Semaphore> m_renderFinishedSemaphores;
@@ -137,8 +509,13 @@ struct Engine
 
     uint32_t m_currentFrame = 0;
     uint32_t m_currentImage = 0;
+    uint64_t m_frameNumber = 0;
+
+    // keyed by m_frameNumber
+    DeletionQueue m_deletionQueue;
+    uint32_t m_currentLod = 0;
 
-    vk::raii::Queue m_graphicsQueue = nullptr;
+    std::unique_ptr<DeviceQueues> m_queues;
     vk::raii::Queue m_presentQueue = nullptr;
 
     bool m_pixelSizeChanged = false;
@@ -0,0 +1,255 @@
+#include "FrameCapture.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+namespace vkstart
+{
+
+constexpr uint32_t TexelSize = 4;
+
+static bool IsBgra(vk::Format format)
+{
+    return format == vk::Format::eB8G8R8A8Srgb || format == vk::Format::eB8G8R8A8Unorm;
+}
+
+FrameCapture::FrameCapture(const vk::raii::PhysicalDevice &physicalDevice,
+                           const vk::raii::Device &device, JobSystem &jobs, uint32_t bufferCount)
+    : m_physicalDevice{physicalDevice}, m_device{device}, m_jobs{jobs}
+{
+    // the buffers only get allocated by the first capture that needs them
+    for (uint32_t i = 0; i < bufferCount; ++i)
+    {
+        m_buffers.push_back(std::make_unique<ReadbackBuffer>());
+    }
+}
+
+FrameCapture::~FrameCapture()
+{
+    Wait();
+}
+
+bool FrameCapture::IsFormatSupported(vk::Format format)
+{
+    return IsBgra(format) || format == vk::Format::eR8G8B8A8Srgb ||
+           format == vk::Format::eR8G8B8A8Unorm;
+}
+
+void FrameCapture::Request(CaptureCallback callback)
+{
+    m_requests.push_back(std::move(callback));
+}
+
+void FrameCapture::Request(const std::filesystem::path &path, CaptureFormat format)
+{
+    Request([path, format](CapturedImage image) {
+        try
+        {
+            Save(image, path, format);
+        }
+        catch (const std::exception &e)
+        {
+            SDL_Log("frame capture: %s", e.what());
+        }
+    });
+}
+
+bool FrameCapture::IsCapturing() const
+{
+    // without a free buffer, the request waits for a later frame
+    return !m_requests.empty() && FreeBuffer();
+}
+
+void FrameCapture::Record(const vk::raii::CommandBuffer &commandBuffer, uint32_t frame,
+                          vk::Image image, vk::Format format, vk::Extent2D extent)
+{
+    ReadbackBuffer *buffer = FreeBuffer();
+    if (m_requests.empty() || !buffer)
+    {
+        return;
+    }
+    if (!IsFormatSupported(format))
+    {
+        throw std::runtime_error{"frame capture doesn't support the image format"};
+    }
+
+    const vk::DeviceSize size =
+        static_cast<vk::DeviceSize>(extent.width) * extent.height * TexelSize;
+    if (buffer->Size < size)
+    {
+        Allocate(*buffer, size);
+    }
+
+    const uint32_t bufferOffset = 0;
+    const uint32_t bufferRowLength = 0;
+    const uint32_t bufferImageHeight = 0;
+    vk::BufferImageCopy region{bufferOffset,
+                               bufferRowLength,
+                               bufferImageHeight,
+                               {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                               {0, 0, 0},
+                               {extent.width, extent.height, 1}};
+    commandBuffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, buffer->Buffer,
+                                    {region});
+
+    vk::MemoryBarrier2 barrier{vk::PipelineStageFlagBits2::eTransfer,
+                               vk::AccessFlagBits2::eTransferWrite,
+                               vk::PipelineStageFlagBits2::eHost, vk::AccessFlagBits2::eHostRead};
+    vk::DependencyInfo dependencyInfo = {{}, {barrier}, {}, {}};
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+
+    buffer->Frame = frame;
+    buffer->Format = format;
+    buffer->Extent = extent;
+    buffer->Callback = std::move(m_requests.front());
+    buffer->State = BufferState::Recorded;
+    m_requests.pop_front();
+}
+
+void FrameCapture::Complete(uint32_t frame)
+{
+    for (const std::unique_ptr<ReadbackBuffer> &buffer : m_buffers)
+    {
+        if (buffer->State == BufferState::Recorded && buffer->Frame == frame)
+        {
+            buffer->State = BufferState::Encoding;
+            ReadbackBuffer *readback = buffer.get();
+            m_jobs.Submit([this, readback]() { Encode(*readback); }, m_encoding);
+        }
+    }
+}
+
+void FrameCapture::Wait()
+{
+    m_jobs.Wait(m_encoding);
+}
+
+void FrameCapture::Save(const CapturedImage &image, const std::filesystem::path &path,
+                        CaptureFormat format)
+{
+    const int width = static_cast<int>(image.Width);
+    const int height = static_cast<int>(image.Height);
+    const int stride = width * static_cast<int>(TexelSize);
+
+    switch (format)
+    {
+    case CaptureFormat::Png:
+        if (!stbi_write_png(path.string().c_str(), width, height, TexelSize, image.Pixels.data(),
+                            stride))
+        {
+            throw std::runtime_error{"failed to write " + path.string()};
+        }
+        return;
+    case CaptureFormat::Raw: {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(image.Pixels.data()),
+                   static_cast<std::streamsize>(image.Pixels.size()));
+        if (!file.good())
+        {
+            throw std::runtime_error{"failed to write " + path.string()};
+        }
+        return;
+    }
+    }
+}
+
+FrameCapture::ReadbackBuffer *FrameCapture::FreeBuffer() const
+{
+    for (const std::unique_ptr<ReadbackBuffer> &buffer : m_buffers)
+    {
+        if (buffer->State == BufferState::Free)
+        {
+            return buffer.get();
+        }
+    }
+
+    return nullptr;
+}
+
+void FrameCapture::Allocate(ReadbackBuffer &buffer, vk::DeviceSize size)
+{
+    // the buffer isn't in use, so the old one can go right away
+    buffer.Mapped = nullptr;
+    buffer.Memory = nullptr;
+    buffer.Buffer = nullptr;
+
+    vk::BufferCreateInfo bufferInfo{{}, size, vk::BufferUsageFlagBits::eTransferDst,
+                                    vk::SharingMode::eExclusive};
+    buffer.Buffer = vk::raii::Buffer{m_device, bufferInfo};
+
+    // cached memory is much faster to read from, but may need invalidating
+    vk::MemoryRequirements memRequirements = buffer.Buffer.getMemoryRequirements();
+    const vk::MemoryPropertyFlags cached =
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached;
+    const vk::MemoryPropertyFlags coherent =
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    uint32_t memoryType = FindMemoryType(memRequirements.memoryTypeBits, cached);
+    if (memoryType == std::numeric_limits<uint32_t>::max())
+    {
+        memoryType = FindMemoryType(memRequirements.memoryTypeBits, coherent);
+    }
+    if (memoryType == std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error{"no host visible memory for frame capture"};
+    }
+
+    const vk::MemoryPropertyFlags properties =
+        m_physicalDevice.getMemoryProperties().memoryTypes[memoryType].propertyFlags;
+    buffer.Coherent = static_cast<bool>(properties & vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    vk::MemoryAllocateInfo memoryAllocateInfo{memRequirements.size, memoryType};
+    buffer.Memory = vk::raii::DeviceMemory{m_device, memoryAllocateInfo};
+    buffer.Buffer.bindMemory(buffer.Memory, 0);
+    buffer.Mapped = buffer.Memory.mapMemory(0, vk::WholeSize);
+    buffer.Size = size;
+}
+
+uint32_t FrameCapture::FindMemoryType(uint32_t typeFilter,
+                                      vk::MemoryPropertyFlags properties) const
+{
+    vk::PhysicalDeviceMemoryProperties memProperties = m_physicalDevice.getMemoryProperties();
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) &&
+            (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    return std::numeric_limits<uint32_t>::max();
+}
+
+void FrameCapture::Encode(ReadbackBuffer &buffer)
+{
+    if (!buffer.Coherent)
+    {
+        m_device.invalidateMappedMemoryRanges(
+            vk::MappedMemoryRange{buffer.Memory, 0, vk::WholeSize});
+    }
+
+    CapturedImage image{buffer.Extent.width, buffer.Extent.height};
+    const size_t size = static_cast<size_t>(image.Width) * image.Height * TexelSize;
+    const uint8_t *mapped = static_cast<const uint8_t *>(buffer.Mapped);
+    image.Pixels.assign(mapped, mapped + size);
+
+    // the swapchain is opaque, whatever ended up in alpha
+    const bool bgra = IsBgra(buffer.Format);
+    for (size_t i = 0; i < size; i += TexelSize)
+    {
+        if (bgra)
+        {
+            std::swap(image.Pixels[i], image.Pixels[i + 2]);
+        }
+        image.Pixels[i + 3] = 255;
+    }
+
+    CaptureCallback callback = std::move(buffer.Callback);
+    buffer.Callback = nullptr;
+    buffer.State = BufferState::Free;
+
+    callback(std::move(image));
+}
+
+} // namespace vkstart
\ No newline at end of file
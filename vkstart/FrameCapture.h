@@ -0,0 +1,103 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "JobSystem.h"
+
+namespace vkstart
+{
+
+enum class CaptureFormat
+{
+    Png,
+
+    // The pixels as they are, see `CapturedImage`, without any header.
+    Raw,
+};
+
+// 8-bit sRGB RGBA, rows top to bottom.
+struct CapturedImage
+{
+    uint32_t Width;
+    uint32_t Height;
+    std::vector<uint8_t> Pixels;
+};
+
+// Called on a worker thread, must not throw.
+using CaptureCallback = std::function<void(CapturedImage image)>;
+
+// Copies frames into a ring of host-visible buffers, and hands the pixels to a job once
+// the GPU is done with them. Neither the frame that gets captured nor the ones after it
+// wait for the copy, the readback or the encoding.
+struct FrameCapture
+{
+    FrameCapture(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device,
+                 JobSystem &jobs, uint32_t bufferCount);
+    // waits for the captures that are still being encoded
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    static bool IsFormatSupported(vk::Format format);
+
+    // Captures the next frame `Record` gets called for, one request per frame.
+    void Request(CaptureCallback callback);
+    void Request(const std::filesystem::path &path, CaptureFormat format);
+
+    // true if `Record` has something to do, and a buffer to do it with
+    bool IsCapturing() const;
+
+    // Copies `image`, which must be in eTransferSrcOptimal, into a readback buffer,
+    // for the oldest request.
+    void Record(const vk::raii::CommandBuffer &commandBuffer, uint32_t frame, vk::Image image,
+                vk::Format format, vk::Extent2D extent);
+
+    // Hands what `frame` captured to a job. Call after waiting for the frame's fence.
+    void Complete(uint32_t frame);
+
+    // Waits for every capture that has been completed to be written.
+    void Wait();
+
+    static void Save(const CapturedImage &image, const std::filesystem::path &path,
+                     CaptureFormat format);
+
+  private:
+    enum class BufferState
+    {
+        Free,
+        Recorded,
+        Encoding,
+    };
+
+    struct ReadbackBuffer
+    {
+        vk::raii::Buffer Buffer = nullptr;
+        vk::raii::DeviceMemory Memory = nullptr;
+        void *Mapped = nullptr;
+        vk::DeviceSize Size = 0;
+        bool Coherent = false;
+
+        // set by the encoding job when it's done
+        std::atomic<BufferState> State = BufferState::Free;
+        uint32_t Frame = 0;
+        vk::Format Format = vk::Format::eUndefined;
+        vk::Extent2D Extent;
+        CaptureCallback Callback;
+    };
+
+    ReadbackBuffer *FreeBuffer() const;
+    void Allocate(ReadbackBuffer &buffer, vk::DeviceSize size);
+    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+    void Encode(ReadbackBuffer &buffer);
+
+    const vk::raii::PhysicalDevice &m_physicalDevice;
+    const vk::raii::Device &m_device;
+    JobSystem &m_jobs;
+
+    std::vector<std::unique_ptr<ReadbackBuffer>> m_buffers;
+    std::deque<CaptureCallback> m_requests;
+    JobCounter m_encoding;
+};
+
+} // namespace vkstart
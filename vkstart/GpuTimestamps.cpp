@@ -0,0 +1,99 @@
+#include "GpuTimestamps.h"
+
+namespace vkstart
+{
+
+GpuTimestamps::GpuTimestamps(const vk::raii::PhysicalDevice &physicalDevice,
+                             const vk::raii::Device &device, uint32_t queueFamilyIndex,
+                             uint32_t framesInFlight, uint32_t timestampsPerFrame)
+    : m_timestampsPerFrame{timestampsPerFrame},
+      m_written(framesInFlight * timestampsPerFrame, 0),
+      m_results(framesInFlight * timestampsPerFrame * 2, 0)
+{
+    const uint32_t validBits =
+        physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+    if (validBits == 0)
+    {
+        return;
+    }
+
+    m_validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    // milliseconds per tick, the limit is in nanoseconds
+    m_period = physicalDevice.getProperties().limits.timestampPeriod / 1e6;
+
+    vk::QueryPoolCreateInfo queryPoolCreateInfo{
+        {}, vk::QueryType::eTimestamp, framesInFlight * timestampsPerFrame};
+    m_queryPool = vk::raii::QueryPool{device, queryPoolCreateInfo};
+}
+
+bool GpuTimestamps::IsSupported() const
+{
+    return *m_queryPool != nullptr;
+}
+
+void GpuTimestamps::Reset(const vk::raii::CommandBuffer &commandBuffer, uint32_t frame)
+{
+    if (!IsSupported())
+    {
+        return;
+    }
+
+    const uint32_t first = frame * m_timestampsPerFrame;
+    commandBuffer.resetQueryPool(m_queryPool, first, m_timestampsPerFrame);
+    std::fill_n(m_written.begin() + first, m_timestampsPerFrame, 0);
+}
+
+void GpuTimestamps::Write(const vk::raii::CommandBuffer &commandBuffer, uint32_t frame,
+                          uint32_t timestamp, vk::PipelineStageFlags2 stage)
+{
+    if (!IsSupported())
+    {
+        return;
+    }
+
+    const uint32_t query = frame * m_timestampsPerFrame + timestamp;
+    commandBuffer.writeTimestamp2(stage, m_queryPool, query);
+    m_written[query] = 1;
+}
+
+void GpuTimestamps::Read(uint32_t frame)
+{
+    const uint32_t first = frame * m_timestampsPerFrame;
+    if (!IsSupported() || std::none_of(m_written.begin() + first,
+                                       m_written.begin() + first + m_timestampsPerFrame,
+                                       [](uint8_t written) { return written != 0; }))
+    {
+        return;
+    }
+
+    // with availability, so that timestamps that weren't written read as such
+    const size_t stride = 2 * sizeof(uint64_t);
+    auto [result, values] = m_queryPool.getResults<uint64_t>(
+        first, m_timestampsPerFrame, m_timestampsPerFrame * stride, stride,
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+    if (result == vk::Result::eSuccess || result == vk::Result::eNotReady)
+    {
+        std::copy(values.begin(), values.end(), m_results.begin() + 2 * first);
+    }
+}
+
+std::optional<double> GpuTimestamps::Elapsed(uint32_t frame, uint32_t begin, uint32_t end) const
+{
+    if (!IsSupported())
+    {
+        return std::nullopt;
+    }
+
+    const size_t first = 2 * static_cast<size_t>(frame * m_timestampsPerFrame);
+    const uint64_t beginTicks = m_results[first + 2 * begin];
+    const uint64_t endTicks = m_results[first + 2 * end];
+    if (m_results[first + 2 * begin + 1] == 0 || m_results[first + 2 * end + 1] == 0)
+    {
+        return std::nullopt;
+    }
+
+    const uint64_t ticks = (endTicks - beginTicks) & m_validMask;
+    return static_cast<double>(ticks) * m_period;
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// Timestamp queries for each frame in flight, read back once the frame's fence has
+// been waited for, so reading never stalls.
+struct GpuTimestamps
+{
+    GpuTimestamps(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device,
+                  uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t timestampsPerFrame);
+
+    // false if the queue can't write timestamps, in which case nothing gets recorded
+    bool IsSupported() const;
+
+    // Must be recorded before the frame's first `Write`, outside of rendering.
+    void Reset(const vk::raii::CommandBuffer &commandBuffer, uint32_t frame);
+    void Write(const vk::raii::CommandBuffer &commandBuffer, uint32_t frame, uint32_t timestamp,
+               vk::PipelineStageFlags2 stage);
+
+    // Reads the timestamps `frame` wrote the last time around. Call after waiting for its fence.
+    void Read(uint32_t frame);
+
+    // Milliseconds between two of the timestamps `Read` got, if both were written.
+    std::optional<double> Elapsed(uint32_t frame, uint32_t begin, uint32_t end) const;
+
+  private:
+    uint32_t m_timestampsPerFrame;
+    double m_period = 0.0;
+    uint64_t m_validMask = 0;
+
+    vk::raii::QueryPool m_queryPool = nullptr;
+    // per timestamp, whether it was written since the frame's last reset
+    std::vector<uint8_t> m_written;
+    // per timestamp and availability
+    std::vector<uint64_t> m_results;
+};
+
+} // namespace vkstart
@@ -0,0 +1,26 @@
+#include "HeadlessWindow.h"
+
+namespace vkstart
+{
+
+HeadlessWindow::HeadlessWindow(int width, int height) : m_width{width}, m_height{height}
+{
+}
+
+vk::raii::SurfaceKHR HeadlessWindow::CreateSurface(const vk::raii::Instance &instance)
+{
+    return vk::raii::SurfaceKHR{instance, vk::HeadlessSurfaceCreateInfoEXT{}};
+}
+
+void HeadlessWindow::GetPixelDimensions(int *width, int *height)
+{
+    *width = m_width;
+    *height = m_height;
+}
+
+std::vector<std::string> HeadlessWindow::RequiredInstanceExtensions()
+{
+    return {vk::KHRSurfaceExtensionName, vk::EXTHeadlessSurfaceExtensionName};
+}
+
+} // namespace vkstart
\ No newline at end of file
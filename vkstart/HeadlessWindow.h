@@ -0,0 +1,26 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "IWindow.h"
+
+namespace vkstart
+{
+
+// A fixed-size surface without a window, through VK_EXT_headless_surface, so that the
+// engine renders and presents as usual with nothing to show it on; for tests on
+// machines without a display, like CI with a software driver.
+struct HeadlessWindow : public IWindow
+{
+    HeadlessWindow(int width, int height);
+
+    vk::raii::SurfaceKHR CreateSurface(const vk::raii::Instance &instance) override;
+    void GetPixelDimensions(int *width, int *height) override;
+    std::vector<std::string> RequiredInstanceExtensions() override;
+
+  private:
+    int m_width;
+    int m_height;
+};
+
+} // namespace vkstart
@@ -0,0 +1,194 @@
+#include "JobSystem.h"
+
+namespace vkstart
+{
+
+static thread_local const JobSystem *t_jobSystem = nullptr;
+static thread_local size_t t_queueIndex = 0;
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    m_queues.resize(workerCount + 1);
+    for (auto &queue : m_queues)
+    {
+        queue = std::make_unique<JobQueue>();
+    }
+
+    m_workers.reserve(workerCount);
+    for (size_t i = 1; i <= workerCount; ++i)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerMain, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock{m_wakeMutex};
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+uint32_t JobSystem::DefaultWorkerCount()
+{
+    const uint32_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+uint32_t JobSystem::WorkerCount() const
+{
+    return static_cast<uint32_t>(m_workers.size());
+}
+
+void JobSystem::Submit(std::function<void()> job, JobCounter &counter)
+{
+    counter.Pending.fetch_add(1, std::memory_order_relaxed);
+    Push({std::move(job), &counter});
+
+    // taking the lock orders the push before a worker's check of m_queuedJobs
+    {
+        std::lock_guard lock{m_wakeMutex};
+    }
+    m_wake.notify_one();
+}
+
+void JobSystem::Wait(const JobCounter &counter)
+{
+    while (counter.Pending.load(std::memory_order_acquire) > 0)
+    {
+        if (!TryRunJob())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::ParallelFor(size_t count, size_t chunkSize,
+                            const std::function<void(size_t begin, size_t end)> &body)
+{
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    if (chunkCount <= 1 || m_workers.empty())
+    {
+        for (size_t begin = 0; begin < count; begin += chunkSize)
+        {
+            body(begin, std::min(begin + chunkSize, count));
+        }
+        return;
+    }
+
+    JobCounter counter{};
+    counter.Pending.store(static_cast<uint32_t>(chunkCount), std::memory_order_relaxed);
+
+    // pushed in reverse, so that this thread, popping newest first, starts at the front
+    for (size_t chunk = chunkCount; chunk-- > 0;)
+    {
+        const size_t begin = chunk * chunkSize;
+        const size_t end = std::min(begin + chunkSize, count);
+        Push({[&body, begin, end]() { body(begin, end); }, &counter});
+    }
+
+    {
+        std::lock_guard lock{m_wakeMutex};
+    }
+    m_wake.notify_all();
+
+    Wait(counter);
+}
+
+size_t JobSystem::OwnQueueIndex() const
+{
+    return t_jobSystem == this ? t_queueIndex : 0;
+}
+
+void JobSystem::Push(Job job)
+{
+    JobQueue &queue = *m_queues[OwnQueueIndex()];
+    {
+        std::lock_guard lock{queue.Mutex};
+        queue.Jobs.push_back(std::move(job));
+    }
+    m_queuedJobs.fetch_add(1, std::memory_order_release);
+}
+
+bool JobSystem::Pop(Job &job)
+{
+    if (m_queuedJobs.load(std::memory_order_acquire) == 0)
+    {
+        return false;
+    }
+
+    const size_t own = OwnQueueIndex();
+    for (size_t i = 0; i < m_queues.size(); ++i)
+    {
+        const size_t index = (own + i) % m_queues.size();
+        JobQueue &queue = *m_queues[index];
+
+        std::lock_guard lock{queue.Mutex};
+        if (queue.Jobs.empty())
+        {
+            continue;
+        }
+
+        if (index == own)
+        {
+            job = std::move(queue.Jobs.back());
+            queue.Jobs.pop_back();
+        }
+        else
+        {
+            job = std::move(queue.Jobs.front());
+            queue.Jobs.pop_front();
+        }
+        m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    return false;
+}
+
+bool JobSystem::TryRunJob()
+{
+    Job job{};
+    if (!Pop(job))
+    {
+        return false;
+    }
+
+    job.Function();
+    job.Counter->Pending.fetch_sub(1, std::memory_order_release);
+
+    return true;
+}
+
+void JobSystem::WorkerMain(size_t queueIndex)
+{
+    t_jobSystem = this;
+    t_queueIndex = queueIndex;
+
+    while (true)
+    {
+        if (TryRunJob())
+        {
+            continue;
+        }
+
+        std::unique_lock lock{m_wakeMutex};
+        m_wake.wait(lock, [this]() {
+            return m_stopping || m_queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stopping)
+        {
+            return;
+        }
+    }
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// Counts the jobs of a batch that haven't finished yet.
+struct JobCounter
+{
+    std::atomic<uint32_t> Pending = 0;
+};
+
+// Thread pool with one job queue per thread. Threads run their own jobs newest first,
+// and steal the oldest jobs of the other queues when they run dry.
+// Jobs must not throw.
+struct JobSystem
+{
+    explicit JobSystem(uint32_t workerCount = DefaultWorkerCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // One worker per core, the calling thread being one of them.
+    static uint32_t DefaultWorkerCount();
+
+    uint32_t WorkerCount() const;
+
+    void Submit(std::function<void()> job, JobCounter &counter);
+
+    // Runs queued jobs until every job counted by `counter` has finished.
+    void Wait(const JobCounter &counter);
+
+    // Calls `body(begin, end)` on the chunks of `[0, count)`, in parallel.
+    // The chunk boundaries only depend on `count` and `chunkSize`, never on
+    // the number of threads or on timing, so per-chunk results are reproducible.
+    void ParallelFor(size_t count, size_t chunkSize,
+                     const std::function<void(size_t begin, size_t end)> &body);
+
+  private:
+    struct Job
+    {
+        std::function<void()> Function;
+        JobCounter *Counter;
+    };
+
+    struct JobQueue
+    {
+        std::mutex Mutex;
+        std::deque<Job> Jobs;
+    };
+
+    size_t OwnQueueIndex() const;
+    void Push(Job job);
+    bool Pop(Job &job);
+    bool TryRunJob();
+    void WorkerMain(size_t queueIndex);
+
+    // queue 0 belongs to every thread outside of the pool
+    std::vector<std::unique_ptr<JobQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<size_t> m_queuedJobs = 0;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+};
+
+} // namespace vkstart
@@ -0,0 +1,159 @@
+#include "LightClusters.h"
+
+namespace vkstart
+{
+
+// Where the lights orbit: a disc around the origin, in the plane the scenes lie in.
+constexpr float LightOrbitRadius = 2.0f;
+constexpr float LightMinHeight = -0.6f;
+constexpr float LightMaxHeight = 0.6f;
+// In radians per second.
+constexpr float LightMinSpeed = 0.2f;
+constexpr float LightMaxSpeed = 0.6f;
+constexpr float LightRadius = 0.3f;
+constexpr float LightIntensity = 0.25f;
+
+// The near and far plane of a perspective projection with a depth range of zero to one.
+static std::pair<float, float> DepthRange(const glm::mat4 &proj)
+{
+    return {proj[3][2] / proj[2][2], proj[3][2] / (proj[2][2] + 1.0f)};
+}
+
+// Low-discrepancy sequence in [0, 1), which fills the range evenly for any number of lights.
+static float Spread(uint32_t index, float step)
+{
+    return std::fmod(static_cast<float>(index) * step, 1.0f);
+}
+
+static glm::vec3 HueColor(float hue)
+{
+    const glm::vec3 phases{0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    return glm::clamp(glm::abs(glm::fract(hue + phases) * 6.0f - 3.0f) - 1.0f, 0.0f, 1.0f);
+}
+
+ClusterConstants ClusterConstants::Create(const glm::mat4 &view, const glm::mat4 &proj,
+                                          uint32_t lightCount)
+{
+    const auto [nearPlane, farPlane] = DepthRange(proj);
+
+    ClusterConstants constants{};
+    constants.View = view;
+    constants.FrustumSlope = {1.0f / proj[0][0], 1.0f / proj[1][1]};
+    constants.NearPlane = nearPlane;
+    constants.FarPlane = farPlane;
+    constants.LightCount = lightCount;
+
+    return constants;
+}
+
+glm::vec4 ClusterLookup(const glm::mat4 &proj, vk::Extent2D renderExtent)
+{
+    const auto [nearPlane, farPlane] = DepthRange(proj);
+
+    // the slice of a view space depth is log(depth) * z + w
+    const float depthScale = static_cast<float>(ClusterCountZ) / std::log(farPlane / nearPlane);
+    return {static_cast<float>(ClusterCountX) / static_cast<float>(renderExtent.width),
+            static_cast<float>(ClusterCountY) / static_cast<float>(renderExtent.height),
+            depthScale, -std::log(nearPlane) * depthScale};
+}
+
+void AnimateLights(std::span<PointLight> lights, float time)
+{
+    const float goldenAngle = glm::pi<float>() * (3.0f - std::sqrt(5.0f));
+    const float count = static_cast<float>(lights.size());
+    for (uint32_t i = 0; i < lights.size(); ++i)
+    {
+        // evenly over the disc's area
+        const float orbit = LightOrbitRadius * std::sqrt((static_cast<float>(i) + 0.5f) / count);
+        const float speed = glm::mix(LightMinSpeed, LightMaxSpeed, Spread(i, 0.7548777f));
+        // every other one goes the other way around
+        const float direction = i % 2 == 0 ? 1.0f : -1.0f;
+        const float angle = static_cast<float>(i) * goldenAngle + direction * speed * time;
+
+        PointLight &light = lights[i];
+        light.Position = {orbit * std::cos(angle), orbit * std::sin(angle),
+                          glm::mix(LightMinHeight, LightMaxHeight, Spread(i, 0.5698403f))};
+        light.Radius = LightRadius;
+        light.Color = HueColor(Spread(i, 0.6180340f));
+        light.Intensity = LightIntensity;
+    }
+}
+
+LightClusters::LightClusters(const vk::raii::PhysicalDevice &physicalDevice,
+                             const vk::raii::Device &device, uint32_t framesInFlight)
+    : m_physicalDevice{physicalDevice}, m_device{device}
+{
+    const vk::DeviceSize alignment =
+        m_physicalDevice.getProperties().limits.minStorageBufferOffsetAlignment;
+    m_slotSize = (sizeof(PointLight) * MaxLights + alignment - 1) / alignment * alignment;
+
+    const vk::DeviceSize ringSize = m_slotSize * framesInFlight;
+    m_lightRing = CreateBuffer(ringSize, vk::MemoryPropertyFlagBits::eHostVisible |
+                                             vk::MemoryPropertyFlagBits::eHostCoherent);
+    m_lightRingMapped = static_cast<std::byte *>(m_lightRing.Memory.mapMemory(0, ringSize));
+
+    for (uint32_t frame = 0; frame < framesInFlight; ++frame)
+    {
+        m_lightCounts.push_back(CreateBuffer(sizeof(uint32_t) * ClusterCount,
+                                             vk::MemoryPropertyFlagBits::eDeviceLocal));
+        m_lightIndices.push_back(
+            CreateBuffer(sizeof(uint32_t) * ClusterCount * MaxLightsPerCluster,
+                         vk::MemoryPropertyFlagBits::eDeviceLocal));
+    }
+}
+
+std::span<PointLight> LightClusters::Lights(uint32_t frame)
+{
+    return {reinterpret_cast<PointLight *>(m_lightRingMapped + frame * m_slotSize), MaxLights};
+}
+
+vk::DescriptorBufferInfo LightClusters::LightBuffer(uint32_t frame) const
+{
+    return {m_lightRing.Buffer, frame * m_slotSize, sizeof(PointLight) * MaxLights};
+}
+
+vk::DescriptorBufferInfo LightClusters::LightCountBuffer(uint32_t frame) const
+{
+    return {m_lightCounts[frame].Buffer, 0, vk::WholeSize};
+}
+
+vk::DescriptorBufferInfo LightClusters::LightIndexBuffer(uint32_t frame) const
+{
+    return {m_lightIndices[frame].Buffer, 0, vk::WholeSize};
+}
+
+LightClusters::OwnedBuffer LightClusters::CreateBuffer(vk::DeviceSize size,
+                                                       vk::MemoryPropertyFlags properties) const
+{
+    vk::BufferCreateInfo bufferCreateInfo{
+        {}, size, vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive};
+
+    OwnedBuffer buffer{};
+    buffer.Buffer = vk::raii::Buffer{m_device, bufferCreateInfo};
+
+    vk::MemoryRequirements memRequirements = buffer.Buffer.getMemoryRequirements();
+    vk::MemoryAllocateInfo allocInfo{memRequirements.size,
+                                     FindMemoryType(memRequirements.memoryTypeBits, properties)};
+    buffer.Memory = vk::raii::DeviceMemory{m_device, allocInfo};
+    buffer.Buffer.bindMemory(buffer.Memory, 0);
+
+    return buffer;
+}
+
+uint32_t LightClusters::FindMemoryType(uint32_t typeFilter,
+                                       vk::MemoryPropertyFlags properties) const
+{
+    vk::PhysicalDeviceMemoryProperties memProperties = m_physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) &&
+            (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("no suitable memory type found");
+}
+
+} // namespace vkstart
\ No newline at end of file
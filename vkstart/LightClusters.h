@@ -0,0 +1,100 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// The froxel grid the lights get binned into, see clusters_common.slang: tiles of the
+// screen, in slices that get exponentially deeper with the distance from the camera.
+constexpr uint32_t ClusterCountX = 16;
+constexpr uint32_t ClusterCountY = 9;
+constexpr uint32_t ClusterCountZ = 24;
+constexpr uint32_t ClusterCount = ClusterCountX * ClusterCountY * ClusterCountZ;
+
+// What a fragment shades with at most, however many lights there are; the ones beyond it
+// are dropped from the cluster.
+constexpr uint32_t MaxLightsPerCluster = 128;
+
+// Lights a frame can have.
+constexpr uint32_t MaxLights = 4096;
+
+// Workgroup size of `ClusterMain` in clusters.slang.
+constexpr uint32_t ClusterGroupSize = 64;
+
+// See clusters_common.slang.
+struct PointLight
+{
+    // world space
+    glm::vec3 Position;
+    // where it has faded out
+    float Radius;
+    glm::vec3 Color;
+    float Intensity;
+};
+
+// Push constants of clusters.slang, laid out to match `ClusterConstants` there.
+struct ClusterConstants
+{
+    glm::mat4 View;
+    // x / -z and y / -z of view space, at the right and the lower edge of the frustum
+    glm::vec2 FrustumSlope;
+    float NearPlane;
+    float FarPlane;
+    uint32_t LightCount;
+
+    // `proj` is a symmetric perspective projection with a depth range of zero to one,
+    // like glm::perspective makes, which the grid gets derived from.
+    static ClusterConstants Create(const glm::mat4 &view, const glm::mat4 &proj,
+                                   uint32_t lightCount);
+};
+
+// How the fragment shader finds its cluster, from the fragment's position in the
+// `renderExtent` and its view space depth, see `ClusterLighting` in shader.slang.
+glm::vec4 ClusterLookup(const glm::mat4 &proj, vk::Extent2D renderExtent);
+
+// Lights orbiting the origin, spread out evenly, each with a color of its own.
+void AnimateLights(std::span<PointLight> lights, float time);
+
+// The lights of each frame, and the clusters they get binned into. The lights are
+// streamed through a ring of host visible slots, one per frame in flight, which the CPU
+// writes while the GPU still reads the others. The clusters are per frame in flight too,
+// so that binning never has to wait for the previous frame's fragments.
+struct LightClusters
+{
+    LightClusters(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device,
+                  uint32_t framesInFlight);
+
+    // `frame`'s slot of the ring, for MaxLights lights; only to be written once the frame's
+    // fence has been waited for.
+    std::span<PointLight> Lights(uint32_t frame);
+
+    // for the descriptors, `frame`'s slot of the ring and its clusters
+    vk::DescriptorBufferInfo LightBuffer(uint32_t frame) const;
+    vk::DescriptorBufferInfo LightCountBuffer(uint32_t frame) const;
+    vk::DescriptorBufferInfo LightIndexBuffer(uint32_t frame) const;
+
+  private:
+    struct OwnedBuffer
+    {
+        vk::raii::DeviceMemory Memory = nullptr;
+        vk::raii::Buffer Buffer = nullptr;
+    };
+
+    OwnedBuffer CreateBuffer(vk::DeviceSize size, vk::MemoryPropertyFlags properties) const;
+    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+
+    const vk::raii::PhysicalDevice &m_physicalDevice;
+    const vk::raii::Device &m_device;
+
+    // aligned for binding each slot on its own
+    vk::DeviceSize m_slotSize;
+    OwnedBuffer m_lightRing;
+    std::byte *m_lightRingMapped = nullptr;
+
+    // per frame in flight, how many lights each cluster has, and which
+    std::vector<OwnedBuffer> m_lightCounts;
+    std::vector<OwnedBuffer> m_lightIndices;
+};
+
+} // namespace vkstart
@@ -0,0 +1,107 @@
+#include "Mesh.h"
+
+namespace vkstart
+{
+
+size_t Mesh::LodCount() const
+{
+    return std::max<size_t>(Lods.size(), 1);
+}
+
+MeshLod Mesh::Lod(size_t level) const
+{
+    if (Lods.empty())
+    {
+        return {0, static_cast<uint32_t>(Indices.size()), 0.0f, 0,
+                static_cast<uint32_t>(Meshlets.size())};
+    }
+
+    return Lods[level];
+}
+
+void Mesh::ComputeBounds()
+{
+    if (Vertices.empty())
+    {
+        BoundsCenter = glm::vec3{0.0f};
+        BoundsRadius = 0.0f;
+        return;
+    }
+
+    glm::vec3 minimum = Vertices[0].Position;
+    glm::vec3 maximum = Vertices[0].Position;
+    for (const Vertex &vertex : Vertices)
+    {
+        minimum = glm::min(minimum, vertex.Position);
+        maximum = glm::max(maximum, vertex.Position);
+    }
+
+    BoundsCenter = (minimum + maximum) * 0.5f;
+    BoundsRadius = 0.0f;
+    for (const Vertex &vertex : Vertices)
+    {
+        BoundsRadius = std::max(BoundsRadius, glm::distance(BoundsCenter, vertex.Position));
+    }
+}
+
+float Mesh::MeanTriangleArea(const MeshLod &lod) const
+{
+    const uint32_t triangleCount = lod.IndexCount / 3;
+    if (triangleCount == 0)
+    {
+        return 0.0f;
+    }
+
+    double totalArea = 0.0;
+    for (uint32_t i = lod.FirstIndex; i < lod.FirstIndex + triangleCount * 3; i += 3)
+    {
+        const glm::vec3 a = Vertices[Indices[i]].Position;
+        const glm::vec3 b = Vertices[Indices[i + 1]].Position;
+        const glm::vec3 c = Vertices[Indices[i + 2]].Position;
+        totalArea += 0.5 * glm::length(glm::cross(b - a, c - a));
+    }
+
+    return static_cast<float>(totalArea / triangleCount);
+}
+
+vk::IndexType Mesh::IndexType() const
+{
+    if (Vertices.size() <= std::numeric_limits<uint16_t>::max())
+    {
+        return vk::IndexType::eUint16;
+    }
+
+    return vk::IndexType::eUint32;
+}
+
+vk::DeviceSize Mesh::IndexSize() const
+{
+    return IndexType() == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+vk::DeviceSize Mesh::IndexBufferSize() const
+{
+    return IndexSize() * Indices.size();
+}
+
+vk::DeviceSize Mesh::VertexBufferSize() const
+{
+    return sizeof(Vertex) * Vertices.size();
+}
+
+void Mesh::WriteIndices(void *destination) const
+{
+    if (IndexType() == vk::IndexType::eUint32)
+    {
+        memcpy(destination, Indices.data(), IndexBufferSize());
+        return;
+    }
+
+    uint16_t *indices16 = static_cast<uint16_t *>(destination);
+    for (size_t i = 0; i < Indices.size(); ++i)
+    {
+        indices16[i] = static_cast<uint16_t>(Indices[i]);
+    }
+}
+
+} // namespace vkstart
\ No newline at end of file
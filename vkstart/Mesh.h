@@ -0,0 +1,79 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "Vertex.h"
+
+namespace vkstart
+{
+
+struct MeshLod
+{
+    uint32_t FirstIndex;
+    uint32_t IndexCount;
+
+    // Object space deviation from the full resolution mesh.
+    float Error;
+
+    // Range in `Mesh::Meshlets`, if meshlets were built.
+    uint32_t FirstMeshlet;
+    uint32_t MeshletCount;
+};
+
+// Laid out to match `Meshlet` in meshlet_common.slang (std430).
+struct Meshlet
+{
+    glm::vec3 Center;
+    float Radius;
+
+    // Backfacing if `dot(normalize(Center - camera), ConeAxis) >= ConeCutoff`.
+    glm::vec3 ConeAxis;
+    float ConeCutoff;
+
+    // Into `Mesh::MeshletVertices`.
+    uint32_t VertexOffset;
+
+    // Into `Mesh::MeshletTriangles`, and, times 3, into `Mesh::Indices`.
+    uint32_t TriangleOffset;
+
+    uint32_t VertexCount;
+    uint32_t TriangleCount;
+};
+
+struct Mesh
+{
+    std::vector<Vertex> Vertices;
+    std::vector<uint32_t> Indices;
+
+    // Index ranges into `Indices`, finest first. Empty if `Indices` is a single level.
+    std::vector<MeshLod> Lods;
+
+    std::vector<Meshlet> Meshlets;
+
+    // Mesh vertex indices of the meshlets' vertices.
+    std::vector<uint32_t> MeshletVertices;
+
+    // One triangle of meshlet local vertex indices per entry, 8 bits each.
+    std::vector<uint32_t> MeshletTriangles;
+
+    glm::vec3 BoundsCenter{0.0f};
+    float BoundsRadius = 0.0f;
+
+    size_t LodCount() const;
+    MeshLod Lod(size_t level) const;
+
+    void ComputeBounds();
+
+    // Object space, of the triangles of `lod`.
+    float MeanTriangleArea(const MeshLod &lod) const;
+
+    vk::IndexType IndexType() const;
+    vk::DeviceSize IndexSize() const;
+    vk::DeviceSize IndexBufferSize() const;
+    vk::DeviceSize VertexBufferSize() const;
+
+    // Writes the indices packed to `IndexType()`, `IndexBufferSize()` bytes in total.
+    void WriteIndices(void *destination) const;
+};
+
+} // namespace vkstart
@@ -0,0 +1,393 @@
+#include "MeshOptimizer.h"
+
+namespace vkstart
+{
+
+constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+constexpr uint32_t VertexCacheSize = 32;
+constexpr float CacheDecayPower = 1.5f;
+constexpr float LastTriangleScore = 0.75f;
+constexpr float ValenceBoostScale = 2.0f;
+constexpr float ValenceBoostPower = 0.5f;
+
+// Cache size used when measuring the cost of cluster boundaries in the overdraw pass.
+constexpr uint32_t OverdrawCacheSize = 16;
+
+static float VertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // the vertices of the last triangle get a fixed score, so that
+            // the next triangle doesn't simply reuse the same edge
+            score = LastTriangleScore;
+        }
+        else
+        {
+            const float scaler = 1.0f / (VertexCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+        }
+    }
+
+    // favor vertices with few triangles left, to get rid of lone triangles early
+    score += ValenceBoostScale *
+             std::pow(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+
+    return score;
+}
+
+// FIFO cache simulation, a vertex is in the cache if it was inserted less than
+// `cacheSize` insertions ago.
+static uint32_t CacheMisses(const uint32_t *triangle, std::vector<uint32_t> &timestamps,
+                            uint32_t &time, uint32_t cacheSize)
+{
+    uint32_t misses = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        const uint32_t index = triangle[i];
+        if (time - timestamps[index] > cacheSize)
+        {
+            timestamps[index] = time++;
+            ++misses;
+        }
+    }
+
+    return misses;
+}
+
+void MeshOptimizer::Optimize(Mesh &mesh)
+{
+    for (size_t level = 0; level < mesh.LodCount(); ++level)
+    {
+        const MeshLod lod = mesh.Lod(level);
+        const auto begin = mesh.Indices.begin() + lod.FirstIndex;
+        const auto end = begin + lod.IndexCount;
+
+        std::vector<uint32_t> indices{begin, end};
+        OptimizeVertexCache(indices, mesh.Vertices.size());
+        OptimizeOverdraw(indices, mesh.Vertices);
+        std::copy(indices.begin(), indices.end(), begin);
+    }
+
+    // LOD 0 comes first in the index buffer, so its vertices end up in sequential order
+    OptimizeVertexFetch(mesh.Vertices, mesh.Indices);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // the triangles using each vertex, as ranges in one flat array
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++remainingTriangles[indices[i]];
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+    }
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fillOffsets{adjacencyOffsets.begin(), adjacencyOffsets.end() - 1};
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            adjacency[fillOffsets[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScores[v] = VertexScore(-1, remainingTriangles[v]);
+    }
+
+    auto triangleScore = [&indices, &vertexScores](uint32_t triangle) {
+        return vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] +
+               vertexScores[indices[triangle * 3 + 2]];
+    };
+
+    uint32_t bestTriangle = 0;
+    float bestScore = triangleScore(0);
+    for (uint32_t t = 1; t < triangleCount; ++t)
+    {
+        const float score = triangleScore(t);
+        if (score > bestScore)
+        {
+            bestTriangle = t;
+            bestScore = score;
+        }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    size_t nextCandidate = 0;
+
+    std::vector<uint32_t> cache{};
+    std::vector<uint32_t> newCache{};
+    cache.reserve(VertexCacheSize + 3);
+    newCache.reserve(VertexCacheSize + 3);
+
+    std::vector<uint32_t> result{};
+    result.reserve(triangleCount * 3);
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        if (bestTriangle == InvalidIndex)
+        {
+            // nothing adjacent to the cache is left, restart at the first unused triangle
+            while (emitted[nextCandidate])
+            {
+                ++nextCandidate;
+            }
+            bestTriangle = static_cast<uint32_t>(nextCandidate);
+        }
+
+        const uint32_t *triangle = &indices[bestTriangle * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        newCache.clear();
+        for (size_t k = 0; k < 3; ++k)
+        {
+            const uint32_t v = triangle[k];
+
+            uint32_t *begin = &adjacency[adjacencyOffsets[v]];
+            uint32_t *end = begin + remainingTriangles[v];
+            uint32_t *position = std::find(begin, end, bestTriangle);
+            assert(position != end);
+            *position = *(end - 1);
+            --remainingTriangles[v];
+
+            if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        for (uint32_t v : cache)
+        {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        // rescore everything that entered, moved in or fell out of the cache
+        for (size_t i = 0; i < newCache.size(); ++i)
+        {
+            const uint32_t v = newCache[i];
+            cachePositions[v] = i < VertexCacheSize ? static_cast<int32_t>(i) : -1;
+            vertexScores[v] = VertexScore(cachePositions[v], remainingTriangles[v]);
+        }
+
+        bestTriangle = InvalidIndex;
+        bestScore = -1.0f;
+        for (uint32_t v : newCache)
+        {
+            const uint32_t begin = adjacencyOffsets[v];
+            const uint32_t end = begin + remainingTriangles[v];
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                const float score = triangleScore(adjacency[i]);
+                if (score > bestScore)
+                {
+                    bestTriangle = adjacency[i];
+                    bestScore = score;
+                }
+            }
+        }
+
+        if (newCache.size() > VertexCacheSize)
+        {
+            newCache.resize(VertexCacheSize);
+        }
+        std::swap(cache, newCache);
+    }
+
+    indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t> &indices,
+                                     const std::vector<Vertex> &vertices, float threshold)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t time = OverdrawCacheSize + 1;
+
+    // hard boundaries, where a triangle misses the cache completely, can be
+    // reordered at no cost
+    std::vector<size_t> hardBoundaries{};
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const uint32_t misses = CacheMisses(&indices[t * 3], timestamps, time, OverdrawCacheSize);
+        if (t == 0 || misses == 3)
+        {
+            hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+
+    // soft boundaries split hard clusters as soon as the running miss ratio
+    // is within `threshold` of the one of the whole cluster
+    std::vector<size_t> boundaries{};
+    for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+    {
+        const size_t clusterBegin = hardBoundaries[c];
+        const size_t clusterEnd = hardBoundaries[c + 1];
+
+        time += OverdrawCacheSize + 1;
+        uint32_t clusterMisses = 0;
+        for (size_t t = clusterBegin; t < clusterEnd; ++t)
+        {
+            clusterMisses += CacheMisses(&indices[t * 3], timestamps, time, OverdrawCacheSize);
+        }
+        const float clusterRatio =
+            static_cast<float>(clusterMisses) / static_cast<float>(clusterEnd - clusterBegin);
+
+        boundaries.push_back(clusterBegin);
+
+        time += OverdrawCacheSize + 1;
+        size_t start = clusterBegin;
+        uint32_t misses = 0;
+        for (size_t t = clusterBegin; t + 1 < clusterEnd; ++t)
+        {
+            misses += CacheMisses(&indices[t * 3], timestamps, time, OverdrawCacheSize);
+
+            const float ratio = static_cast<float>(misses) / static_cast<float>(t - start + 1);
+            if (ratio <= clusterRatio * threshold)
+            {
+                start = t + 1;
+                boundaries.push_back(start);
+                misses = 0;
+                time += OverdrawCacheSize + 1;
+            }
+        }
+    }
+    boundaries.push_back(triangleCount);
+
+    glm::vec3 meshCentroid{0.0f};
+    for (const Vertex &vertex : vertices)
+    {
+        meshCentroid += vertex.Position;
+    }
+    meshCentroid /= static_cast<float>(std::max<size_t>(vertices.size(), 1));
+
+    struct Cluster
+    {
+        size_t Begin;
+        size_t End;
+        float SortKey;
+    };
+
+    std::vector<Cluster> clusters{};
+    clusters.reserve(boundaries.size() - 1);
+    for (size_t c = 0; c + 1 < boundaries.size(); ++c)
+    {
+        glm::vec3 centroid{0.0f};
+        glm::vec3 normal{0.0f};
+        float area = 0.0f;
+        for (size_t t = boundaries[c]; t < boundaries[c + 1]; ++t)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+
+            const glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            const float triangleArea = glm::length(triangleNormal);
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+
+        centroid = area > 0.0f ? centroid / area : vertices[indices[boundaries[c] * 3]].Position;
+
+        const float normalLength = glm::length(normal);
+        normal = normalLength > 0.0f ? normal / normalLength : glm::vec3{0.0f};
+
+        // clusters far out on the mesh and facing away from its center are
+        // likely to occlude the rest, so they go first
+        const float sortKey = glm::dot(centroid - meshCentroid, normal);
+        clusters.push_back({boundaries[c], boundaries[c + 1], sortKey});
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+        return a.SortKey > b.SortKey;
+    });
+
+    std::vector<uint32_t> result{};
+    result.reserve(triangleCount * 3);
+    for (const Cluster &cluster : clusters)
+    {
+        result.insert(result.end(), indices.begin() + cluster.Begin * 3,
+                      indices.begin() + cluster.End * 3);
+    }
+
+    indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex> &vertices,
+                                        std::vector<uint32_t> &indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), InvalidIndex);
+
+    std::vector<Vertex> result{};
+    result.reserve(vertices.size());
+
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == InvalidIndex)
+        {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(result);
+}
+
+float MeshOptimizer::AverageCacheMissRatio(std::span<const uint32_t> indices, size_t vertexCount,
+                                           uint32_t cacheSize)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return 0.0f;
+    }
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        misses += CacheMisses(&indices[t * 3], timestamps, time, cacheSize);
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
+
+} // namespace vkstart
\ No newline at end of file
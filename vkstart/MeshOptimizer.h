@@ -0,0 +1,33 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "Mesh.h"
+
+namespace vkstart
+{
+
+struct MeshOptimizer
+{
+    // Runs all of the passes below, in the order they are meant to be applied,
+    // on every LOD of the mesh.
+    static void Optimize(Mesh &mesh);
+
+    // Reorders triangles for post-transform vertex cache locality (Forsyth).
+    static void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+    // Reorders clusters of cache-optimized triangles front to back, roughly,
+    // without raising the cache miss ratio by more than `threshold`.
+    static void OptimizeOverdraw(std::vector<uint32_t> &indices,
+                                 const std::vector<Vertex> &vertices, float threshold = 1.05f);
+
+    // Renumbers the vertices in order of first use, dropping unreferenced ones.
+    static void OptimizeVertexFetch(std::vector<Vertex> &vertices,
+                                    std::vector<uint32_t> &indices);
+
+    // Average number of vertex shader invocations per triangle with a FIFO cache.
+    static float AverageCacheMissRatio(std::span<const uint32_t> indices, size_t vertexCount,
+                                       uint32_t cacheSize = 16);
+};
+
+} // namespace vkstart
@@ -0,0 +1,359 @@
+#include "MeshSimplifier.h"
+
+namespace vkstart
+{
+
+// A LOD that doesn't get rid of at least this fraction of its predecessor's triangles
+// isn't worth its memory, and ends the chain.
+constexpr float MinLodReduction = 0.1f;
+
+// Symmetric 4x4 matrix summing the squared distances to a set of planes,
+// weighted by the area of the triangles they came from.
+struct Quadric
+{
+    float A00, A01, A02, A11, A12, A22;
+    float B0, B1, B2;
+    float C;
+    float Weight;
+};
+
+static Quadric PlaneQuadric(const glm::vec3 &normal, float d, float weight)
+{
+    const glm::vec3 n = normal * weight;
+    return {n.x * normal.x, n.x * normal.y, n.x * normal.z, n.y * normal.y, n.y * normal.z,
+            n.z * normal.z, n.x * d,        n.y * d,        n.z * d,        d * d * weight,
+            weight};
+}
+
+static void AddQuadric(Quadric &quadric, const Quadric &other)
+{
+    quadric.A00 += other.A00;
+    quadric.A01 += other.A01;
+    quadric.A02 += other.A02;
+    quadric.A11 += other.A11;
+    quadric.A12 += other.A12;
+    quadric.A22 += other.A22;
+    quadric.B0 += other.B0;
+    quadric.B1 += other.B1;
+    quadric.B2 += other.B2;
+    quadric.C += other.C;
+    quadric.Weight += other.Weight;
+}
+
+// Mean squared distance of `p` to the planes of `quadric`.
+static float QuadricError(const Quadric &quadric, const glm::vec3 &p)
+{
+    const float rx = quadric.A00 * p.x + quadric.A01 * p.y + quadric.A02 * p.z;
+    const float ry = quadric.A01 * p.x + quadric.A11 * p.y + quadric.A12 * p.z;
+    const float rz = quadric.A02 * p.x + quadric.A12 * p.y + quadric.A22 * p.z;
+
+    const float error = rx * p.x + ry * p.y + rz * p.z +
+                        2.0f * (quadric.B0 * p.x + quadric.B1 * p.y + quadric.B2 * p.z) +
+                        quadric.C;
+
+    return quadric.Weight > 0.0f ? std::fabs(error) / quadric.Weight : 0.0f;
+}
+
+struct PositionHash
+{
+    size_t operator()(const glm::vec3 &position) const
+    {
+        const std::hash<float> hasher{};
+        size_t hash = hasher(position.x);
+        hash ^= hasher(position.y) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= hasher(position.z) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
+// Vertices that must not move: the ones on open borders, and the ones sharing their
+// position with other vertices (UV or color seams), which would otherwise tear apart.
+static std::vector<bool> LockedVertices(const std::vector<Vertex> &vertices,
+                                        std::span<const uint32_t> indices)
+{
+    std::vector<bool> locked(vertices.size(), false);
+
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> firstWithPosition{};
+    std::vector<uint32_t> welded(vertices.size());
+    for (uint32_t v = 0; v < vertices.size(); ++v)
+    {
+        auto [it, inserted] = firstWithPosition.try_emplace(vertices[v].Position, v);
+        welded[v] = it->second;
+        if (!inserted)
+        {
+            locked[v] = true;
+            locked[it->second] = true;
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edgeCounts{};
+    auto edgeKey = [&welded](uint32_t a, uint32_t b) {
+        const uint64_t wa = welded[a];
+        const uint64_t wb = welded[b];
+        return wa < wb ? (wa << 32) | wb : (wb << 32) | wa;
+    };
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            ++edgeCounts[edgeKey(indices[i + k], indices[i + (k + 1) % 3])];
+        }
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            const uint32_t a = indices[i + k];
+            const uint32_t b = indices[i + (k + 1) % 3];
+            if (edgeCounts[edgeKey(a, b)] == 1)
+            {
+                locked[a] = true;
+                locked[b] = true;
+            }
+        }
+    }
+
+    return locked;
+}
+
+void MeshSimplifier::GenerateLods(Mesh &mesh, size_t maxLodCount, float reduction)
+{
+    if (mesh.Lods.empty())
+    {
+        mesh.Lods.push_back({0, static_cast<uint32_t>(mesh.Indices.size()), 0.0f, 0, 0});
+    }
+
+    const MeshLod base = mesh.Lods[0];
+    const std::vector<uint32_t> baseIndices{mesh.Indices.begin() + base.FirstIndex,
+                                            mesh.Indices.begin() + base.FirstIndex +
+                                                base.IndexCount};
+
+    while (mesh.Lods.size() < maxLodCount)
+    {
+        const MeshLod &previous = mesh.Lods.back();
+        const size_t targetIndexCount =
+            static_cast<size_t>(previous.IndexCount / 3 * reduction) * 3;
+
+        float error = 0.0f;
+        std::vector<uint32_t> lodIndices =
+            Simplify(mesh.Vertices, baseIndices, targetIndexCount, &error);
+
+        if (lodIndices.empty() ||
+            lodIndices.size() > previous.IndexCount * (1.0f - MinLodReduction))
+        {
+            break;
+        }
+
+        const auto firstIndex = static_cast<uint32_t>(mesh.Indices.size());
+        const auto indexCount = static_cast<uint32_t>(lodIndices.size());
+        mesh.Indices.insert(mesh.Indices.end(), lodIndices.begin(), lodIndices.end());
+        mesh.Lods.push_back({firstIndex, indexCount, std::max(error, previous.Error), 0, 0});
+    }
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<Vertex> &vertices,
+                                               std::span<const uint32_t> indices,
+                                               size_t targetIndexCount, float *resultError)
+{
+    const size_t vertexCount = vertices.size();
+
+    std::vector<uint32_t> result{indices.begin(), indices.end()};
+    result.resize(result.size() / 3 * 3);
+
+    const std::vector<bool> locked = LockedVertices(vertices, result);
+
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const glm::vec3 &p0 = vertices[result[i]].Position;
+        const glm::vec3 &p1 = vertices[result[i + 1]].Position;
+        const glm::vec3 &p2 = vertices[result[i + 2]].Position;
+
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float doubleArea = glm::length(normal);
+        if (doubleArea == 0.0f)
+        {
+            continue;
+        }
+
+        const glm::vec3 unitNormal = normal / doubleArea;
+        const Quadric quadric = PlaneQuadric(unitNormal, -glm::dot(unitNormal, p0), doubleArea);
+        for (size_t k = 0; k < 3; ++k)
+        {
+            AddQuadric(quadrics[result[i + k]], quadric);
+        }
+    }
+
+    struct Collapse
+    {
+        uint32_t From;
+        uint32_t To;
+        float Error;
+    };
+
+    std::vector<Collapse> collapses{};
+    std::vector<uint32_t> triangleCounts(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency{};
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+    float maxError = 0.0f;
+
+    // Moving `from` onto `to` must not turn any of the remaining triangles around.
+    auto collapseFlips = [&](uint32_t from, uint32_t to) {
+        for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i)
+        {
+            const uint32_t *triangle = &result[adjacency[i] * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+            {
+                continue;
+            }
+
+            std::array<glm::vec3, 3> positions{};
+            for (size_t k = 0; k < 3; ++k)
+            {
+                positions[k] = vertices[triangle[k]].Position;
+            }
+            const glm::vec3 before =
+                glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                if (triangle[k] == from)
+                {
+                    positions[k] = vertices[to].Position;
+                }
+            }
+            const glm::vec3 after =
+                glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+
+            if (glm::dot(before, after) <= 0.0f)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    // Each pass collapses the cheapest edges that don't share a neighborhood,
+    // until the target is met or nothing can be collapsed anymore.
+    while (result.size() > targetIndexCount)
+    {
+        const size_t triangleCount = result.size() / 3;
+
+        std::fill(triangleCounts.begin(), triangleCounts.end(), 0);
+        for (uint32_t index : result)
+        {
+            ++triangleCounts[index];
+        }
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + triangleCounts[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fillOffsets{adjacencyOffsets.begin(), adjacencyOffsets.end() - 1};
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            for (size_t k = 0; k < 3; ++k)
+            {
+                adjacency[fillOffsets[result[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const uint32_t a = result[t * 3 + k];
+                const uint32_t b = result[t * 3 + (k + 1) % 3];
+                if (!locked[a])
+                {
+                    collapses.push_back({a, b, QuadricError(quadrics[a], vertices[b].Position)});
+                }
+                if (!locked[b])
+                {
+                    collapses.push_back({b, a, QuadricError(quadrics[b], vertices[a].Position)});
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse &a, const Collapse &b) { return a.Error < b.Error; });
+
+        std::fill(touched.begin(), touched.end(), false);
+        std::iota(remap.begin(), remap.end(), 0);
+
+        const size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t trianglesRemoved = 0;
+        size_t collapsed = 0;
+
+        for (const Collapse &collapse : collapses)
+        {
+            if (trianglesRemoved >= trianglesToRemove)
+            {
+                break;
+            }
+
+            if (touched[collapse.From] || touched[collapse.To] ||
+                collapseFlips(collapse.From, collapse.To))
+            {
+                continue;
+            }
+
+            // the flip test above relies on the neighborhood staying put during this pass
+            for (uint32_t i = adjacencyOffsets[collapse.From];
+                 i < adjacencyOffsets[collapse.From + 1]; ++i)
+            {
+                const uint32_t *triangle = &result[adjacency[i] * 3];
+                bool sharesEdge = false;
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    touched[triangle[k]] = true;
+                    sharesEdge = sharesEdge || triangle[k] == collapse.To;
+                }
+                if (sharesEdge)
+                {
+                    ++trianglesRemoved;
+                }
+            }
+
+            remap[collapse.From] = collapse.To;
+            AddQuadric(quadrics[collapse.To], quadrics[collapse.From]);
+            maxError = std::max(maxError, collapse.Error);
+            ++collapsed;
+        }
+
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            const uint32_t a = remap[result[t * 3]];
+            const uint32_t b = remap[result[t * 3 + 1]];
+            const uint32_t c = remap[result[t * 3 + 2]];
+            if (a != b && b != c && a != c)
+            {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    if (resultError)
+    {
+        *resultError = std::sqrt(maxError);
+    }
+
+    return result;
+}
+
+} // namespace vkstart
\ No newline at end of file
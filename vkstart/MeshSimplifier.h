@@ -0,0 +1,24 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "Mesh.h"
+
+namespace vkstart
+{
+
+struct MeshSimplifier
+{
+    // Appends up to `maxLodCount - 1` coarser index ranges to `mesh.Indices`, each with
+    // about `reduction` times the triangles of the previous one, sharing `mesh.Vertices`.
+    static void GenerateLods(Mesh &mesh, size_t maxLodCount = 5, float reduction = 0.5f);
+
+    // Quadric error edge collapse down to about `targetIndexCount` indices.
+    // Borders and attribute seams are kept in place, so the result may stay above the target.
+    // `resultError` receives the object space error of the result.
+    static std::vector<uint32_t> Simplify(const std::vector<Vertex> &vertices,
+                                          std::span<const uint32_t> indices,
+                                          size_t targetIndexCount, float *resultError);
+};
+
+} // namespace vkstart
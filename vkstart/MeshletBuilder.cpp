@@ -0,0 +1,162 @@
+#include "MeshletBuilder.h"
+
+namespace vkstart
+{
+
+constexpr uint32_t NoLocalIndex = std::numeric_limits<uint32_t>::max();
+
+// Below this, the triangle normals spread too far for the cone to ever cull anything.
+constexpr float MinConeSpread = 0.1f;
+
+static void ComputeMeshletBounds(const Mesh &mesh, Meshlet &meshlet)
+{
+    glm::vec3 minimum = mesh.Vertices[mesh.MeshletVertices[meshlet.VertexOffset]].Position;
+    glm::vec3 maximum = minimum;
+    for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+    {
+        const glm::vec3 &position =
+            mesh.Vertices[mesh.MeshletVertices[meshlet.VertexOffset + i]].Position;
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+
+    meshlet.Center = (minimum + maximum) * 0.5f;
+    meshlet.Radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+    {
+        const glm::vec3 &position =
+            mesh.Vertices[mesh.MeshletVertices[meshlet.VertexOffset + i]].Position;
+        meshlet.Radius = std::max(meshlet.Radius, glm::distance(meshlet.Center, position));
+    }
+
+    std::vector<glm::vec3> normals{};
+    normals.reserve(meshlet.TriangleCount);
+    glm::vec3 axis{0.0f};
+    for (uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+    {
+        const uint32_t *triangle = &mesh.Indices[(meshlet.TriangleOffset + t) * 3];
+        const glm::vec3 &p0 = mesh.Vertices[triangle[0]].Position;
+        const glm::vec3 &p1 = mesh.Vertices[triangle[1]].Position;
+        const glm::vec3 &p2 = mesh.Vertices[triangle[2]].Position;
+
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+    }
+
+    const float axisLength = glm::length(axis);
+    float minDot = 1.0f;
+    if (axisLength > 0.0f)
+    {
+        axis /= axisLength;
+        for (const glm::vec3 &normal : normals)
+        {
+            minDot = std::min(minDot, glm::dot(normal, axis));
+        }
+    }
+
+    if (axisLength == 0.0f || minDot <= MinConeSpread)
+    {
+        // a zero axis never passes the backface test
+        meshlet.ConeAxis = glm::vec3{0.0f};
+        meshlet.ConeCutoff = 1.0f;
+        return;
+    }
+
+    // all normals are within acos(minDot) of the axis, so the meshlet is backfacing as soon
+    // as the view direction is within 90 degrees minus that angle of the axis
+    meshlet.ConeAxis = axis;
+    meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void MeshletBuilder::Build(Mesh &mesh)
+{
+    mesh.Meshlets.clear();
+    mesh.MeshletVertices.clear();
+    mesh.MeshletTriangles.clear();
+
+    std::vector<uint32_t> localIndices(mesh.Vertices.size(), NoLocalIndex);
+
+    for (size_t level = 0; level < mesh.LodCount(); ++level)
+    {
+        const MeshLod lod = mesh.Lod(level);
+        assert(lod.FirstIndex == mesh.MeshletTriangles.size() * 3);
+
+        const auto firstMeshlet = static_cast<uint32_t>(mesh.Meshlets.size());
+
+        Meshlet meshlet{};
+        auto finishMeshlet = [&mesh, &meshlet, &localIndices]() {
+            if (meshlet.TriangleCount == 0)
+            {
+                return;
+            }
+
+            for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+            {
+                localIndices[mesh.MeshletVertices[meshlet.VertexOffset + i]] = NoLocalIndex;
+            }
+
+            ComputeMeshletBounds(mesh, meshlet);
+            mesh.Meshlets.push_back(meshlet);
+
+            meshlet = Meshlet{};
+            meshlet.VertexOffset = static_cast<uint32_t>(mesh.MeshletVertices.size());
+            meshlet.TriangleOffset = static_cast<uint32_t>(mesh.MeshletTriangles.size());
+        };
+
+        meshlet.VertexOffset = static_cast<uint32_t>(mesh.MeshletVertices.size());
+        meshlet.TriangleOffset = static_cast<uint32_t>(mesh.MeshletTriangles.size());
+
+        for (uint32_t i = lod.FirstIndex; i + 2 < lod.FirstIndex + lod.IndexCount; i += 3)
+        {
+            const uint32_t *triangle = &mesh.Indices[i];
+
+            uint32_t newVertices = 0;
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const bool repeated = (k > 0 && triangle[k] == triangle[0]) ||
+                                      (k > 1 && triangle[k] == triangle[1]);
+                if (localIndices[triangle[k]] == NoLocalIndex && !repeated)
+                {
+                    ++newVertices;
+                }
+            }
+
+            if (meshlet.VertexCount + newVertices > MaxMeshletVertices ||
+                meshlet.TriangleCount + 1 > MaxMeshletTriangles)
+            {
+                finishMeshlet();
+            }
+
+            uint32_t packedTriangle = 0;
+            for (size_t k = 0; k < 3; ++k)
+            {
+                uint32_t &localIndex = localIndices[triangle[k]];
+                if (localIndex == NoLocalIndex)
+                {
+                    localIndex = meshlet.VertexCount++;
+                    mesh.MeshletVertices.push_back(triangle[k]);
+                }
+                packedTriangle |= localIndex << (k * 8);
+            }
+
+            mesh.MeshletTriangles.push_back(packedTriangle);
+            ++meshlet.TriangleCount;
+        }
+
+        finishMeshlet();
+
+        if (!mesh.Lods.empty())
+        {
+            mesh.Lods[level].FirstMeshlet = firstMeshlet;
+            mesh.Lods[level].MeshletCount =
+                static_cast<uint32_t>(mesh.Meshlets.size()) - firstMeshlet;
+        }
+    }
+}
+
+} // namespace vkstart
\ No newline at end of file
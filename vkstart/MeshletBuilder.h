@@ -0,0 +1,22 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "Mesh.h"
+
+namespace vkstart
+{
+
+// Must match meshlet_common.slang.
+constexpr uint32_t MaxMeshletVertices = 64;
+constexpr uint32_t MaxMeshletTriangles = 124;
+
+struct MeshletBuilder
+{
+    // Splits every LOD of `mesh` into meshlets, keeping the triangle order, so that
+    // the triangles of each meshlet stay a contiguous range of `mesh.Indices`.
+    // Run this after `MeshOptimizer::Optimize`.
+    static void Build(Mesh &mesh);
+};
+
+} // namespace vkstart
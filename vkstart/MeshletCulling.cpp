@@ -0,0 +1,37 @@
+#include "MeshletCulling.h"
+
+namespace vkstart
+{
+
+std::array<glm::vec4, 6> FrustumPlanes(const glm::mat4 &viewProj)
+{
+    std::array<glm::vec4, 4> rows{};
+    for (glm::length_t i = 0; i < 4; ++i)
+    {
+        rows[i] = glm::vec4{viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]};
+    }
+
+    // Gribb/Hartmann, with a depth range of zero to one
+    std::array<glm::vec4, 6> planes = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+                                       rows[3] - rows[1], rows[2],           rows[3] - rows[2]};
+    for (glm::vec4 &plane : planes)
+    {
+        plane /= glm::length(glm::vec3{plane});
+    }
+
+    return planes;
+}
+
+MeshletCullConstants MeshletCullConstants::Create(const glm::mat4 &model, const glm::mat4 &view,
+                                                  const glm::mat4 &proj, const MeshLod &lod)
+{
+    MeshletCullConstants constants{};
+    constants.FrustumPlanes = FrustumPlanes(proj * view * model);
+    constants.CameraPosition = glm::vec3{glm::inverse(view * model)[3]};
+    constants.FirstMeshlet = lod.FirstMeshlet;
+    constants.MeshletCount = lod.MeshletCount;
+
+    return constants;
+}
+
+} // namespace vkstart
\ No newline at end of file
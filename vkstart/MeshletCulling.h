@@ -0,0 +1,31 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "Mesh.h"
+
+namespace vkstart
+{
+
+// Workgroup sizes of `CullMain` in cull.slang and `TaskMain` in meshlet.slang.
+constexpr uint32_t CullGroupSize = 64;
+constexpr uint32_t TaskGroupSize = 32;
+
+// Normalized planes of the view frustum of `viewProj`, pointing inwards, in the space
+// that `viewProj` transforms from.
+std::array<glm::vec4, 6> FrustumPlanes(const glm::mat4 &viewProj);
+
+// Push constants of the meshlet culling shaders, laid out to match `CullConstants`
+// in meshlet_common.slang. Everything is in object space.
+struct MeshletCullConstants
+{
+    std::array<glm::vec4, 6> FrustumPlanes;
+    glm::vec3 CameraPosition;
+    uint32_t FirstMeshlet;
+    uint32_t MeshletCount;
+
+    static MeshletCullConstants Create(const glm::mat4 &model, const glm::mat4 &view,
+                                       const glm::mat4 &proj, const MeshLod &lod);
+};
+
+} // namespace vkstart
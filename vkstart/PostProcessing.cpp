@@ -0,0 +1,460 @@
+#include "PostProcessing.h"
+
+namespace vkstart
+{
+
+// Written by `Record`: one before the first effect, and one after each.
+constexpr uint32_t PostBeginTimestamp = 0;
+constexpr uint32_t PostTimestampsPerFrame = PostEffectCount + 1;
+
+// See post.slang.
+constexpr uint32_t PostGroupSize = 8;
+
+// Bindings of the descriptor set all the effects share, see post.slang.
+constexpr uint32_t SourceBinding = 0;
+constexpr uint32_t TargetBinding = 1;
+constexpr uint32_t LutBinding = 2;
+
+constexpr vk::Format LutFormat = vk::Format::eR8G8B8A8Unorm;
+constexpr uint32_t LutTexelSize = 4;
+
+constexpr vk::ImageSubresourceRange ColorRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+
+static uint8_t LutChannel(float value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+ColorLut IdentityColorLut(uint32_t size)
+{
+    ColorLut lut{size};
+    lut.Texels.reserve(static_cast<size_t>(size) * size * size * LutTexelSize);
+
+    const float scale = 1.0f / static_cast<float>(size - 1);
+    for (uint32_t b = 0; b < size; ++b)
+    {
+        for (uint32_t g = 0; g < size; ++g)
+        {
+            for (uint32_t r = 0; r < size; ++r)
+            {
+                lut.Texels.insert(lut.Texels.end(), {LutChannel(r * scale), LutChannel(g * scale),
+                                                     LutChannel(b * scale), 255});
+            }
+        }
+    }
+
+    return lut;
+}
+
+ColorLut ParseCubeLut(std::span<const char> text)
+{
+    ColorLut lut{};
+    glm::vec3 domainMin{0.0f};
+    glm::vec3 domainMax{1.0f};
+    std::vector<glm::vec3> entries{};
+
+    // parses the numbers following `keyword`, if the line starts with it
+    auto parse = [](const std::string &line, std::string_view keyword, float *values,
+                    size_t count) {
+        if (!line.starts_with(keyword))
+        {
+            return false;
+        }
+
+        const char *begin = line.c_str() + keyword.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            char *end = nullptr;
+            values[i] = std::strtof(begin, &end);
+            if (end == begin)
+            {
+                throw std::runtime_error{"malformed .cube line: " + line};
+            }
+            begin = end;
+        }
+        return true;
+    };
+
+    auto lineBegin = text.begin();
+    while (lineBegin != text.end())
+    {
+        const auto lineEnd = std::find(lineBegin, text.end(), '\n');
+        std::string line{lineBegin, lineEnd};
+        lineBegin = lineEnd == text.end() ? lineEnd : lineEnd + 1;
+
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+
+        float size = 0.0f;
+        glm::vec3 entry{};
+        if (line.empty() || line.starts_with('#') || line.starts_with("TITLE"))
+        {
+            continue;
+        }
+        if (line.starts_with("LUT_1D_SIZE"))
+        {
+            throw std::runtime_error{"1D .cube tables aren't supported"};
+        }
+        if (parse(line, "LUT_3D_SIZE", &size, 1))
+        {
+            lut.Size = static_cast<uint32_t>(size);
+        }
+        else if (!parse(line, "DOMAIN_MIN", &domainMin.x, 3) &&
+                 !parse(line, "DOMAIN_MAX", &domainMax.x, 3) && parse(line, "", &entry.x, 3))
+        {
+            entries.push_back(entry);
+        }
+    }
+
+    if (lut.Size < 2 || entries.size() != static_cast<size_t>(lut.Size) * lut.Size * lut.Size)
+    {
+        throw std::runtime_error{".cube file without a complete 3D table"};
+    }
+
+    // the texture coordinates cover the domain
+    lut.Texels.reserve(entries.size() * LutTexelSize);
+    for (const glm::vec3 &entry : entries)
+    {
+        const glm::vec3 color = (entry - domainMin) / (domainMax - domainMin);
+        lut.Texels.insert(lut.Texels.end(), {LutChannel(color.r), LutChannel(color.g),
+                                             LutChannel(color.b), 255});
+    }
+
+    return lut;
+}
+
+PostProcessing::PostProcessing(const vk::raii::PhysicalDevice &physicalDevice,
+                               const vk::raii::Device &device, DeletionQueue &deletionQueue,
+                               uint32_t queueFamilyIndex, vk::DescriptorSetLayout setLayout,
+                               uint32_t framesInFlight, const ColorLut &lut)
+    : m_physicalDevice{physicalDevice}, m_device{device}, m_deletionQueue{deletionQueue},
+      m_setLayout{setLayout}, m_framesInFlight{framesInFlight},
+      m_timestamps{physicalDevice, device, queueFamilyIndex, framesInFlight,
+                   PostTimestampsPerFrame},
+      m_lutSize{lut.Size}
+{
+    vk::SamplerCreateInfo samplerCreateInfo{{},
+                                            vk::Filter::eLinear,
+                                            vk::Filter::eLinear,
+                                            vk::SamplerMipmapMode::eNearest,
+                                            vk::SamplerAddressMode::eClampToEdge,
+                                            vk::SamplerAddressMode::eClampToEdge,
+                                            vk::SamplerAddressMode::eClampToEdge};
+    m_sampler = vk::raii::Sampler{m_device, samplerCreateInfo};
+
+    m_lut = CreateImage(vk::ImageType::e3D, LutFormat, {lut.Size, lut.Size, lut.Size},
+                        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled);
+
+    const vk::DeviceSize stagingSize = lut.Texels.size();
+    vk::BufferCreateInfo bufferCreateInfo{
+        {}, stagingSize, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive};
+    m_lutStaging = vk::raii::Buffer{m_device, bufferCreateInfo};
+    vk::MemoryRequirements stagingRequirements = m_lutStaging.getMemoryRequirements();
+    vk::MemoryAllocateInfo stagingAllocInfo{
+        stagingRequirements.size,
+        FindMemoryType(stagingRequirements.memoryTypeBits,
+                       vk::MemoryPropertyFlagBits::eHostVisible |
+                           vk::MemoryPropertyFlagBits::eHostCoherent)};
+    m_lutStagingMemory = vk::raii::DeviceMemory{m_device, stagingAllocInfo};
+    m_lutStaging.bindMemory(*m_lutStagingMemory, 0);
+
+    void *data = m_lutStagingMemory.mapMemory(0, stagingSize);
+    memcpy(data, lut.Texels.data(), stagingSize);
+    m_lutStagingMemory.unmapMemory();
+}
+
+void PostProcessing::RecordLutUpload(const vk::raii::CommandBuffer &commandBuffer, uint64_t frame)
+{
+    vk::ImageMemoryBarrier2 toTransfer{vk::PipelineStageFlagBits2::eNone,
+                                       {},
+                                       vk::PipelineStageFlagBits2::eCopy,
+                                       vk::AccessFlagBits2::eTransferWrite,
+                                       vk::ImageLayout::eUndefined,
+                                       vk::ImageLayout::eTransferDstOptimal,
+                                       vk::QueueFamilyIgnored,
+                                       vk::QueueFamilyIgnored,
+                                       m_lut.Image,
+                                       ColorRange};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, toTransfer});
+
+    const vk::ImageSubresourceLayers layers{vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+    const vk::BufferImageCopy region{0, 0, 0, layers, {0, 0, 0}, {m_lutSize, m_lutSize, m_lutSize}};
+    commandBuffer.copyBufferToImage(m_lutStaging, m_lut.Image,
+                                    vk::ImageLayout::eTransferDstOptimal, region);
+
+    vk::ImageMemoryBarrier2 toShaderRead{vk::PipelineStageFlagBits2::eCopy,
+                                         vk::AccessFlagBits2::eTransferWrite,
+                                         vk::PipelineStageFlagBits2::eComputeShader,
+                                         vk::AccessFlagBits2::eShaderSampledRead,
+                                         vk::ImageLayout::eTransferDstOptimal,
+                                         vk::ImageLayout::eShaderReadOnlyOptimal,
+                                         vk::QueueFamilyIgnored,
+                                         vk::QueueFamilyIgnored,
+                                         m_lut.Image,
+                                         ColorRange};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, toShaderRead});
+
+    m_deletionQueue.Retire(std::move(m_lutStaging), frame);
+    m_deletionQueue.Retire(std::move(m_lutStagingMemory), frame);
+}
+
+void PostProcessing::Resize(vk::Extent2D extent, std::span<const vk::ImageView> outputViews,
+                            uint64_t frame)
+{
+    // no waiting for the device, the frames in flight keep using the old images
+    m_deletionQueue.Retire(std::move(m_descriptorSets), frame);
+    m_deletionQueue.Retire(std::move(m_descriptorPool), frame);
+    m_deletionQueue.Retire(std::move(m_sceneImages), frame);
+    m_deletionQueue.Retire(std::move(m_intermediates), frame);
+    m_deletionQueue.Retire(std::move(m_output), frame);
+
+    m_extent = extent;
+    const vk::Extent3D extent3D{extent.width, extent.height, 1};
+
+    m_sceneImages.clear();
+    for (uint32_t i = 0; i < m_framesInFlight; ++i)
+    {
+        m_sceneImages.push_back(CreateImage(
+            vk::ImageType::e2D, SceneFormat, extent3D,
+            vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled));
+    }
+    for (OwnedImage &intermediate : m_intermediates)
+    {
+        intermediate =
+            CreateImage(vk::ImageType::e2D, SceneFormat, extent3D,
+                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled);
+    }
+    m_output = OwnedImage{};
+    if (outputViews.empty())
+    {
+        m_output =
+            CreateImage(vk::ImageType::e2D, SceneFormat, extent3D,
+                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc);
+    }
+
+    const auto sharpenSetCount = static_cast<uint32_t>(std::max<size_t>(outputViews.size(), 1));
+    const uint32_t setCount = m_framesInFlight + 1 + sharpenSetCount;
+    const std::array poolSizes{
+        vk::DescriptorPoolSize{vk::DescriptorType::eCombinedImageSampler, setCount * 2},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, setCount}};
+    vk::DescriptorPoolCreateInfo poolCreateInfo{
+        vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, setCount, poolSizes};
+    m_descriptorPool = vk::raii::DescriptorPool{m_device, poolCreateInfo};
+
+    std::vector<vk::DescriptorSetLayout> layouts(setCount, m_setLayout);
+    m_descriptorSets =
+        m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{m_descriptorPool, layouts});
+
+    for (uint32_t i = 0; i < m_framesInFlight; ++i)
+    {
+        WriteDescriptorSet(TonemapSet(i), m_sceneImages[i].View, m_intermediates[0].View);
+    }
+    WriteDescriptorSet(GradeSet(), m_intermediates[0].View, m_intermediates[1].View);
+    for (uint32_t i = 0; i < sharpenSetCount; ++i)
+    {
+        WriteDescriptorSet(SharpenSet(i), m_intermediates[1].View,
+                           outputViews.empty() ? *m_output.View : outputViews[i]);
+    }
+}
+
+vk::Image PostProcessing::SceneImage(uint32_t frame) const
+{
+    return m_sceneImages[frame].Image;
+}
+
+vk::ImageView PostProcessing::SceneImageView(uint32_t frame) const
+{
+    return m_sceneImages[frame].View;
+}
+
+vk::Image PostProcessing::OutputImage() const
+{
+    return m_output.Image;
+}
+
+void PostProcessing::Record(const vk::raii::CommandBuffer &commandBuffer, uint32_t frame,
+                            uint32_t outputIndex, vk::Extent2D renderExtent,
+                            const PostPipelines &pipelines, float exposure, float sharpness)
+{
+    m_timestamps.Reset(commandBuffer, frame);
+    m_timestamps.Write(commandBuffer, frame, PostBeginTimestamp,
+                       vk::PipelineStageFlagBits2::eTopOfPipe);
+
+    // the previous frame's passes may still read them
+    const vk::Image outputImage = *m_output.Image;
+    std::vector<vk::ImageMemoryBarrier2> toGeneral{};
+    for (vk::Image image : {*m_intermediates[0].Image, *m_intermediates[1].Image, outputImage})
+    {
+        if (image)
+        {
+            toGeneral.push_back(vk::ImageMemoryBarrier2{
+                vk::PipelineStageFlagBits2::eComputeShader, {},
+                vk::PipelineStageFlagBits2::eComputeShader,
+                vk::AccessFlagBits2::eShaderStorageWrite, vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eGeneral, vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, image,
+                ColorRange});
+        }
+    }
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, toGeneral});
+
+    // makes what a pass wrote readable by the next one
+    auto toShaderRead = [&commandBuffer](vk::Image image) {
+        vk::ImageMemoryBarrier2 barrier{vk::PipelineStageFlagBits2::eComputeShader,
+                                        vk::AccessFlagBits2::eShaderStorageWrite,
+                                        vk::PipelineStageFlagBits2::eComputeShader,
+                                        vk::AccessFlagBits2::eShaderSampledRead,
+                                        vk::ImageLayout::eGeneral,
+                                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                                        vk::QueueFamilyIgnored,
+                                        vk::QueueFamilyIgnored,
+                                        image,
+                                        ColorRange};
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, barrier});
+    };
+
+    // every image is as large as the output, the scene covers the top left of it
+    const glm::vec2 size{m_extent.width, m_extent.height};
+    PostConstants constants{glm::vec2{renderExtent.width, renderExtent.height} / size,
+                            1.0f / size,
+                            {renderExtent.width, renderExtent.height},
+                            exposure,
+                            sharpness};
+
+    Dispatch(commandBuffer, pipelines.Tonemap, pipelines, TonemapSet(frame), constants);
+    m_timestamps.Write(commandBuffer, frame, PostBeginTimestamp + 1,
+                       vk::PipelineStageFlagBits2::eComputeShader);
+    toShaderRead(m_intermediates[0].Image);
+
+    Dispatch(commandBuffer, pipelines.Grade, pipelines, GradeSet(), constants);
+    m_timestamps.Write(commandBuffer, frame, PostBeginTimestamp + 2,
+                       vk::PipelineStageFlagBits2::eComputeShader);
+    toShaderRead(m_intermediates[1].Image);
+
+    // scales up to the whole output while sharpening
+    constants.Extent = {m_extent.width, m_extent.height};
+    Dispatch(commandBuffer, pipelines.Sharpen, pipelines,
+             SharpenSet(outputImage ? 0 : outputIndex), constants);
+    m_timestamps.Write(commandBuffer, frame, PostBeginTimestamp + 3,
+                       vk::PipelineStageFlagBits2::eComputeShader);
+}
+
+void PostProcessing::ReadTimings(uint32_t frame)
+{
+    m_timestamps.Read(frame);
+    for (uint32_t effect = 0; effect < PostEffectCount; ++effect)
+    {
+        m_effectTimes[effect] = m_timestamps.Elapsed(frame, PostBeginTimestamp + effect,
+                                                     PostBeginTimestamp + effect + 1);
+    }
+}
+
+std::optional<double> PostProcessing::EffectTime(PostEffect effect) const
+{
+    return m_effectTimes[static_cast<size_t>(effect)];
+}
+
+PostProcessing::OwnedImage PostProcessing::CreateImage(vk::ImageType type,
+                                                       vk::Format format,
+                                                       vk::Extent3D extent,
+                                                       vk::ImageUsageFlags usage) const
+{
+    const uint32_t mipLevels = 1;
+    const uint32_t arrayLayers = 1;
+    vk::ImageCreateInfo imageCreateInfo{{},
+                                        type,
+                                        format,
+                                        extent,
+                                        mipLevels,
+                                        arrayLayers,
+                                        vk::SampleCountFlagBits::e1,
+                                        vk::ImageTiling::eOptimal,
+                                        usage,
+                                        vk::SharingMode::eExclusive,
+                                        {},
+                                        vk::ImageLayout::eUndefined};
+
+    OwnedImage image{};
+    image.Image = vk::raii::Image{m_device, imageCreateInfo};
+
+    vk::MemoryRequirements memRequirements = image.Image.getMemoryRequirements();
+    vk::MemoryAllocateInfo allocInfo{
+        memRequirements.size,
+        FindMemoryType(memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)};
+    image.Memory = vk::raii::DeviceMemory{m_device, allocInfo};
+    image.Image.bindMemory(image.Memory, 0);
+
+    const vk::ImageViewType viewType =
+        type == vk::ImageType::e3D ? vk::ImageViewType::e3D : vk::ImageViewType::e2D;
+    vk::ImageViewCreateInfo viewCreateInfo{{}, image.Image, viewType, format, {}, ColorRange};
+    image.View = vk::raii::ImageView{m_device, viewCreateInfo};
+
+    return image;
+}
+
+uint32_t PostProcessing::FindMemoryType(uint32_t typeFilter,
+                                        vk::MemoryPropertyFlags properties) const
+{
+    vk::PhysicalDeviceMemoryProperties memProperties = m_physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) &&
+            (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("no suitable memory type found");
+}
+
+void PostProcessing::WriteDescriptorSet(vk::DescriptorSet set, vk::ImageView source,
+                                        vk::ImageView target) const
+{
+    const vk::DescriptorImageInfo sourceInfo{m_sampler, source,
+                                             vk::ImageLayout::eShaderReadOnlyOptimal};
+    const vk::DescriptorImageInfo targetInfo{{}, target, vk::ImageLayout::eGeneral};
+    const vk::DescriptorImageInfo lutInfo{m_sampler, m_lut.View,
+                                          vk::ImageLayout::eShaderReadOnlyOptimal};
+
+    const uint32_t dstArrayElement = 0;
+    const std::array writes{
+        vk::WriteDescriptorSet{set, SourceBinding, dstArrayElement,
+                               vk::DescriptorType::eCombinedImageSampler, sourceInfo},
+        vk::WriteDescriptorSet{set, TargetBinding, dstArrayElement,
+                               vk::DescriptorType::eStorageImage, targetInfo},
+        vk::WriteDescriptorSet{set, LutBinding, dstArrayElement,
+                               vk::DescriptorType::eCombinedImageSampler, lutInfo}};
+    m_device.updateDescriptorSets(writes, {});
+}
+
+vk::DescriptorSet PostProcessing::TonemapSet(uint32_t frame) const
+{
+    return m_descriptorSets[frame];
+}
+
+vk::DescriptorSet PostProcessing::GradeSet() const
+{
+    return m_descriptorSets[m_framesInFlight];
+}
+
+vk::DescriptorSet PostProcessing::SharpenSet(uint32_t output) const
+{
+    return m_descriptorSets[m_framesInFlight + 1 + output];
+}
+
+void PostProcessing::Dispatch(const vk::raii::CommandBuffer &commandBuffer, vk::Pipeline pipeline,
+                              const PostPipelines &pipelines, vk::DescriptorSet set,
+                              const PostConstants &constants) const
+{
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelines.Layout, 0, set,
+                                     {});
+    commandBuffer.pushConstants<PostConstants>(pipelines.Layout, pipelines.ConstantStages, 0,
+                                               constants);
+
+    const uint32_t groupsX = (constants.Extent.x + PostGroupSize - 1) / PostGroupSize;
+    const uint32_t groupsY = (constants.Extent.y + PostGroupSize - 1) / PostGroupSize;
+    commandBuffer.dispatch(groupsX, groupsY, 1);
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "DeletionQueue.h"
+#include "GpuTimestamps.h"
+
+namespace vkstart
+{
+
+// The effects of the post-processing chain, in the order they run.
+enum class PostEffect
+{
+    Tonemap,
+    Grade,
+    Sharpen,
+};
+
+constexpr uint32_t PostEffectCount = 3;
+
+// A 3D color lookup table for grading, RGBA8 texels with red varying fastest, then green.
+// Like the tables color grading tools export, it maps sRGB encoded colors.
+struct ColorLut
+{
+    uint32_t Size = 0;
+    std::vector<uint8_t> Texels;
+};
+
+ColorLut IdentityColorLut(uint32_t size);
+
+// Parses a .cube file with a 3D table; throws if it has none, or is malformed.
+ColorLut ParseCubeLut(std::span<const char> text);
+
+// See post.slang.
+struct PostConstants
+{
+    glm::vec2 UvScale;
+    glm::vec2 TexelSize;
+    glm::uvec2 Extent;
+    float Exposure;
+    float Sharpness;
+};
+
+// Built from post.slang, one entry point per effect, sharing `Layout`.
+struct PostPipelines
+{
+    vk::Pipeline Tonemap;
+    vk::Pipeline Grade;
+    vk::Pipeline Sharpen;
+    vk::PipelineLayout Layout;
+    vk::ShaderStageFlags ConstantStages;
+};
+
+// Tonemaps the HDR scene, grades it through a color LUT, and sharpens it while scaling it
+// up to the output, in compute passes on one queue. The scene images are per frame in
+// flight, so that the next frame can render its scene while the post-processing of this
+// one still reads; the images in between only ever get used on the post-processing queue,
+// whose submissions run in order.
+struct PostProcessing
+{
+    // what the scene gets rendered as, linear and unclamped
+    static constexpr vk::Format SceneFormat = vk::Format::eR16G16B16A16Sfloat;
+
+    PostProcessing(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device,
+                   DeletionQueue &deletionQueue, uint32_t queueFamilyIndex,
+                   vk::DescriptorSetLayout setLayout, uint32_t framesInFlight,
+                   const ColorLut &lut);
+
+    // Records uploading the LUT, on the post-processing queue, before the first `Record`.
+    // The staging buffer is retired with `frame`.
+    void RecordLutUpload(const vk::raii::CommandBuffer &commandBuffer, uint64_t frame);
+
+    // (Re)creates what depends on the output's size. The chain writes to `outputViews`,
+    // by index, which must allow storage, or to an output image of its own without them.
+    // Whatever gets replaced is retired with `frame`.
+    void Resize(vk::Extent2D extent, std::span<const vk::ImageView> outputViews, uint64_t frame);
+
+    vk::Image SceneImage(uint32_t frame) const;
+    vk::ImageView SceneImageView(uint32_t frame) const;
+    // only when there are no output views
+    vk::Image OutputImage() const;
+
+    // Runs the chain on the top left `renderExtent` of `frame`'s scene image, which must be
+    // in the ShaderReadOnlyOptimal layout and visible to compute shaders. Writes to output
+    // view `outputIndex`, which the caller must have transitioned to the General layout,
+    // or to the output image, which it leaves in the General layout.
+    void Record(const vk::raii::CommandBuffer &commandBuffer, uint32_t frame,
+                uint32_t outputIndex, vk::Extent2D renderExtent,
+                const PostPipelines &pipelines, float exposure, float sharpness);
+
+    // Reads the timings `frame` recorded the last time around, after waiting for its fence.
+    void ReadTimings(uint32_t frame);
+    // In milliseconds, of the last frame read, if the queue has timestamps.
+    std::optional<double> EffectTime(PostEffect effect) const;
+
+  private:
+    struct OwnedImage
+    {
+        vk::raii::DeviceMemory Memory = nullptr;
+        vk::raii::Image Image = nullptr;
+        vk::raii::ImageView View = nullptr;
+    };
+
+    OwnedImage CreateImage(vk::ImageType type, vk::Format format, vk::Extent3D extent,
+                           vk::ImageUsageFlags usage) const;
+    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+    void WriteDescriptorSet(vk::DescriptorSet set, vk::ImageView source,
+                            vk::ImageView target) const;
+    vk::DescriptorSet TonemapSet(uint32_t frame) const;
+    vk::DescriptorSet GradeSet() const;
+    vk::DescriptorSet SharpenSet(uint32_t output) const;
+    void Dispatch(const vk::raii::CommandBuffer &commandBuffer, vk::Pipeline pipeline,
+                  const PostPipelines &pipelines, vk::DescriptorSet set,
+                  const PostConstants &constants) const;
+
+    const vk::raii::PhysicalDevice &m_physicalDevice;
+    const vk::raii::Device &m_device;
+    DeletionQueue &m_deletionQueue;
+    vk::DescriptorSetLayout m_setLayout;
+    uint32_t m_framesInFlight;
+
+    GpuTimestamps m_timestamps;
+    std::array<std::optional<double>, PostEffectCount> m_effectTimes{};
+
+    vk::raii::Sampler m_sampler = nullptr;
+    uint32_t m_lutSize;
+    OwnedImage m_lut;
+    vk::raii::Buffer m_lutStaging = nullptr;
+    vk::raii::DeviceMemory m_lutStagingMemory = nullptr;
+
+    vk::Extent2D m_extent{};
+    std::vector<OwnedImage> m_sceneImages;
+    // tonemapped, then graded
+    std::array<OwnedImage, 2> m_intermediates;
+    OwnedImage m_output;
+
+    vk::raii::DescriptorPool m_descriptorPool = nullptr;
+    // a tonemap set per frame in flight, the grade set, and a sharpen set per output view,
+    // or the one for the output image
+    std::vector<vk::raii::DescriptorSet> m_descriptorSets;
+};
+
+} // namespace vkstart
@@ -13,20 +13,27 @@ QueueFamilyIndices::QueueFamilyIndices(const vk::raii::PhysicalDevice &physicalD
     {
         const vk::QueueFamilyProperties &properties = queueFamilyProperties[i];
         vk::QueueFlags graphicFlag = properties.queueFlags & vk::QueueFlagBits::eGraphics;
-        if (graphicFlag != queueFlagsZero)
+        vk::QueueFlags computeFlag = properties.queueFlags & vk::QueueFlagBits::eCompute;
+        vk::QueueFlags transferFlag = properties.queueFlags & vk::QueueFlagBits::eTransfer;
+        if (graphicFlag != queueFlagsZero && !m_graphicsIndex)
         {
             m_graphicsIndex = i;
         }
 
-        VkBool32 presentSupport = physicalDevice.getSurfaceSupportKHR(i, *surface);
-        if (presentSupport)
+        if (!m_presentIndex && physicalDevice.getSurfaceSupportKHR(i, *surface))
         {
             m_presentIndex = i;
         }
 
-        if (IsComplete())
+        if (computeFlag != queueFlagsZero && graphicFlag == queueFlagsZero && !m_computeIndex)
         {
-            break;
+            m_computeIndex = i;
+        }
+
+        if (transferFlag != queueFlagsZero && graphicFlag == queueFlagsZero &&
+            computeFlag == queueFlagsZero && !m_transferIndex)
+        {
+            m_transferIndex = i;
         }
     }
 }
@@ -46,4 +53,24 @@ uint32_t QueueFamilyIndices::PresentIndex() const
     return m_presentIndex.value();
 }
 
+bool QueueFamilyIndices::HasDedicatedCompute() const
+{
+    return m_computeIndex.has_value();
+}
+
+uint32_t QueueFamilyIndices::ComputeIndex() const
+{
+    return m_computeIndex.value_or(GraphicsIndex());
+}
+
+bool QueueFamilyIndices::HasDedicatedTransfer() const
+{
+    return m_transferIndex.has_value();
+}
+
+uint32_t QueueFamilyIndices::TransferIndex() const
+{
+    return m_transferIndex.value_or(GraphicsIndex());
+}
+
 } // namespace vkstart
\ No newline at end of file
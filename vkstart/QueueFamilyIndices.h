@@ -17,9 +17,21 @@ struct QueueFamilyIndices
     uint32_t GraphicsIndex() const;
     uint32_t PresentIndex() const;
 
+    // A family with compute but without graphics, for async compute.
+    bool HasDedicatedCompute() const;
+    // The dedicated compute family if there is one, the graphics family otherwise.
+    uint32_t ComputeIndex() const;
+
+    // A family with transfers only, usually backed by a DMA engine.
+    bool HasDedicatedTransfer() const;
+    // The dedicated transfer family if there is one, the graphics family otherwise.
+    uint32_t TransferIndex() const;
+
   private:
     std::optional<uint32_t> m_graphicsIndex;
     std::optional<uint32_t> m_presentIndex;
+    std::optional<uint32_t> m_computeIndex;
+    std::optional<uint32_t> m_transferIndex;
 };
 
 } // namespace vkstart
@@ -0,0 +1,83 @@
+#include "ResolutionScaler.h"
+
+namespace vkstart
+{
+
+constexpr float MinRenderScale = 0.5f;
+constexpr float MaxRenderScale = 1.0f;
+
+// Weight of the latest frame in the smoothed frame time, so that single slow
+// frames don't make the resolution jump around.
+constexpr double FrameTimeSmoothing = 0.1;
+
+// Nothing changes while the frame time is within this fraction below the target,
+// otherwise the scale would oscillate around it.
+constexpr double FrameTimeHeadroom = 0.1;
+
+// Largest change of the scale per frame.
+constexpr float MaxScaleStep = 0.02f;
+
+ResolutionScaler::ResolutionScaler(float scale, bool dynamic, float targetFrameTime)
+    : m_scale{std::clamp(scale, MinRenderScale, MaxRenderScale)}, m_dynamic{dynamic},
+      m_targetFrameTime{targetFrameTime}
+{
+}
+
+void ResolutionScaler::SetScale(float scale)
+{
+    m_scale = std::clamp(scale, MinRenderScale, MaxRenderScale);
+    m_dynamic = false;
+}
+
+void ResolutionScaler::SetDynamic(bool dynamic)
+{
+    m_dynamic = dynamic;
+    m_smoothedFrameTime = 0.0;
+}
+
+void ResolutionScaler::Update(double gpuFrameTime)
+{
+    if (!m_dynamic || gpuFrameTime <= 0.0)
+    {
+        return;
+    }
+
+    m_smoothedFrameTime = m_smoothedFrameTime == 0.0
+                              ? gpuFrameTime
+                              : std::lerp(m_smoothedFrameTime, gpuFrameTime, FrameTimeSmoothing);
+
+    const double target = m_targetFrameTime;
+    if (m_smoothedFrameTime <= target && m_smoothedFrameTime >= target * (1.0 - FrameTimeHeadroom))
+    {
+        return;
+    }
+
+    // the cost is roughly proportional to the pixel count, the square of the scale
+    const float ideal =
+        m_scale * static_cast<float>(std::sqrt(target * (1.0 - FrameTimeHeadroom / 2) /
+                                               m_smoothedFrameTime));
+    const float step = std::clamp(ideal - m_scale, -MaxScaleStep, MaxScaleStep);
+    m_scale = std::clamp(m_scale + step, MinRenderScale, MaxRenderScale);
+}
+
+float ResolutionScaler::Scale() const
+{
+    return m_scale;
+}
+
+bool ResolutionScaler::IsDynamic() const
+{
+    return m_dynamic;
+}
+
+vk::Extent2D ResolutionScaler::RenderExtent(vk::Extent2D outputExtent) const
+{
+    const auto scaled = [this](uint32_t size) {
+        return std::max(1u, static_cast<uint32_t>(std::lround(static_cast<float>(size) * m_scale)));
+    };
+
+    return {std::min(scaled(outputExtent.width), outputExtent.width),
+            std::min(scaled(outputExtent.height), outputExtent.height)};
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// Picks the fraction of the output resolution the scene gets rendered at, per axis.
+// Either fixed, or adjusted every frame to keep the GPU frame time within a budget.
+struct ResolutionScaler
+{
+    // `targetFrameTime` in milliseconds, only used while dynamic
+    ResolutionScaler(float scale, bool dynamic, float targetFrameTime);
+
+    // Fixes the scale, which ends dynamic scaling.
+    void SetScale(float scale);
+    void SetDynamic(bool dynamic);
+
+    // Feeds back how long the GPU took for a frame rendered at the current scale.
+    void Update(double gpuFrameTime);
+
+    float Scale() const;
+    bool IsDynamic() const;
+
+    // `outputExtent` scaled, at least 1x1
+    vk::Extent2D RenderExtent(vk::Extent2D outputExtent) const;
+
+  private:
+    float m_scale;
+    bool m_dynamic;
+    float m_targetFrameTime;
+    double m_smoothedFrameTime = 0.0;
+};
+
+} // namespace vkstart
+
@@ -0,0 +1,278 @@
+#include "Scene.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VKSTART_SCENE_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VKSTART_SCENE_NEON 1
+#endif
+
+namespace vkstart
+{
+
+// Column-major `a * b`, one result column per iteration: the columns of `a`
+// scaled by the components of the column of `b`.
+static glm::mat4 MultiplyTransforms(const glm::mat4 &a, const glm::mat4 &b)
+{
+#if defined(VKSTART_SCENE_SSE)
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    glm::mat4 result;
+    for (glm::length_t column = 0; column < 4; ++column)
+    {
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+        _mm_storeu_ps(&result[column][0], r);
+    }
+
+    return result;
+#elif defined(VKSTART_SCENE_NEON)
+    const float32x4_t a0 = vld1q_f32(&a[0][0]);
+    const float32x4_t a1 = vld1q_f32(&a[1][0]);
+    const float32x4_t a2 = vld1q_f32(&a[2][0]);
+    const float32x4_t a3 = vld1q_f32(&a[3][0]);
+
+    glm::mat4 result;
+    for (glm::length_t column = 0; column < 4; ++column)
+    {
+        float32x4_t r = vmulq_n_f32(a0, b[column][0]);
+        r = vmlaq_n_f32(r, a1, b[column][1]);
+        r = vmlaq_n_f32(r, a2, b[column][2]);
+        r = vmlaq_n_f32(r, a3, b[column][3]);
+        vst1q_f32(&result[column][0], r);
+    }
+
+    return result;
+#else
+    return a * b;
+#endif
+}
+
+static bool IsSphereInFrustum(const glm::vec4 &sphere,
+                              const std::array<glm::vec4, 6> &frustumPlanes)
+{
+    if (sphere.w < 0.0f)
+    {
+        return false;
+    }
+
+    for (const glm::vec4 &plane : frustumPlanes)
+    {
+        if (glm::dot(glm::vec3{plane}, glm::vec3{sphere}) + plane.w < -sphere.w)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Dirty subtrees handed to one job at a time; most of them are single nodes.
+constexpr size_t DirtyRootsPerJob = 64;
+
+constexpr size_t NodesPerCullJob = 1024;
+
+uint32_t Scene::AddNode(const glm::mat4 &localTransform, uint32_t parent)
+{
+    const auto node = static_cast<uint32_t>(m_parents.size());
+    assert(parent == NoParent || parent < node);
+
+    m_parents.push_back(parent);
+    m_firstChildren.push_back(NoParent);
+    m_nextSiblings.push_back(NoParent);
+    m_localTransforms.push_back(localTransform);
+    m_worldTransforms.push_back(localTransform);
+    m_localBounds.emplace_back(0.0f, 0.0f, 0.0f, -1.0f);
+    m_worldBounds.emplace_back(0.0f, 0.0f, 0.0f, -1.0f);
+    m_visible.push_back(0);
+    m_static.push_back(0);
+    m_dirty.push_back(1);
+    m_dirtyNodes.push_back(node);
+
+    if (parent != NoParent)
+    {
+        m_nextSiblings[node] = m_firstChildren[parent];
+        m_firstChildren[parent] = node;
+    }
+
+    return node;
+}
+
+void Scene::SetLocalTransform(uint32_t node, const glm::mat4 &localTransform)
+{
+    if (m_localTransforms[node] == localTransform)
+    {
+        return;
+    }
+    m_localTransforms[node] = localTransform;
+
+    if (!m_dirty[node])
+    {
+        m_dirty[node] = 1;
+        m_dirtyNodes.push_back(node);
+    }
+}
+
+void Scene::SetLocalBounds(uint32_t node, const glm::vec3 &center, float radius)
+{
+    m_localBounds[node] = glm::vec4{center, radius};
+
+    if (!m_dirty[node])
+    {
+        m_dirty[node] = 1;
+        m_dirtyNodes.push_back(node);
+    }
+}
+
+void Scene::SetStatic(uint32_t node, bool isStatic)
+{
+    if (m_static[node] != static_cast<uint8_t>(isStatic))
+    {
+        m_static[node] = isStatic ? 1 : 0;
+        ++m_staticVersion;
+    }
+}
+
+size_t Scene::UpdateWorldTransforms(JobSystem &jobs)
+{
+    // subtrees of dirty nodes without dirty ancestors are disjoint,
+    // and cover everything that needs an update
+    m_dirtyRoots.clear();
+    for (uint32_t node : m_dirtyNodes)
+    {
+        uint32_t ancestor = m_parents[node];
+        while (ancestor != NoParent && !m_dirty[ancestor])
+        {
+            ancestor = m_parents[ancestor];
+        }
+        if (ancestor == NoParent)
+        {
+            m_dirtyRoots.push_back(node);
+        }
+    }
+    m_dirtyNodes.clear();
+
+    std::atomic<size_t> updated = 0;
+    std::atomic<bool> staticUpdated = false;
+    auto update = [this, &updated, &staticUpdated](size_t begin, size_t end) {
+        std::vector<uint32_t> stack{};
+        size_t count = 0;
+        bool anyStatic = false;
+        for (size_t i = begin; i < end; ++i)
+        {
+            count += UpdateSubtree(m_dirtyRoots[i], stack, anyStatic);
+        }
+        updated.fetch_add(count, std::memory_order_relaxed);
+        if (anyStatic)
+        {
+            staticUpdated.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    jobs.ParallelFor(m_dirtyRoots.size(), DirtyRootsPerJob, update);
+
+    if (staticUpdated.load())
+    {
+        ++m_staticVersion;
+    }
+
+    return updated.load();
+}
+
+size_t Scene::UpdateSubtree(uint32_t root, std::vector<uint32_t> &stack, bool &anyStatic)
+{
+    size_t updated = 0;
+
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const uint32_t node = stack.back();
+        stack.pop_back();
+
+        const uint32_t parent = m_parents[node];
+        m_worldTransforms[node] =
+            parent == NoParent
+                ? m_localTransforms[node]
+                : MultiplyTransforms(m_worldTransforms[parent], m_localTransforms[node]);
+        const glm::mat4 &world = m_worldTransforms[node];
+
+        const glm::vec4 &local = m_localBounds[node];
+        const float scale = std::max({glm::length(glm::vec3{world[0]}),
+                                      glm::length(glm::vec3{world[1]}),
+                                      glm::length(glm::vec3{world[2]})});
+        m_worldBounds[node] = glm::vec4{glm::vec3{world * glm::vec4{glm::vec3{local}, 1.0f}},
+                                        local.w < 0.0f ? -1.0f : local.w * scale};
+
+        m_dirty[node] = 0;
+        anyStatic = anyStatic || m_static[node];
+        ++updated;
+
+        for (uint32_t child = m_firstChildren[node]; child != NoParent;
+             child = m_nextSiblings[child])
+        {
+            stack.push_back(child);
+        }
+    }
+
+    return updated;
+}
+
+void Scene::CullFrustum(const std::array<glm::vec4, 6> &frustumPlanes, JobSystem &jobs)
+{
+    auto cull = [this, &frustumPlanes](size_t begin, size_t end) {
+        for (size_t node = begin; node < end; ++node)
+        {
+            m_visible[node] = IsSphereInFrustum(m_worldBounds[node], frustumPlanes) ? 1 : 0;
+        }
+    };
+
+    jobs.ParallelFor(m_worldBounds.size(), NodesPerCullJob, cull);
+}
+
+size_t Scene::NodeCount() const
+{
+    return m_parents.size();
+}
+
+uint32_t Scene::Parent(uint32_t node) const
+{
+    return m_parents[node];
+}
+
+const glm::mat4 &Scene::LocalTransform(uint32_t node) const
+{
+    return m_localTransforms[node];
+}
+
+const glm::mat4 &Scene::WorldTransform(uint32_t node) const
+{
+    return m_worldTransforms[node];
+}
+
+const glm::vec4 &Scene::WorldBounds(uint32_t node) const
+{
+    return m_worldBounds[node];
+}
+
+bool Scene::IsVisible(uint32_t node) const
+{
+    return m_visible[node] != 0;
+}
+
+bool Scene::IsStatic(uint32_t node) const
+{
+    return m_static[node] != 0;
+}
+
+uint64_t Scene::StaticVersion() const
+{
+    return m_staticVersion;
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "JobSystem.h"
+
+namespace vkstart
+{
+
+constexpr uint32_t NoParent = std::numeric_limits<uint32_t>::max();
+
+// Transform hierarchy, as structure of arrays indexed by node.
+// Parents always come before their children, so the nodes are sorted topologically.
+struct Scene
+{
+    // `parent` must be `NoParent` or an existing node.
+    uint32_t AddNode(const glm::mat4 &localTransform, uint32_t parent = NoParent);
+
+    // Setting the transform a node already has doesn't count as a change.
+    void SetLocalTransform(uint32_t node, const glm::mat4 &localTransform);
+
+    // Bounding sphere of whatever gets drawn at `node`, in its local space.
+    // Nodes without bounds are never visible.
+    void SetLocalBounds(uint32_t node, const glm::vec3 &center, float radius);
+
+    // Static nodes are expected to hardly ever change, so that whatever gets derived from
+    // them can be cached, see `StaticVersion`. Nodes start out dynamic.
+    void SetStatic(uint32_t node, bool isStatic);
+
+    // Recomputes the world transforms and bounds of the nodes that changed since the
+    // last update, and of their descendants, and nothing else. Independent subtrees
+    // are updated in parallel. Returns the number of nodes updated.
+    size_t UpdateWorldTransforms(JobSystem &jobs);
+
+    // Tests the world bounds of every node against `frustumPlanes`, which point inwards.
+    void CullFrustum(const std::array<glm::vec4, 6> &frustumPlanes, JobSystem &jobs);
+
+    size_t NodeCount() const;
+    uint32_t Parent(uint32_t node) const;
+    const glm::mat4 &LocalTransform(uint32_t node) const;
+    const glm::mat4 &WorldTransform(uint32_t node) const;
+    // center and radius in world space, a negative radius meaning no bounds
+    const glm::vec4 &WorldBounds(uint32_t node) const;
+    bool IsVisible(uint32_t node) const;
+    bool IsStatic(uint32_t node) const;
+
+    // Changes whenever a static node gets updated, or a node becomes static or dynamic.
+    uint64_t StaticVersion() const;
+
+  private:
+    // sets `anyStatic` if any of the nodes updated is static
+    size_t UpdateSubtree(uint32_t root, std::vector<uint32_t> &stack, bool &anyStatic);
+
+    std::vector<uint32_t> m_parents;
+    std::vector<uint32_t> m_firstChildren;
+    std::vector<uint32_t> m_nextSiblings;
+    std::vector<glm::mat4> m_localTransforms;
+    std::vector<glm::mat4> m_worldTransforms;
+
+    // center and radius, a negative radius meaning no bounds
+    std::vector<glm::vec4> m_localBounds;
+    std::vector<glm::vec4> m_worldBounds;
+    std::vector<uint8_t> m_visible;
+    std::vector<uint8_t> m_static;
+    uint64_t m_staticVersion = 0;
+
+    std::vector<uint8_t> m_dirty;
+    std::vector<uint32_t> m_dirtyNodes;
+    std::vector<uint32_t> m_dirtyRoots;
+};
+
+} // namespace vkstart
@@ -0,0 +1,617 @@
+#include "ShaderReflection.h"
+
+namespace vkstart
+{
+
+// The parts of the SPIR-V specification the reflection needs.
+constexpr uint32_t SpirvMagic = 0x07230203;
+constexpr uint32_t SpirvMinVersion = 0x00010400;
+constexpr size_t SpirvHeaderWords = 5;
+
+constexpr uint32_t OpEntryPoint = 15;
+constexpr uint32_t OpTypeInt = 21;
+constexpr uint32_t OpTypeFloat = 22;
+constexpr uint32_t OpTypeVector = 23;
+constexpr uint32_t OpTypeMatrix = 24;
+constexpr uint32_t OpTypeImage = 25;
+constexpr uint32_t OpTypeSampler = 26;
+constexpr uint32_t OpTypeSampledImage = 27;
+constexpr uint32_t OpTypeArray = 28;
+constexpr uint32_t OpTypeRuntimeArray = 29;
+constexpr uint32_t OpTypeStruct = 30;
+constexpr uint32_t OpTypePointer = 32;
+constexpr uint32_t OpConstant = 43;
+constexpr uint32_t OpVariable = 59;
+constexpr uint32_t OpDecorate = 71;
+constexpr uint32_t OpMemberDecorate = 72;
+constexpr uint32_t OpTypeAccelerationStructure = 5341;
+
+constexpr uint32_t DecorationBufferBlock = 3;
+constexpr uint32_t DecorationArrayStride = 6;
+constexpr uint32_t DecorationBuiltIn = 11;
+constexpr uint32_t DecorationLocation = 30;
+constexpr uint32_t DecorationBinding = 33;
+constexpr uint32_t DecorationDescriptorSet = 34;
+constexpr uint32_t DecorationOffset = 35;
+
+constexpr uint32_t StorageClassUniformConstant = 0;
+constexpr uint32_t StorageClassInput = 1;
+constexpr uint32_t StorageClassUniform = 2;
+constexpr uint32_t StorageClassPushConstant = 9;
+constexpr uint32_t StorageClassStorageBuffer = 12;
+
+constexpr uint32_t DimBuffer = 5;
+constexpr uint32_t DimSubpassData = 6;
+
+// Where an instruction's result id is, for the ones the reflection looks up by id.
+static std::optional<size_t> ResultIdWord(uint32_t opcode)
+{
+    switch (opcode)
+    {
+    case OpTypeInt:
+    case OpTypeFloat:
+    case OpTypeVector:
+    case OpTypeMatrix:
+    case OpTypeImage:
+    case OpTypeSampler:
+    case OpTypeSampledImage:
+    case OpTypeArray:
+    case OpTypeRuntimeArray:
+    case OpTypeStruct:
+    case OpTypePointer:
+    case OpTypeAccelerationStructure:
+        return 1;
+    case OpConstant:
+    case OpVariable:
+        return 2;
+    default:
+        return std::nullopt;
+    }
+}
+
+static uint32_t Opcode(std::span<const uint32_t> instruction)
+{
+    return instruction[0] & 0xffff;
+}
+
+struct SpirvModule
+{
+    struct EntryPoint
+    {
+        uint32_t ExecutionModel;
+        std::string Name;
+        std::vector<uint32_t> Interface;
+    };
+
+    std::vector<uint32_t> Words;
+    std::vector<EntryPoint> EntryPoints;
+    std::unordered_map<uint32_t, std::span<const uint32_t>> Definitions;
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> Decorations;
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> MemberOffsets;
+
+    std::span<const uint32_t> Definition(uint32_t id) const
+    {
+        const auto definition = Definitions.find(id);
+        if (definition == Definitions.end())
+        {
+            throw std::runtime_error{"SPIR-V refers to an undefined id"};
+        }
+        return definition->second;
+    }
+
+    std::optional<uint32_t> Decoration(uint32_t id, uint32_t decoration) const
+    {
+        const auto decorations = Decorations.find(id);
+        if (decorations == Decorations.end())
+        {
+            return std::nullopt;
+        }
+        const auto value = decorations->second.find(decoration);
+        if (value == decorations->second.end())
+        {
+            return std::nullopt;
+        }
+        return value->second;
+    }
+
+    uint32_t ConstantValue(uint32_t id) const
+    {
+        std::span<const uint32_t> constant = Definition(id);
+        if (Opcode(constant) != OpConstant || constant.size() < 4)
+        {
+            throw std::runtime_error{"SPIR-V array length isn't a constant"};
+        }
+        return constant[3];
+    }
+};
+
+// A literal string, packed into words, null terminated.
+static std::string ReadString(std::span<const uint32_t> words, size_t &wordIndex)
+{
+    std::string string{};
+    for (; wordIndex < words.size(); ++wordIndex)
+    {
+        for (uint32_t byte = 0; byte < 4; ++byte)
+        {
+            const char c = static_cast<char>((words[wordIndex] >> (byte * 8)) & 0xff);
+            if (c == '\0')
+            {
+                ++wordIndex;
+                return string;
+            }
+            string += c;
+        }
+    }
+
+    throw std::runtime_error{"unterminated SPIR-V string"};
+}
+
+static SpirvModule ParseSpirv(std::span<const char> code)
+{
+    SpirvModule module{};
+
+    if (code.size() % sizeof(uint32_t) != 0 || code.size() < SpirvHeaderWords * sizeof(uint32_t))
+    {
+        throw std::runtime_error{"not a SPIR-V module"};
+    }
+    module.Words.resize(code.size() / sizeof(uint32_t));
+    memcpy(module.Words.data(), code.data(), code.size());
+
+    const std::span<const uint32_t> words = module.Words;
+    if (words[0] != SpirvMagic)
+    {
+        throw std::runtime_error{"not a SPIR-V module"};
+    }
+    if (words[1] < SpirvMinVersion)
+    {
+        throw std::runtime_error{"reflection needs SPIR-V 1.4 or newer"};
+    }
+
+    for (size_t i = SpirvHeaderWords; i < words.size();)
+    {
+        const uint32_t wordCount = words[i] >> 16;
+        if (wordCount == 0 || i + wordCount > words.size())
+        {
+            throw std::runtime_error{"truncated SPIR-V instruction"};
+        }
+
+        const std::span<const uint32_t> instruction = words.subspan(i, wordCount);
+        const uint32_t opcode = Opcode(instruction);
+
+        if (opcode == OpEntryPoint && wordCount >= 4)
+        {
+            size_t word = 3;
+            SpirvModule::EntryPoint entryPoint{instruction[1], ReadString(instruction, word)};
+            entryPoint.Interface.assign(instruction.begin() + word, instruction.end());
+            module.EntryPoints.push_back(std::move(entryPoint));
+        }
+        else if (opcode == OpDecorate && wordCount >= 3)
+        {
+            const uint32_t value = wordCount >= 4 ? instruction[3] : 0;
+            module.Decorations[instruction[1]][instruction[2]] = value;
+        }
+        else if (opcode == OpMemberDecorate && wordCount >= 5 &&
+                 instruction[3] == DecorationOffset)
+        {
+            module.MemberOffsets[{instruction[1], instruction[2]}] = instruction[4];
+        }
+        else if (auto resultWord = ResultIdWord(opcode); resultWord && *resultWord < wordCount)
+        {
+            module.Definitions[instruction[*resultWord]] = instruction;
+        }
+
+        i += wordCount;
+    }
+
+    return module;
+}
+
+static std::optional<vk::ShaderStageFlagBits> Stage(uint32_t executionModel)
+{
+    switch (executionModel)
+    {
+    case 0:
+        return vk::ShaderStageFlagBits::eVertex;
+    case 1:
+        return vk::ShaderStageFlagBits::eTessellationControl;
+    case 2:
+        return vk::ShaderStageFlagBits::eTessellationEvaluation;
+    case 3:
+        return vk::ShaderStageFlagBits::eGeometry;
+    case 4:
+        return vk::ShaderStageFlagBits::eFragment;
+    case 5:
+        return vk::ShaderStageFlagBits::eCompute;
+    case 5364:
+        return vk::ShaderStageFlagBits::eTaskEXT;
+    case 5365:
+        return vk::ShaderStageFlagBits::eMeshEXT;
+    default:
+        return std::nullopt;
+    }
+}
+
+static uint32_t TypeSize(const SpirvModule &module, uint32_t type)
+{
+    std::span<const uint32_t> instruction = module.Definition(type);
+    switch (Opcode(instruction))
+    {
+    case OpTypeInt:
+    case OpTypeFloat:
+        return instruction[2] / 8;
+    case OpTypeVector:
+    case OpTypeMatrix:
+        return instruction[3] * TypeSize(module, instruction[2]);
+    case OpTypeArray: {
+        const uint32_t stride = module.Decoration(type, DecorationArrayStride)
+                                    .value_or(TypeSize(module, instruction[2]));
+        return module.ConstantValue(instruction[3]) * stride;
+    }
+    case OpTypeStruct: {
+        uint32_t size = 0;
+        for (uint32_t member = 0; member + 2 < instruction.size(); ++member)
+        {
+            const auto offset = module.MemberOffsets.find({type, member});
+            const uint32_t memberOffset =
+                offset != module.MemberOffsets.end() ? offset->second : size;
+            size = std::max(size, memberOffset + TypeSize(module, instruction[member + 2]));
+        }
+        return size;
+    }
+    default:
+        throw std::runtime_error{"unsupported type in SPIR-V push constants"};
+    }
+}
+
+static vk::DescriptorType DescriptorType(const SpirvModule &module, uint32_t storageClass,
+                                         uint32_t type)
+{
+    std::span<const uint32_t> instruction = module.Definition(type);
+
+    switch (storageClass)
+    {
+    case StorageClassUniform:
+        return module.Decoration(type, DecorationBufferBlock)
+                   ? vk::DescriptorType::eStorageBuffer
+                   : vk::DescriptorType::eUniformBuffer;
+    case StorageClassStorageBuffer:
+        return vk::DescriptorType::eStorageBuffer;
+    case StorageClassUniformConstant:
+        break;
+    default:
+        throw std::runtime_error{"unsupported SPIR-V descriptor storage class"};
+    }
+
+    switch (Opcode(instruction))
+    {
+    case OpTypeSampledImage:
+        return vk::DescriptorType::eCombinedImageSampler;
+    case OpTypeSampler:
+        return vk::DescriptorType::eSampler;
+    case OpTypeAccelerationStructure:
+        return vk::DescriptorType::eAccelerationStructureKHR;
+    case OpTypeImage: {
+        const uint32_t dim = instruction[3];
+        const bool storage = instruction[7] == 2;
+        if (dim == DimBuffer)
+        {
+            return storage ? vk::DescriptorType::eStorageTexelBuffer
+                           : vk::DescriptorType::eUniformTexelBuffer;
+        }
+        if (dim == DimSubpassData)
+        {
+            return vk::DescriptorType::eInputAttachment;
+        }
+        return storage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+    }
+    default:
+        throw std::runtime_error{"unsupported SPIR-V descriptor type"};
+    }
+}
+
+static vk::Format InputFormat(const SpirvModule &module, uint32_t type)
+{
+    std::span<const uint32_t> instruction = module.Definition(type);
+
+    uint32_t components = 1;
+    if (Opcode(instruction) == OpTypeVector)
+    {
+        components = instruction[3];
+        instruction = module.Definition(instruction[2]);
+    }
+
+    const std::array<vk::Format, 4> floats{vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+                                           vk::Format::eR32G32B32Sfloat,
+                                           vk::Format::eR32G32B32A32Sfloat};
+    const std::array<vk::Format, 4> ints{vk::Format::eR32Sint, vk::Format::eR32G32Sint,
+                                         vk::Format::eR32G32B32Sint,
+                                         vk::Format::eR32G32B32A32Sint};
+    const std::array<vk::Format, 4> uints{vk::Format::eR32Uint, vk::Format::eR32G32Uint,
+                                          vk::Format::eR32G32B32Uint,
+                                          vk::Format::eR32G32B32A32Uint};
+
+    if (components < 1 || components > 4 || instruction[2] != 32)
+    {
+        throw std::runtime_error{"unsupported SPIR-V vertex input type"};
+    }
+
+    switch (Opcode(instruction))
+    {
+    case OpTypeFloat:
+        return floats[components - 1];
+    case OpTypeInt:
+        return instruction[3] ? ints[components - 1] : uints[components - 1];
+    default:
+        throw std::runtime_error{"unsupported SPIR-V vertex input type"};
+    }
+}
+
+static EntryPointReflection ReflectEntryPoint(const SpirvModule &module,
+                                              const SpirvModule::EntryPoint &entryPoint,
+                                              vk::ShaderStageFlagBits stage)
+{
+    EntryPointReflection reflection{entryPoint.Name, stage};
+
+    for (uint32_t variable : entryPoint.Interface)
+    {
+        std::span<const uint32_t> instruction = module.Definition(variable);
+        if (Opcode(instruction) != OpVariable)
+        {
+            continue;
+        }
+
+        const uint32_t storageClass = instruction[3];
+        std::span<const uint32_t> pointer = module.Definition(instruction[1]);
+        uint32_t type = pointer[3];
+
+        if (storageClass == StorageClassPushConstant)
+        {
+            reflection.PushConstantSize = TypeSize(module, type);
+        }
+        else if (storageClass == StorageClassInput)
+        {
+            if (stage != vk::ShaderStageFlagBits::eVertex ||
+                module.Decoration(variable, DecorationBuiltIn))
+            {
+                continue;
+            }
+            const auto location = module.Decoration(variable, DecorationLocation);
+            if (!location)
+            {
+                throw std::runtime_error{"SPIR-V vertex input without a location"};
+            }
+            reflection.Inputs.push_back({*location, InputFormat(module, type)});
+        }
+        else if (storageClass == StorageClassUniform ||
+                 storageClass == StorageClassUniformConstant ||
+                 storageClass == StorageClassStorageBuffer)
+        {
+            uint32_t count = 1;
+            std::span<const uint32_t> typeInstruction = module.Definition(type);
+            if (Opcode(typeInstruction) == OpTypeArray)
+            {
+                count = module.ConstantValue(typeInstruction[3]);
+                type = typeInstruction[2];
+            }
+            else if (Opcode(typeInstruction) == OpTypeRuntimeArray)
+            {
+                throw std::runtime_error{"unbounded descriptor arrays aren't supported"};
+            }
+
+            const uint32_t set = module.Decoration(variable, DecorationDescriptorSet).value_or(0);
+            const uint32_t binding = module.Decoration(variable, DecorationBinding).value_or(0);
+            reflection.Bindings.push_back(
+                {set, binding, DescriptorType(module, storageClass, type), count, stage});
+        }
+    }
+
+    std::ranges::sort(reflection.Inputs, {}, &ReflectedInput::Location);
+
+    return reflection;
+}
+
+const EntryPointReflection &ShaderReflection::EntryPoint(const std::string &name) const
+{
+    const auto entryPoint = std::ranges::find(EntryPoints, name, &EntryPointReflection::Name);
+    if (entryPoint == EntryPoints.end())
+    {
+        throw std::runtime_error{"shader has no entry point " + name};
+    }
+
+    return *entryPoint;
+}
+
+ShaderReflection ReflectSpirv(std::span<const char> code)
+{
+    const SpirvModule module = ParseSpirv(code);
+
+    ShaderReflection reflection{};
+    for (const SpirvModule::EntryPoint &entryPoint : module.EntryPoints)
+    {
+        if (auto stage = Stage(entryPoint.ExecutionModel))
+        {
+            reflection.EntryPoints.push_back(ReflectEntryPoint(module, entryPoint, *stage));
+        }
+    }
+
+    return reflection;
+}
+
+std::vector<ReflectedBinding> MergeBindings(
+    std::span<const EntryPointReflection *const> entryPoints, uint32_t set)
+{
+    std::map<uint32_t, ReflectedBinding> merged{};
+    for (const EntryPointReflection *entryPoint : entryPoints)
+    {
+        for (const ReflectedBinding &binding : entryPoint->Bindings)
+        {
+            if (binding.Set != set)
+            {
+                continue;
+            }
+
+            auto [existing, inserted] = merged.try_emplace(binding.Binding, binding);
+            if (inserted)
+            {
+                continue;
+            }
+            if (existing->second.Type != binding.Type || existing->second.Count != binding.Count)
+            {
+                throw std::runtime_error{"shaders disagree on set " + std::to_string(set) +
+                                         " binding " + std::to_string(binding.Binding)};
+            }
+            existing->second.Stages |= binding.Stages;
+        }
+    }
+
+    std::vector<ReflectedBinding> bindings{};
+    for (const auto &[index, binding] : merged)
+    {
+        bindings.push_back(binding);
+    }
+
+    return bindings;
+}
+
+std::optional<vk::PushConstantRange> MergePushConstants(
+    std::span<const EntryPointReflection *const> entryPoints)
+{
+    vk::PushConstantRange range{};
+    for (const EntryPointReflection *entryPoint : entryPoints)
+    {
+        if (entryPoint->PushConstantSize > 0)
+        {
+            range.stageFlags |= entryPoint->Stage;
+            range.size = std::max(range.size, entryPoint->PushConstantSize);
+        }
+    }
+
+    if (range.size == 0)
+    {
+        return std::nullopt;
+    }
+
+    return range;
+}
+
+void CheckVertexInput(const EntryPointReflection &entryPoint,
+                      std::span<const vk::VertexInputAttributeDescription> attributes)
+{
+    bool matches = entryPoint.Inputs.size() == attributes.size();
+    for (const ReflectedInput &input : entryPoint.Inputs)
+    {
+        const auto attribute = std::ranges::find(attributes, input.Location,
+                                                 &vk::VertexInputAttributeDescription::location);
+        matches = matches && attribute != attributes.end() && attribute->format == input.Format;
+    }
+
+    if (!matches)
+    {
+        throw std::runtime_error{"vertex input of " + entryPoint.Name +
+                                 " doesn't match the vertex attributes"};
+    }
+}
+
+static std::vector<uint32_t> BindingsKey(const std::vector<ReflectedBinding> &bindings)
+{
+    std::vector<uint32_t> key{};
+    for (const ReflectedBinding &binding : bindings)
+    {
+        key.insert(key.end(), {binding.Binding, static_cast<uint32_t>(binding.Type), binding.Count,
+                               static_cast<uint32_t>(binding.Stages)});
+    }
+
+    return key;
+}
+
+ShaderLayoutCache::ShaderLayoutCache(const vk::raii::Device &device) : m_device{device}
+{
+}
+
+const ShaderReflection &ShaderLayoutCache::Reflect(std::span<const char> code) const
+{
+    const std::string_view key{code.data(), code.size()};
+
+    std::scoped_lock lock{m_mutex};
+    if (auto reflection = m_reflections.find(key); reflection != m_reflections.end())
+    {
+        return *reflection->second;
+    }
+
+    auto [reflection, inserted] = m_reflections.emplace(
+        std::string{key}, std::make_unique<ShaderReflection>(ReflectSpirv(code)));
+    return *reflection->second;
+}
+
+void ShaderLayoutCache::Evict(std::span<const char> code)
+{
+    std::scoped_lock lock{m_mutex};
+    if (auto reflection = m_reflections.find(std::string_view{code.data(), code.size()});
+        reflection != m_reflections.end())
+    {
+        m_reflections.erase(reflection);
+    }
+}
+
+vk::DescriptorSetLayout ShaderLayoutCache::SetLayout(const std::vector<ReflectedBinding> &bindings)
+{
+    std::vector<uint32_t> key = BindingsKey(bindings);
+    if (auto setLayout = m_setLayouts.find(key); setLayout != m_setLayouts.end())
+    {
+        return setLayout->second;
+    }
+
+    std::vector<vk::DescriptorSetLayoutBinding> layoutBindings{};
+    for (const ReflectedBinding &binding : bindings)
+    {
+        layoutBindings.emplace_back(binding.Binding, binding.Type, binding.Count, binding.Stages);
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutCreateInfo{{}, layoutBindings};
+    auto [setLayout, inserted] = m_setLayouts.emplace(
+        std::move(key), vk::raii::DescriptorSetLayout{m_device, layoutCreateInfo});
+
+    return setLayout->second;
+}
+
+vk::PipelineLayout ShaderLayoutCache::PipelineLayout(
+    std::span<const std::vector<ReflectedBinding>> sets,
+    std::optional<vk::PushConstantRange> pushConstants)
+{
+    std::vector<uint32_t> key{};
+    std::vector<vk::DescriptorSetLayout> setLayouts{};
+    for (const std::vector<ReflectedBinding> &bindings : sets)
+    {
+        const std::vector<uint32_t> setKey = BindingsKey(bindings);
+        key.insert(key.end(), setKey.begin(), setKey.end());
+        // ends the set, binding numbers never get this large
+        key.push_back(UINT32_MAX);
+
+        setLayouts.push_back(SetLayout(bindings));
+    }
+    if (pushConstants)
+    {
+        key.insert(key.end(), {static_cast<uint32_t>(pushConstants->stageFlags),
+                               pushConstants->offset, pushConstants->size});
+    }
+
+    if (auto pipelineLayout = m_pipelineLayouts.find(key);
+        pipelineLayout != m_pipelineLayouts.end())
+    {
+        return pipelineLayout->second;
+    }
+
+    std::vector<vk::PushConstantRange> pushConstantRanges{};
+    if (pushConstants)
+    {
+        pushConstantRanges.push_back(*pushConstants);
+    }
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo{{}, setLayouts, pushConstantRanges};
+    auto [pipelineLayout, inserted] = m_pipelineLayouts.emplace(
+        std::move(key), vk::raii::PipelineLayout{m_device, pipelineLayoutCreateInfo});
+
+    return pipelineLayout->second;
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+struct ReflectedBinding
+{
+    uint32_t Set;
+    uint32_t Binding;
+    vk::DescriptorType Type;
+    uint32_t Count;
+    vk::ShaderStageFlags Stages;
+};
+
+struct ReflectedInput
+{
+    uint32_t Location;
+    vk::Format Format;
+};
+
+// What a single entry point of a SPIR-V module uses. SPIR-V 1.4 lists every global an
+// entry point touches in its interface, so this is exact per stage.
+struct EntryPointReflection
+{
+    std::string Name;
+    vk::ShaderStageFlagBits Stage;
+    std::vector<ReflectedBinding> Bindings;
+    // 0 without push constants
+    uint32_t PushConstantSize = 0;
+    // only for vertex shaders, sorted by location
+    std::vector<ReflectedInput> Inputs;
+};
+
+struct ShaderReflection
+{
+    std::vector<EntryPointReflection> EntryPoints;
+
+    const EntryPointReflection &EntryPoint(const std::string &name) const;
+};
+
+// Throws if `code` isn't SPIR-V 1.4 or newer, or uses descriptors this can't describe.
+ShaderReflection ReflectSpirv(std::span<const char> code);
+
+// The bindings of `set`, merged over `entryPoints`, sorted by binding.
+// Throws if two entry points disagree on what a binding is.
+std::vector<ReflectedBinding> MergeBindings(
+    std::span<const EntryPointReflection *const> entryPoints, uint32_t set);
+
+// A single range covering all the push constants of `entryPoints`, if any of them has some.
+std::optional<vk::PushConstantRange> MergePushConstants(
+    std::span<const EntryPointReflection *const> entryPoints);
+
+// Throws unless `entryPoint` reads exactly the locations and formats of `attributes`.
+void CheckVertexInput(const EntryPointReflection &entryPoint,
+                      std::span<const vk::VertexInputAttributeDescription> attributes);
+
+// Reflects each SPIR-V module once, and creates each distinct descriptor set layout and
+// pipeline layout once, so that pipelines with the same interface share their layouts.
+struct ShaderLayoutCache
+{
+    explicit ShaderLayoutCache(const vk::raii::Device &device);
+
+    // Cached by `code`; safe to call from any thread. The reflection stays valid until
+    // `Evict` is called with the same code.
+    const ShaderReflection &Reflect(std::span<const char> code) const;
+
+    // Drops the reflection of `code`, for a shader that got replaced.
+    void Evict(std::span<const char> code);
+
+    vk::DescriptorSetLayout SetLayout(const std::vector<ReflectedBinding> &bindings);
+
+    // `sets` are the bindings of set 0, 1, ...
+    vk::PipelineLayout PipelineLayout(std::span<const std::vector<ReflectedBinding>> sets,
+                                      std::optional<vk::PushConstantRange> pushConstants);
+
+  private:
+    const vk::raii::Device &m_device;
+
+    mutable std::mutex m_mutex;
+    mutable std::map<std::string, std::unique_ptr<ShaderReflection>, std::less<>> m_reflections;
+
+    std::map<std::vector<uint32_t>, vk::raii::DescriptorSetLayout> m_setLayouts;
+    std::map<std::vector<uint32_t>, vk::raii::PipelineLayout> m_pipelineLayouts;
+};
+
+} // namespace vkstart
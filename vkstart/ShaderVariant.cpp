@@ -0,0 +1,58 @@
+#include "ShaderVariant.h"
+
+namespace vkstart
+{
+
+std::string ShaderVariantName(const std::string &source, const MaterialFeatures &features)
+{
+    std::string name = "shaders/" + source;
+    if (features.Texture)
+    {
+        name += ".texture";
+    }
+    if (features.VertexColor)
+    {
+        name += ".vertex_color";
+    }
+
+    return name + ".spv";
+}
+
+void SpecializationConstants::Set(uint32_t id, uint32_t value)
+{
+    const auto entry = std::ranges::find(m_entries, id, &vk::SpecializationMapEntry::constantID);
+    if (entry != m_entries.end())
+    {
+        m_data[entry - m_entries.begin()] = value;
+        return;
+    }
+
+    const auto offset = static_cast<uint32_t>(m_data.size() * sizeof(uint32_t));
+    m_entries.emplace_back(id, offset, sizeof(uint32_t));
+    m_data.push_back(value);
+}
+
+void SpecializationConstants::Set(uint32_t id, float value)
+{
+    Set(id, std::bit_cast<uint32_t>(value));
+}
+
+void SpecializationConstants::Set(uint32_t id, bool value)
+{
+    // SPIR-V booleans are specialized as 32-bit VkBool32
+    Set(id, static_cast<uint32_t>(value ? vk::True : vk::False));
+}
+
+const vk::SpecializationInfo *SpecializationConstants::Info()
+{
+    if (m_entries.empty())
+    {
+        return nullptr;
+    }
+
+    m_info = vk::SpecializationInfo{static_cast<uint32_t>(m_entries.size()), m_entries.data(),
+                                    m_data.size() * sizeof(uint32_t), m_data.data()};
+    return &m_info;
+}
+
+} // namespace vkstart
\ No newline at end of file
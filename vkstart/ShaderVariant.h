@@ -0,0 +1,36 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// The compile-time switches of shader.slang, see `MATERIAL_FEATURES` in shaders/CMakeLists.txt.
+struct MaterialFeatures
+{
+    bool Texture = false;
+    bool VertexColor = false;
+};
+
+// The asset name of the variant of `source` compiled with `features`,
+// e.g. "shaders/shader.slang.texture.spv".
+std::string ShaderVariantName(const std::string &source, const MaterialFeatures &features);
+
+// The specialization constants of a shader stage, by constant id.
+// `Info()` points into this, so it has to outlive the pipeline creation.
+struct SpecializationConstants
+{
+    void Set(uint32_t id, uint32_t value);
+    void Set(uint32_t id, float value);
+    void Set(uint32_t id, bool value);
+
+    // nullptr without constants, so that the shader's defaults apply
+    const vk::SpecializationInfo *Info();
+
+  private:
+    std::vector<vk::SpecializationMapEntry> m_entries;
+    std::vector<uint32_t> m_data;
+    vk::SpecializationInfo m_info;
+};
+
+} // namespace vkstart
@@ -0,0 +1,182 @@
+#include "ShaderWatcher.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace vkstart
+{
+
+// How often the watcher thread checks whether it should stop, in milliseconds.
+constexpr int PollInterval = 100;
+
+// Editors tend to save in several steps, so nothing gets compiled until the
+// sources have been left alone for this long, in milliseconds.
+constexpr int SettleTime = 50;
+
+static std::string Quoted(const std::filesystem::path &path)
+{
+    return "\"" + path.string() + "\"";
+}
+
+ShaderWatcher::ShaderWatcher(const std::filesystem::path &sourceDirectory,
+                             const std::filesystem::path &compiler,
+                             std::vector<WatchedShader> shaders)
+    : m_sourceDirectory{sourceDirectory}, m_compiler{compiler}, m_shaders{std::move(shaders)}
+{
+#ifdef __linux__
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0)
+    {
+        throw std::runtime_error{"failed to initialize inotify"};
+    }
+
+    // also catches editors that write a temporary file and rename it
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO;
+    if (inotify_add_watch(m_inotify, m_sourceDirectory.c_str(), mask) < 0)
+    {
+        close(m_inotify);
+        throw std::runtime_error{"failed to watch " + m_sourceDirectory.string()};
+    }
+
+    m_thread = std::thread{[this]() { Run(); }};
+#else
+    SDL_Log("shader hot-reload needs inotify, which this platform doesn't have");
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    m_stop = true;
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+#ifdef __linux__
+    if (m_inotify >= 0)
+    {
+        close(m_inotify);
+    }
+#endif
+}
+
+std::vector<CompiledShader> ShaderWatcher::TakeCompiled()
+{
+    std::scoped_lock lock{m_mutex};
+    return std::exchange(m_compiled, {});
+}
+
+void ShaderWatcher::Run()
+{
+#ifdef __linux__
+    pollfd watch{m_inotify, POLLIN, 0};
+    while (!m_stop)
+    {
+        if (poll(&watch, 1, PollInterval) <= 0)
+        {
+            continue;
+        }
+
+        bool changed = ReadEvents();
+        while (!m_stop && poll(&watch, 1, SettleTime) > 0)
+        {
+            changed = ReadEvents() || changed;
+        }
+
+        if (changed && !m_stop)
+        {
+            CompileAll();
+        }
+    }
+#endif
+}
+
+bool ShaderWatcher::ReadEvents()
+{
+    bool changed = false;
+
+#ifdef __linux__
+    alignas(inotify_event) std::array<char, 4096> buffer;
+    ssize_t length;
+    while ((length = read(m_inotify, buffer.data(), buffer.size())) > 0)
+    {
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto *event = reinterpret_cast<const inotify_event *>(buffer.data() + offset);
+            if (event->len > 0 &&
+                std::filesystem::path{event->name}.extension() == std::string_view{".slang"})
+            {
+                changed = true;
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+#endif
+
+    return changed;
+}
+
+void ShaderWatcher::CompileAll()
+{
+    // shaders include each other, and there are only a few of them,
+    // so any change recompiles all of them
+    std::vector<CompiledShader> compiled{};
+    for (const WatchedShader &shader : m_shaders)
+    {
+        if (auto code = Compile(shader))
+        {
+            compiled.push_back({shader.Name, std::move(*code)});
+        }
+    }
+
+    std::scoped_lock lock{m_mutex};
+    for (CompiledShader &shader : compiled)
+    {
+        // a newer version replaces one that hasn't been taken yet
+        std::erase_if(m_compiled, [&](const CompiledShader &c) { return c.Name == shader.Name; });
+        m_compiled.push_back(std::move(shader));
+    }
+}
+
+std::optional<std::vector<char>> ShaderWatcher::Compile(const WatchedShader &shader) const
+{
+    const std::filesystem::path output =
+        std::filesystem::temp_directory_path() /
+        ("vkstart-" + std::filesystem::path{shader.Name}.filename().string());
+
+    std::string command = Quoted(m_compiler) + " " + Quoted(m_sourceDirectory / shader.Source);
+    for (const std::string &argument : shader.Arguments)
+    {
+        command += " " + argument;
+    }
+    for (const std::string &entry : shader.Entries)
+    {
+        command += " -entry " + entry;
+    }
+    command += " -o " + Quoted(output);
+
+    if (std::system(command.c_str()) != 0)
+    {
+        SDL_Log("failed to compile %s", shader.Source.c_str());
+        return std::nullopt;
+    }
+
+    std::ifstream file(output, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        return std::nullopt;
+    }
+
+    std::vector<char> code(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(code.data(), static_cast<std::streamsize>(code.size()));
+
+    SDL_Log("recompiled %s", shader.Source.c_str());
+
+    return code;
+}
+
+} // namespace vkstart
\ No newline at end of file
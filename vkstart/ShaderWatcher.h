@@ -0,0 +1,59 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// A shader the watcher can recompile: the asset it replaces, its source file relative to
+// the source directory, and what to compile it with, as generated by shaders/CMakeLists.txt.
+struct WatchedShader
+{
+    std::string Name;
+    std::string Source;
+    std::vector<std::string> Entries;
+    // the slangc options and defines
+    std::vector<std::string> Arguments;
+};
+
+// SPIR-V, named like the asset it replaces, e.g. "shaders/shader.slang.spv".
+struct CompiledShader
+{
+    std::string Name;
+    std::vector<char> Code;
+};
+
+// Watches a directory of Slang sources, and recompiles the shaders with slangc on its own
+// thread whenever one of the sources changes. Only does anything on Linux, using inotify.
+struct ShaderWatcher
+{
+    ShaderWatcher(const std::filesystem::path &sourceDirectory,
+                  const std::filesystem::path &compiler, std::vector<WatchedShader> shaders);
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+    // What compiled since the last call. Shaders that failed to compile are left out,
+    // slangc has already reported why.
+    std::vector<CompiledShader> TakeCompiled();
+
+  private:
+    void Run();
+    bool ReadEvents();
+    void CompileAll();
+    std::optional<std::vector<char>> Compile(const WatchedShader &shader) const;
+
+    std::filesystem::path m_sourceDirectory;
+    std::filesystem::path m_compiler;
+    std::vector<WatchedShader> m_shaders;
+
+    int m_inotify = -1;
+    std::atomic<bool> m_stop = false;
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::vector<CompiledShader> m_compiled;
+};
+
+} // namespace vkstart
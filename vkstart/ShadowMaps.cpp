@@ -0,0 +1,446 @@
+#include "ShadowMaps.h"
+
+namespace vkstart
+{
+
+// Blends logarithmic splits, which match how perspective shrinks the texels with distance,
+// with uniform ones, which keep the first cascade from getting tiny.
+constexpr float SplitLambda = 0.75f;
+
+// The side of each cache, in sides of its cascade: room for the cascade to move around in
+// before the cache has to be redrawn, or for all of the static casters.
+constexpr uint32_t CacheScale = 2;
+
+// Steps the cascades' radii get rounded up to, so that they don't change with the view
+// direction, and the texel size stays put.
+constexpr float RadiusStep = 1.0f / 16.0f;
+
+constexpr vk::ImageSubresourceRange DepthRange{vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1};
+
+static void TransitionAtlas(const vk::raii::CommandBuffer &commandBuffer, vk::Image image,
+                            vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+                            vk::PipelineStageFlags2 srcStageMask, vk::AccessFlags2 srcAccessMask,
+                            vk::PipelineStageFlags2 dstStageMask, vk::AccessFlags2 dstAccessMask)
+{
+    const vk::ImageMemoryBarrier2 barrier{srcStageMask,
+                                          srcAccessMask,
+                                          dstStageMask,
+                                          dstAccessMask,
+                                          oldLayout,
+                                          newLayout,
+                                          VK_QUEUE_FAMILY_IGNORED,
+                                          VK_QUEUE_FAMILY_IGNORED,
+                                          image,
+                                          DepthRange};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, barrier});
+}
+
+// Orthographic projection of a square of `size` texels of light space, from texel `origin`
+// on, with the depth range all cascades share.
+static glm::mat4 SquareProjection(const glm::ivec2 &origin, uint32_t size, float texelSize,
+                                  float depthReach)
+{
+    const glm::vec2 lower = glm::vec2{origin} * texelSize;
+    const glm::vec2 upper = glm::vec2{origin + static_cast<int32_t>(size)} * texelSize;
+    return glm::ortho(lower.x, upper.x, lower.y, upper.y, -depthReach, depthReach);
+}
+
+ShadowCascades FitShadowCascades(const glm::mat4 &view, const glm::mat4 &proj, float nearPlane,
+                                 float farPlane, float shadowDistance,
+                                 const glm::vec3 &lightDirection, float depthReach,
+                                 uint32_t resolution)
+{
+    // the corners of the view frustum in world space, the near ones first
+    const glm::mat4 inverseViewProj = glm::inverse(proj * view);
+    std::array<glm::vec3, 8> corners{};
+    for (uint32_t i = 0; i < corners.size(); ++i)
+    {
+        const glm::vec4 ndc{(i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : 0.0f,
+                            1.0f};
+        const glm::vec4 world = inverseViewProj * ndc;
+        corners[i] = glm::vec3{world} / world.w;
+    }
+
+    // z is up, unless the light comes from straight above or below
+    const glm::vec3 up = std::abs(lightDirection.z) > 0.99f ? glm::vec3{0.0f, 1.0f, 0.0f}
+                                                             : glm::vec3{0.0f, 0.0f, 1.0f};
+
+    ShadowCascades cascades{};
+    cascades.LightView = glm::lookAt(glm::vec3{0.0f}, lightDirection, up);
+    cascades.DepthReach = depthReach;
+
+    float sliceBegin = nearPlane;
+    for (uint32_t cascade = 0; cascade < ShadowCascadeCount; ++cascade)
+    {
+        const float fraction = static_cast<float>(cascade + 1) / ShadowCascadeCount;
+        const float logarithmic = nearPlane * std::pow(shadowDistance / nearPlane, fraction);
+        const float uniform = nearPlane + (shadowDistance - nearPlane) * fraction;
+        const float sliceEnd = SplitLambda * logarithmic + (1.0f - SplitLambda) * uniform;
+
+        // the view depth changes linearly along the edges from the near to the far corners
+        std::array<glm::vec3, 8> slice{};
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const glm::vec3 edge = corners[i + 4] - corners[i];
+            slice[i] = corners[i] + edge * ((sliceBegin - nearPlane) / (farPlane - nearPlane));
+            slice[i + 4] = corners[i] + edge * ((sliceEnd - nearPlane) / (farPlane - nearPlane));
+        }
+
+        glm::vec3 center{0.0f};
+        for (const glm::vec3 &corner : slice)
+        {
+            center += corner / static_cast<float>(slice.size());
+        }
+        float radius = 0.0f;
+        for (const glm::vec3 &corner : slice)
+        {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius / RadiusStep) * RadiusStep;
+
+        // centered on the slice, in whole texels
+        const float texelSize = 2.0f * radius / static_cast<float>(resolution);
+        const glm::vec2 lightCenter{cascades.LightView * glm::vec4{center, 1.0f}};
+        const glm::ivec2 origin = glm::ivec2{glm::round(lightCenter / texelSize)} -
+                                  static_cast<int32_t>(resolution / 2);
+
+        cascades.TexelSizes[cascade] = texelSize;
+        cascades.Origins[cascade] = origin;
+        cascades.ViewProj[cascade] =
+            SquareProjection(origin, resolution, texelSize, depthReach) * cascades.LightView;
+
+        // clip space to the cascade's square of the atlas
+        glm::mat4 toAtlas{1.0f};
+        toAtlas[0][0] = 0.5f / ShadowCascadeCount;
+        toAtlas[1][1] = 0.5f;
+        toAtlas[3][0] = (static_cast<float>(cascade) + 0.5f) / ShadowCascadeCount;
+        toAtlas[3][1] = 0.5f;
+        cascades.AtlasTransforms[cascade] = toAtlas * cascades.ViewProj[cascade];
+
+        cascades.Splits[cascade] = sliceEnd;
+        sliceBegin = sliceEnd;
+    }
+
+    return cascades;
+}
+
+ShadowMaps::ShadowMaps(const vk::raii::PhysicalDevice &physicalDevice,
+                       const vk::raii::Device &device, uint32_t resolution)
+    : m_physicalDevice{physicalDevice}, m_device{device}, m_resolution{resolution},
+      m_cacheResolution{std::min(CacheScale * resolution,
+                                 physicalDevice.getProperties().limits.maxImageDimension2D)}
+{
+    for (Cache &cache : m_caches)
+    {
+        cache.Image = CreateImage(vk::Extent2D{m_cacheResolution, m_cacheResolution},
+                                  vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                                      vk::ImageUsageFlagBits::eTransferSrc);
+    }
+    m_atlas = CreateImage(vk::Extent2D{m_resolution * ShadowCascadeCount, m_resolution},
+                          vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                              vk::ImageUsageFlagBits::eTransferDst |
+                              vk::ImageUsageFlagBits::eSampled);
+
+    // filtered comparisons give 2x2 percentage-closer filtering for free, where supported
+    const bool linear = static_cast<bool>(
+        m_physicalDevice.getFormatProperties(Format).optimalTilingFeatures &
+        vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+    const vk::Filter filter = linear ? vk::Filter::eLinear : vk::Filter::eNearest;
+
+    vk::SamplerCreateInfo samplerCreateInfo{};
+    samplerCreateInfo.magFilter = filter;
+    samplerCreateInfo.minFilter = filter;
+    samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    samplerCreateInfo.addressModeU = vk::SamplerAddressMode::eClampToBorder;
+    samplerCreateInfo.addressModeV = vk::SamplerAddressMode::eClampToBorder;
+    samplerCreateInfo.addressModeW = vk::SamplerAddressMode::eClampToBorder;
+    samplerCreateInfo.compareEnable = vk::True;
+    samplerCreateInfo.compareOp = vk::CompareOp::eLessOrEqual;
+    // the far plane, where nothing is in front
+    samplerCreateInfo.borderColor = vk::BorderColor::eFloatOpaqueWhite;
+    m_sampler = vk::raii::Sampler{m_device, samplerCreateInfo};
+}
+
+void ShadowMaps::Record(const vk::raii::CommandBuffer &commandBuffer,
+                        const ShadowCascades &cascades, uint64_t staticVersion,
+                        const glm::vec4 &staticBounds, const ShadowCasterRecorder &staticCasters,
+                        const ShadowCasterRecorder &dynamicCasters)
+{
+    // never fitted, as with shadows off: nothing to place the caches on, and nothing in front
+    if (std::ranges::any_of(cascades.TexelSizes, [](float size) { return size <= 0.0f; }))
+    {
+        TransitionAtlas(commandBuffer, m_atlas.Image, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eTransferDstOptimal,
+                        vk::PipelineStageFlagBits2::eFragmentShader, {},
+                        vk::PipelineStageFlagBits2::eClear, vk::AccessFlagBits2::eTransferWrite);
+        commandBuffer.clearDepthStencilImage(m_atlas.Image, vk::ImageLayout::eTransferDstOptimal,
+                                             vk::ClearDepthStencilValue{1.0f, 0}, DepthRange);
+        TransitionAtlas(commandBuffer, m_atlas.Image, vk::ImageLayout::eTransferDstOptimal,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits2::eClear, vk::AccessFlagBits2::eTransferWrite,
+                        vk::PipelineStageFlagBits2::eFragmentShader,
+                        vk::AccessFlagBits2::eShaderSampledRead);
+        return;
+    }
+
+    const glm::ivec2 cascadeSize{static_cast<int32_t>(m_resolution)};
+    const glm::ivec2 cacheSize{static_cast<int32_t>(m_cacheResolution)};
+
+    bool cacheChanged = false;
+    // whether any of the cascades reaches beyond its cache
+    bool uncovered = false;
+    for (uint32_t cascade = 0; cascade < ShadowCascadeCount; ++cascade)
+    {
+        const Cache &cache = m_caches[cascade];
+        const glm::ivec2 &origin = cascades.Origins[cascade];
+        const auto inside = [&] {
+            return glm::all(glm::greaterThanEqual(origin, cache.Origin)) &&
+                   glm::all(glm::lessThanEqual(origin + cascadeSize, cache.Origin + cacheSize));
+        };
+        const bool stale = cache.Version != staticVersion ||
+                           cache.LightView != cascades.LightView ||
+                           cache.DepthReach != cascades.DepthReach ||
+                           cache.TexelSize != cascades.TexelSizes[cascade] ||
+                           (!cache.CoversAll && !inside());
+        if (stale)
+        {
+            RecordCache(commandBuffer, cascade, cascades, staticVersion, staticBounds,
+                        staticCasters);
+            cacheChanged = true;
+        }
+        uncovered = uncovered || !inside();
+    }
+
+    if (!cacheChanged && !dynamicCasters && !m_atlasHasDynamic &&
+        m_atlasOrigins == cascades.Origins)
+    {
+        // still the copy of the caches an earlier frame made
+        return;
+    }
+
+    // the earlier frames that sampled it ran before, on this queue
+    TransitionAtlas(commandBuffer, m_atlas.Image, vk::ImageLayout::eUndefined,
+                    vk::ImageLayout::eTransferDstOptimal,
+                    vk::PipelineStageFlagBits2::eFragmentShader, {},
+                    vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite);
+
+    // what the caches don't cover has no static casters
+    if (uncovered)
+    {
+        commandBuffer.clearDepthStencilImage(m_atlas.Image, vk::ImageLayout::eTransferDstOptimal,
+                                             vk::ClearDepthStencilValue{1.0f, 0}, DepthRange);
+        TransitionAtlas(commandBuffer, m_atlas.Image, vk::ImageLayout::eTransferDstOptimal,
+                        vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits2::eClear,
+                        vk::AccessFlagBits2::eTransferWrite, vk::PipelineStageFlagBits2::eCopy,
+                        vk::AccessFlagBits2::eTransferWrite);
+    }
+
+    const uint32_t mipLevel = 0;
+    const uint32_t baseArrayLayer = 0;
+    const uint32_t layerCount = 1;
+    const vk::ImageSubresourceLayers subresourceLayers{vk::ImageAspectFlagBits::eDepth, mipLevel,
+                                                       baseArrayLayer, layerCount};
+    for (uint32_t cascade = 0; cascade < ShadowCascadeCount; ++cascade)
+    {
+        // where the cascade and its cache overlap, on the grid of the cascade's texels
+        const Cache &cache = m_caches[cascade];
+        const glm::ivec2 &origin = cascades.Origins[cascade];
+        const glm::ivec2 begin = glm::max(origin, cache.Origin);
+        const glm::ivec2 end = glm::min(origin + cascadeSize, cache.Origin + cacheSize);
+        if (glm::any(glm::lessThanEqual(end, begin)))
+        {
+            continue;
+        }
+
+        const glm::ivec2 source = begin - cache.Origin;
+        const glm::ivec2 destination = begin - origin;
+        const vk::ImageCopy region{
+            subresourceLayers, vk::Offset3D{source.x, source.y, 0}, subresourceLayers,
+            vk::Offset3D{destination.x + static_cast<int32_t>(cascade * m_resolution),
+                         destination.y, 0},
+            vk::Extent3D{static_cast<uint32_t>(end.x - begin.x),
+                         static_cast<uint32_t>(end.y - begin.y), 1}};
+        commandBuffer.copyImage(cache.Image.Image, vk::ImageLayout::eTransferSrcOptimal,
+                                m_atlas.Image, vk::ImageLayout::eTransferDstOptimal, region);
+    }
+
+    if (dynamicCasters)
+    {
+        TransitionAtlas(commandBuffer, m_atlas.Image, vk::ImageLayout::eTransferDstOptimal,
+                        vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                        vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+                        vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                            vk::PipelineStageFlagBits2::eLateFragmentTests,
+                        vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+                            vk::AccessFlagBits2::eDepthStencilAttachmentWrite);
+        RecordCasters(commandBuffer, m_atlas.View, vk::AttachmentLoadOp::eLoad, m_resolution,
+                      cascades.ViewProj, dynamicCasters);
+        TransitionAtlas(commandBuffer, m_atlas.Image,
+                        vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits2::eLateFragmentTests,
+                        vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+                        vk::PipelineStageFlagBits2::eFragmentShader,
+                        vk::AccessFlagBits2::eShaderSampledRead);
+    }
+    else
+    {
+        TransitionAtlas(commandBuffer, m_atlas.Image, vk::ImageLayout::eTransferDstOptimal,
+                        vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits2::eCopy,
+                        vk::AccessFlagBits2::eTransferWrite,
+                        vk::PipelineStageFlagBits2::eFragmentShader,
+                        vk::AccessFlagBits2::eShaderSampledRead);
+    }
+
+    m_atlasOrigins = cascades.Origins;
+    m_atlasHasDynamic = static_cast<bool>(dynamicCasters);
+}
+
+void ShadowMaps::RecordCache(const vk::raii::CommandBuffer &commandBuffer, uint32_t cascade,
+                             const ShadowCascades &cascades, uint64_t staticVersion,
+                             const glm::vec4 &staticBounds,
+                             const ShadowCasterRecorder &staticCasters)
+{
+    Cache &cache = m_caches[cascade];
+    const float texelSize = cascades.TexelSizes[cascade];
+
+    // all of the static casters if they fit, with a texel to spare for filtering, or else
+    // the cascade, with as much room around it as there is
+    const float boundsTexels = 2.0f * staticBounds.w / texelSize + 2.0f;
+    cache.CoversAll =
+        staticBounds.w < 0.0f || boundsTexels <= static_cast<float>(m_cacheResolution);
+    const glm::vec2 center =
+        cache.CoversAll
+            ? glm::vec2{cascades.LightView * glm::vec4{glm::vec3{staticBounds}, 1.0f}} /
+                  texelSize
+            : glm::vec2{cascades.Origins[cascade]} + 0.5f * static_cast<float>(m_resolution);
+    cache.Origin =
+        glm::ivec2{glm::round(center)} - static_cast<int32_t>(m_cacheResolution / 2);
+
+    const glm::mat4 viewProj =
+        SquareProjection(cache.Origin, m_cacheResolution, texelSize, cascades.DepthReach) *
+        cascades.LightView;
+
+    // only ever read by the copies of earlier frames, on this queue
+    TransitionAtlas(commandBuffer, cache.Image.Image, vk::ImageLayout::eUndefined,
+                    vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                    vk::PipelineStageFlagBits2::eCopy, {},
+                    vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                        vk::PipelineStageFlagBits2::eLateFragmentTests,
+                    vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+                        vk::AccessFlagBits2::eDepthStencilAttachmentWrite);
+    RecordCasters(commandBuffer, cache.Image.View, vk::AttachmentLoadOp::eClear,
+                  m_cacheResolution, std::span{&viewProj, 1}, staticCasters);
+    TransitionAtlas(commandBuffer, cache.Image.Image,
+                    vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                    vk::ImageLayout::eTransferSrcOptimal,
+                    vk::PipelineStageFlagBits2::eLateFragmentTests,
+                    vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+                    vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferRead);
+
+    cache.Version = staticVersion;
+    cache.LightView = cascades.LightView;
+    cache.DepthReach = cascades.DepthReach;
+    cache.TexelSize = texelSize;
+}
+
+vk::ImageView ShadowMaps::AtlasView() const
+{
+    return m_atlas.View;
+}
+
+vk::Sampler ShadowMaps::Sampler() const
+{
+    return m_sampler;
+}
+
+ShadowMaps::OwnedImage ShadowMaps::CreateImage(vk::Extent2D extent2D,
+                                               vk::ImageUsageFlags usage) const
+{
+    const vk::Extent3D extent{extent2D, 1};
+    const uint32_t mipLevels = 1;
+    const uint32_t arrayLayers = 1;
+    vk::ImageCreateInfo imageCreateInfo{{},
+                                        vk::ImageType::e2D,
+                                        Format,
+                                        extent,
+                                        mipLevels,
+                                        arrayLayers,
+                                        vk::SampleCountFlagBits::e1,
+                                        vk::ImageTiling::eOptimal,
+                                        usage,
+                                        vk::SharingMode::eExclusive,
+                                        {},
+                                        vk::ImageLayout::eUndefined};
+
+    OwnedImage image{};
+    image.Image = vk::raii::Image{m_device, imageCreateInfo};
+
+    vk::MemoryRequirements memRequirements = image.Image.getMemoryRequirements();
+    vk::MemoryAllocateInfo allocInfo{
+        memRequirements.size,
+        FindMemoryType(memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)};
+    image.Memory = vk::raii::DeviceMemory{m_device, allocInfo};
+    image.Image.bindMemory(image.Memory, 0);
+
+    vk::ImageViewCreateInfo viewCreateInfo{
+        {}, image.Image, vk::ImageViewType::e2D, Format, {}, DepthRange};
+    image.View = vk::raii::ImageView{m_device, viewCreateInfo};
+
+    return image;
+}
+
+uint32_t ShadowMaps::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const
+{
+    vk::PhysicalDeviceMemoryProperties memProperties = m_physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) &&
+            (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("no suitable memory type found");
+}
+
+void ShadowMaps::RecordCasters(const vk::raii::CommandBuffer &commandBuffer, vk::ImageView view,
+                               vk::AttachmentLoadOp loadOp, uint32_t squareSize,
+                               std::span<const glm::mat4> viewProj,
+                               const ShadowCasterRecorder &casters) const
+{
+    const vk::ClearValue clearDepth = vk::ClearDepthStencilValue{1.0f, 0};
+    vk::RenderingAttachmentInfo depthAttachmentInfo{view,
+                                                    vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                                                    vk::ResolveModeFlagBits::eNone,
+                                                    {},
+                                                    vk::ImageLayout::eUndefined,
+                                                    loadOp,
+                                                    vk::AttachmentStoreOp::eStore,
+                                                    clearDepth};
+
+    const auto squareCount = static_cast<uint32_t>(viewProj.size());
+    const vk::Rect2D renderArea{{0, 0}, {squareSize * squareCount, squareSize}};
+    const uint32_t layerCount = 1;
+    const uint32_t viewMask = 0;
+    vk::RenderingInfo renderingInfo = {{}, renderArea, layerCount, viewMask, {},
+                                       &depthAttachmentInfo};
+
+    commandBuffer.beginRendering(renderingInfo);
+
+    for (uint32_t square = 0; casters && square < squareCount; ++square)
+    {
+        const auto x = static_cast<int32_t>(square * squareSize);
+        const auto size = static_cast<float>(squareSize);
+        commandBuffer.setViewport(
+            0, vk::Viewport{static_cast<float>(x), 0.0f, size, size, 0.0f, 1.0f});
+        commandBuffer.setScissor(0, vk::Rect2D{{x, 0}, {squareSize, squareSize}});
+
+        casters(commandBuffer, viewProj[square]);
+    }
+
+    commandBuffer.endRendering();
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// See shader.slang.
+constexpr uint32_t ShadowCascadeCount = 4;
+
+// Where the shadows of a directional light get looked up, per cascade. Each cascade covers
+// a slice of the view frustum, the first ones the closest and smallest, and gets a square
+// of its own in the shadow atlas, side by side.
+// All cascades share one light space, which doesn't depend on the view, and each lies on a
+// grid of texels there, so that what got drawn for one position of a cascade can be copied
+// to another by whole texels.
+struct ShadowCascades
+{
+    // world space to clip space of the cascade, what the casters get drawn with
+    std::array<glm::mat4, ShadowCascadeCount> ViewProj{};
+    // world space to texture coordinates in the atlas, and depth
+    std::array<glm::mat4, ShadowCascadeCount> AtlasTransforms{};
+    // view space depth each cascade reaches to; nothing is shadowed beyond the last one
+    glm::vec4 Splits{0.0f};
+
+    // world space rotated so that the light travels along -z
+    glm::mat4 LightView{1.0f};
+    // the depth range along the light, centered on the world origin
+    float DepthReach = 0.0f;
+    // size of the cascades' texels in light space
+    std::array<float, ShadowCascadeCount> TexelSizes{};
+    // the first texel of each cascade's square, on the grid of its texels
+    std::array<glm::ivec2, ShadowCascadeCount> Origins{};
+};
+
+// Fits the cascades to the slices of the view frustum between `nearPlane` and
+// `shadowDistance`, which must be within the near and far plane of `proj`. The cascades
+// move in whole texels of `resolution`, so that their shadows don't shimmer, and only
+// what is within `depthReach` of the world origin along the light casts shadows.
+ShadowCascades FitShadowCascades(const glm::mat4 &view, const glm::mat4 &proj, float nearPlane,
+                                 float farPlane, float shadowDistance,
+                                 const glm::vec3 &lightDirection, float depthReach,
+                                 uint32_t resolution);
+
+// Draws the casters with the matrix of one of the cascades; the viewport is already set.
+using ShadowCasterRecorder =
+    std::function<void(const vk::raii::CommandBuffer &commandBuffer, const glm::mat4 &viewProj)>;
+
+// The shadow atlas the frame samples, and a cache of each cascade with just the static
+// casters. A cache covers a larger square than its cascade, on the same grid of texels:
+// all of the static casters when they fit, or else the cascade with a margin around it.
+// It only gets redrawn when the static casters or the light change, when the cascade's
+// texels change size, or when the cascade moves out of it. Every frame that needs it
+// copies the caches into the atlas and draws the dynamic casters on top, or, without
+// any, keeps sampling what got copied before while the cascades stay put.
+struct ShadowMaps
+{
+    static constexpr vk::Format Format = vk::Format::eD16Unorm;
+
+    // `resolution` is the size of each cascade's square.
+    ShadowMaps(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device,
+               uint32_t resolution);
+
+    // Records the frame's shadow atlas, on the queue that samples it, outside of rendering.
+    // `staticVersion` changes whenever the static casters do, see `Scene::StaticVersion`,
+    // and `staticBounds` is a world space sphere around all of them, as center and radius.
+    // Either recorder may be empty, for no casters of its kind, and cascades that were never
+    // fitted, as with shadows off, get a cleared atlas. Leaves the atlas in the
+    // ShaderReadOnlyOptimal layout, visible to fragment shaders.
+    void Record(const vk::raii::CommandBuffer &commandBuffer, const ShadowCascades &cascades,
+                uint64_t staticVersion, const glm::vec4 &staticBounds,
+                const ShadowCasterRecorder &staticCasters,
+                const ShadowCasterRecorder &dynamicCasters);
+
+    // the frame's atlas, for sampling with `Sampler`
+    vk::ImageView AtlasView() const;
+    // compares with the depth in the atlas, and is lit outside of it
+    vk::Sampler Sampler() const;
+
+  private:
+    struct OwnedImage
+    {
+        vk::raii::DeviceMemory Memory = nullptr;
+        vk::raii::Image Image = nullptr;
+        vk::raii::ImageView View = nullptr;
+    };
+
+    // one cascade's static casters
+    struct Cache
+    {
+        OwnedImage Image;
+        std::optional<uint64_t> Version;
+        glm::mat4 LightView{1.0f};
+        float DepthReach = 0.0f;
+        float TexelSize = 0.0f;
+        // the first texel of the cache, on the grid of the cascade's texels
+        glm::ivec2 Origin{0};
+        // whether it has all of the static casters, wherever the cascade goes
+        bool CoversAll = false;
+    };
+
+    OwnedImage CreateImage(vk::Extent2D extent, vk::ImageUsageFlags usage) const;
+    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+    // Draws the casters into squares of `squareSize` side by side, one per matrix.
+    void RecordCasters(const vk::raii::CommandBuffer &commandBuffer, vk::ImageView view,
+                       vk::AttachmentLoadOp loadOp, uint32_t squareSize,
+                       std::span<const glm::mat4> viewProj,
+                       const ShadowCasterRecorder &casters) const;
+    void RecordCache(const vk::raii::CommandBuffer &commandBuffer, uint32_t cascade,
+                     const ShadowCascades &cascades, uint64_t staticVersion,
+                     const glm::vec4 &staticBounds, const ShadowCasterRecorder &staticCasters);
+
+    const vk::raii::PhysicalDevice &m_physicalDevice;
+    const vk::raii::Device &m_device;
+    uint32_t m_resolution;
+
+    // the side of each cache's square, in texels
+    uint32_t m_cacheResolution;
+    std::array<Cache, ShadowCascadeCount> m_caches;
+
+    OwnedImage m_atlas;
+    // where the cascades were when the atlas got its copies of the caches
+    std::array<glm::ivec2, ShadowCascadeCount> m_atlasOrigins{};
+    // whether the atlas has dynamic casters that the next frame has to clear away
+    bool m_atlasHasDynamic = false;
+
+    vk::raii::Sampler m_sampler = nullptr;
+};
+
+} // namespace vkstart
@@ -0,0 +1,50 @@
+#include "StartupTimer.h"
+
+namespace vkstart
+{
+
+static double Milliseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+StartupTimer::StartupTimer()
+    : m_start{Clock::now()}, m_mainThread{std::this_thread::get_id()}
+{
+}
+
+void StartupTimer::Measure(std::string name, const std::function<void()> &step)
+{
+    const Clock::time_point start = Clock::now();
+    step();
+    const Clock::time_point end = Clock::now();
+
+    const bool onMainThread = std::this_thread::get_id() == m_mainThread;
+    std::lock_guard lock{m_mutex};
+    m_steps.push_back({std::move(name), start, end, onMainThread});
+}
+
+void StartupTimer::Report() const
+{
+    std::lock_guard lock{m_mutex};
+
+    std::vector<const Step *> steps{};
+    for (const Step &step : m_steps)
+    {
+        steps.push_back(&step);
+    }
+    std::ranges::sort(steps, {}, &Step::Start);
+
+    Clock::time_point end = m_start;
+    for (const Step *step : steps)
+    {
+        SDL_Log("startup: %-24s %8.2f ms, from %8.2f ms%s", step->Name.c_str(),
+                Milliseconds(step->End - step->Start), Milliseconds(step->Start - m_start),
+                step->OnMainThread ? "" : " (job)");
+        end = std::max(end, step->End);
+    }
+
+    SDL_Log("startup: %-24s %8.2f ms", "total", Milliseconds(end - m_start));
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace vkstart
+{
+
+// Wall-clock timings of the steps of a startup, which overlap where they run on jobs.
+struct StartupTimer
+{
+    StartupTimer();
+
+    // Runs `step`, and records how long it took, unless it throws. Safe to call from any thread.
+    void Measure(std::string name, const std::function<void()> &step);
+
+    // Logs every step in the order they started, where on the timeline, and the total.
+    void Report() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Step
+    {
+        std::string Name;
+        Clock::time_point Start;
+        Clock::time_point End;
+        bool OnMainThread;
+    };
+
+    Clock::time_point m_start;
+    std::thread::id m_mainThread;
+
+    mutable std::mutex m_mutex;
+    std::vector<Step> m_steps;
+};
+
+} // namespace vkstart
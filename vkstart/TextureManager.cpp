@@ -0,0 +1,508 @@
+#include "TextureManager.h"
+
+namespace vkstart
+{
+
+constexpr vk::Format TextureFormat = vk::Format::eR8G8B8A8Srgb;
+constexpr uint32_t TexelSize = 4;
+
+// Mips this small are always resident, so that there is something to sample at all.
+constexpr uint32_t MaxTailSize = 64;
+
+// Share of the device local heap that textures may take, of what the memory budget
+// (or, without VK_EXT_memory_budget, the heap size) says.
+constexpr float HeapBudgetFraction = 0.5f;
+
+// Every stream-in re-uploads the whole new image, so they are spread over frames.
+constexpr uint32_t MaxStreamInsPerUpdate = 2;
+
+// After a failed allocation, how long until the device gets to show whether it has more
+// memory again, without VK_EXT_memory_budget telling us.
+constexpr uint64_t AllocationCapFrames = 600;
+
+static float SrgbToLinear(uint8_t value)
+{
+    const float c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t LinearToSrgb(float value)
+{
+    const float c =
+        value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static std::vector<uint8_t> Downsample(const std::vector<uint8_t> &pixels, uint32_t width,
+                                       uint32_t height, uint32_t newWidth, uint32_t newHeight)
+{
+    static const std::array<float, 256> toLinear = []() {
+        std::array<float, 256> table{};
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            table[i] = SrgbToLinear(static_cast<uint8_t>(i));
+        }
+        return table;
+    }();
+
+    std::vector<uint8_t> result(static_cast<size_t>(newWidth) * newHeight * TexelSize);
+    for (uint32_t y = 0; y < newHeight; ++y)
+    {
+        for (uint32_t x = 0; x < newWidth; ++x)
+        {
+            const std::array<uint32_t, 2> xs{std::min(x * 2, width - 1),
+                                             std::min(x * 2 + 1, width - 1)};
+            const std::array<uint32_t, 2> ys{std::min(y * 2, height - 1),
+                                             std::min(y * 2 + 1, height - 1)};
+
+            // color is averaged in linear space, alpha as it is
+            std::array<float, TexelSize> sum{};
+            for (uint32_t sy : ys)
+            {
+                for (uint32_t sx : xs)
+                {
+                    const uint8_t *texel = &pixels[(static_cast<size_t>(sy) * width + sx) * 4];
+                    for (size_t c = 0; c < 3; ++c)
+                    {
+                        sum[c] += toLinear[texel[c]];
+                    }
+                    sum[3] += texel[3];
+                }
+            }
+
+            uint8_t *texel = &result[(static_cast<size_t>(y) * newWidth + x) * TexelSize];
+            for (size_t c = 0; c < 3; ++c)
+            {
+                texel[c] = LinearToSrgb(sum[c] * 0.25f);
+            }
+            texel[3] = static_cast<uint8_t>(sum[3] * 0.25f + 0.5f);
+        }
+    }
+
+    return result;
+}
+
+TextureManager::TextureManager(const vk::raii::PhysicalDevice &physicalDevice,
+                               const vk::raii::Device &device, DeletionQueue &deletionQueue,
+                               bool hasMemoryBudget, uint32_t uploadFamily,
+                               uint32_t sampleFamily, vk::DeviceSize budget)
+    : m_physicalDevice{physicalDevice}, m_device{device}, m_deletionQueue{deletionQueue},
+      m_hasMemoryBudget{hasMemoryBudget},
+      m_upload{uploadFamily,
+               sampleFamily,
+               vk::PipelineStageFlagBits2::eCopy,
+               vk::AccessFlagBits2::eTransferWrite,
+               vk::PipelineStageFlagBits2::eFragmentShader,
+               vk::AccessFlagBits2::eShaderSampledRead},
+      m_configuredBudget{budget}
+{
+}
+
+TextureHandle TextureManager::Add(uint32_t width, uint32_t height, const uint8_t *pixels)
+{
+    Texture texture{};
+
+    std::vector<uint8_t> level{pixels, pixels + static_cast<size_t>(width) * height * TexelSize};
+    texture.Mips.push_back({width, height, std::move(level)});
+    while (width > 1 || height > 1)
+    {
+        const uint32_t newWidth = std::max(width / 2, 1u);
+        const uint32_t newHeight = std::max(height / 2, 1u);
+        texture.Mips.push_back(
+            {newWidth, newHeight,
+             Downsample(texture.Mips.back().Pixels, width, height, newWidth, newHeight)});
+        width = newWidth;
+        height = newHeight;
+    }
+
+    texture.ResidentMip = static_cast<uint32_t>(texture.Mips.size());
+    texture.DesiredMip = TailMip(texture);
+
+    m_textures.push_back(std::move(texture));
+
+    return static_cast<TextureHandle>(m_textures.size() - 1);
+}
+
+void TextureManager::Request(TextureHandle texture, float projectedSize, uint64_t frame)
+{
+    Texture &t = m_textures[texture];
+
+    const float largest = static_cast<float>(std::max(t.Mips[0].Width, t.Mips[0].Height));
+    const float ratio = largest / std::max(projectedSize, 1.0f);
+    const uint32_t desiredMip =
+        std::min(ratio <= 1.0f ? 0 : static_cast<uint32_t>(std::log2(ratio)), TailMip(t));
+
+    if (t.LastUsed != frame)
+    {
+        t.LastUsed = frame;
+        t.DesiredMip = desiredMip;
+        t.Priority = projectedSize;
+    }
+    else
+    {
+        t.DesiredMip = std::min(t.DesiredMip, desiredMip);
+        t.Priority = std::max(t.Priority, projectedSize);
+    }
+}
+
+void TextureManager::Update(const vk::raii::CommandBuffer &uploadCommandBuffer,
+                            const vk::raii::CommandBuffer &sampleCommandBuffer, uint64_t frame)
+{
+    if (m_allocationCap && (DeviceBudget() > m_allocationCap->DeviceBudget ||
+                            frame - m_allocationCap->Frame >= AllocationCapFrames))
+    {
+        // what was left to other applications may be ours again
+        m_allocationCap.reset();
+    }
+
+    const vk::DeviceSize budget = Budget();
+
+    std::vector<uint32_t> targets(m_textures.size());
+    vk::DeviceSize projected = 0;
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        const Texture &texture = m_textures[i];
+        targets[i] = std::min(texture.ResidentMip, TailMip(texture));
+        projected += EstimatedBytes(texture, targets[i]);
+    }
+
+    // least recently used first, then least important
+    std::vector<uint32_t> evictionOrder(m_textures.size());
+    std::iota(evictionOrder.begin(), evictionOrder.end(), 0);
+    std::sort(evictionOrder.begin(), evictionOrder.end(), [this](uint32_t a, uint32_t b) {
+        const Texture &ta = m_textures[a];
+        const Texture &tb = m_textures[b];
+        if (ta.LastUsed != tb.LastUsed)
+        {
+            return ta.LastUsed < tb.LastUsed;
+        }
+        return ta.Priority < tb.Priority;
+    });
+
+    // drops high mips of textures last used before `usedBefore` until within `limit`
+    auto evict = [&](vk::DeviceSize limit, uint64_t usedBefore) {
+        for (uint32_t i : evictionOrder)
+        {
+            const Texture &texture = m_textures[i];
+            if (projected <= limit || texture.LastUsed >= usedBefore)
+            {
+                break;
+            }
+
+            while (projected > limit && targets[i] < TailMip(texture))
+            {
+                projected -= EstimatedBytes(texture, targets[i]) -
+                             EstimatedBytes(texture, targets[i] + 1);
+                ++targets[i];
+            }
+        }
+        return projected <= limit;
+    };
+
+    // over budget, anything goes, even what is on screen right now
+    evict(budget, std::numeric_limits<uint64_t>::max());
+
+    std::vector<uint32_t> streamIns{};
+    for (uint32_t i = 0; i < m_textures.size(); ++i)
+    {
+        if (m_textures[i].LastUsed == frame && m_textures[i].DesiredMip < targets[i])
+        {
+            streamIns.push_back(i);
+        }
+    }
+    std::stable_sort(streamIns.begin(), streamIns.end(), [this](uint32_t a, uint32_t b) {
+        return m_textures[a].Priority > m_textures[b].Priority;
+    });
+
+    uint32_t streamInCount = 0;
+    for (uint32_t i : streamIns)
+    {
+        if (streamInCount == MaxStreamInsPerUpdate)
+        {
+            break;
+        }
+
+        const Texture &texture = m_textures[i];
+        const vk::DeviceSize cost =
+            EstimatedBytes(texture, targets[i] - 1) - EstimatedBytes(texture, targets[i]);
+        if (cost > budget || !evict(budget - cost, frame))
+        {
+            continue;
+        }
+
+        --targets[i];
+        projected += cost;
+        ++streamInCount;
+    }
+
+    // evictions first, so that their memory can be reused as soon as the GPU lets go of it
+    for (bool streamingIn : {false, true})
+    {
+        for (size_t i = 0; i < m_textures.size(); ++i)
+        {
+            Texture &texture = m_textures[i];
+            const bool streamsIn = targets[i] < texture.ResidentMip;
+            if (targets[i] == texture.ResidentMip || streamsIn != streamingIn)
+            {
+                continue;
+            }
+
+            const bool firstResidency = texture.ResidentMip == texture.Mips.size();
+            if (!MakeResident(texture, targets[i], uploadCommandBuffer, sampleCommandBuffer,
+                              frame))
+            {
+                if (firstResidency)
+                {
+                    throw std::runtime_error("out of device memory for the always resident mips");
+                }
+
+                // the budget was too optimistic, stay where we are
+                m_allocationCap = AllocationCap{m_residentBytes, DeviceBudget(), frame};
+            }
+        }
+    }
+}
+
+vk::ImageView TextureManager::ImageView(TextureHandle texture) const
+{
+    return m_textures[texture].View;
+}
+
+uint32_t TextureManager::ResidentMip(TextureHandle texture) const
+{
+    return m_textures[texture].ResidentMip;
+}
+
+uint32_t TextureManager::MipCount(TextureHandle texture) const
+{
+    return static_cast<uint32_t>(m_textures[texture].Mips.size());
+}
+
+vk::DeviceSize TextureManager::Budget() const
+{
+    vk::DeviceSize budget = DeviceBudget();
+    if (m_configuredBudget > 0)
+    {
+        budget = std::min(budget, m_configuredBudget);
+    }
+    if (m_allocationCap)
+    {
+        budget = std::min(budget, m_allocationCap->Bytes);
+    }
+
+    return budget;
+}
+
+vk::DeviceSize TextureManager::DeviceBudget() const
+{
+    // the budget struct may only be chained when VK_EXT_memory_budget is enabled
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+    vk::PhysicalDeviceMemoryBudgetPropertiesEXT memoryBudget;
+    if (m_hasMemoryBudget)
+    {
+        auto properties = m_physicalDevice.getMemoryProperties2<
+            vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        memoryProperties = properties.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+        memoryBudget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    }
+    else
+    {
+        memoryProperties = m_physicalDevice.getMemoryProperties();
+    }
+
+    vk::DeviceSize budget = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+    {
+        const vk::MemoryHeap &heap = memoryProperties.memoryHeaps[i];
+        if (!(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal))
+        {
+            continue;
+        }
+
+        vk::DeviceSize heapBudget = static_cast<vk::DeviceSize>(heap.size * HeapBudgetFraction);
+        if (m_hasMemoryBudget)
+        {
+            // the usage includes our own textures, which are ours to redistribute
+            const vk::DeviceSize others =
+                memoryBudget.heapUsage[i] - std::min(memoryBudget.heapUsage[i], m_residentBytes);
+            const vk::DeviceSize available =
+                memoryBudget.heapBudget[i] - std::min(memoryBudget.heapBudget[i], others);
+            heapBudget = std::min(
+                static_cast<vk::DeviceSize>(memoryBudget.heapBudget[i] * HeapBudgetFraction),
+                available);
+        }
+        budget = std::max(budget, heapBudget);
+    }
+
+    return budget;
+}
+
+vk::DeviceSize TextureManager::ResidentBytes() const
+{
+    return m_residentBytes;
+}
+
+uint32_t TextureManager::TailMip(const Texture &texture) const
+{
+    for (uint32_t mip = 0; mip < texture.Mips.size(); ++mip)
+    {
+        if (std::max(texture.Mips[mip].Width, texture.Mips[mip].Height) <= MaxTailSize)
+        {
+            return mip;
+        }
+    }
+
+    return static_cast<uint32_t>(texture.Mips.size()) - 1;
+}
+
+vk::DeviceSize TextureManager::EstimatedBytes(const Texture &texture, uint32_t mip) const
+{
+    vk::DeviceSize bytes = 0;
+    for (uint32_t level = mip; level < texture.Mips.size(); ++level)
+    {
+        bytes += texture.Mips[level].Pixels.size();
+    }
+
+    return bytes;
+}
+
+uint32_t TextureManager::FindMemoryType(uint32_t typeFilter,
+                                        vk::MemoryPropertyFlags properties) const
+{
+    vk::PhysicalDeviceMemoryProperties memProperties = m_physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) &&
+            (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("no suitable memory type found");
+}
+
+bool TextureManager::MakeResident(Texture &texture, uint32_t mip,
+                                  const vk::raii::CommandBuffer &uploadCommandBuffer,
+                                  const vk::raii::CommandBuffer &sampleCommandBuffer,
+                                  uint64_t frame)
+{
+    const MipLevel &top = texture.Mips[mip];
+    const auto levelCount = static_cast<uint32_t>(texture.Mips.size()) - mip;
+    const uint32_t arrayLayers = 1;
+    vk::ImageCreateInfo imageCreateInfo{{},
+                                        vk::ImageType::e2D,
+                                        TextureFormat,
+                                        {top.Width, top.Height, 1},
+                                        levelCount,
+                                        arrayLayers,
+                                        vk::SampleCountFlagBits::e1,
+                                        vk::ImageTiling::eOptimal,
+                                        vk::ImageUsageFlagBits::eTransferDst |
+                                            vk::ImageUsageFlagBits::eSampled,
+                                        vk::SharingMode::eExclusive,
+                                        {},
+                                        vk::ImageLayout::eUndefined};
+
+    vk::raii::Image image = nullptr;
+    vk::raii::DeviceMemory memory = nullptr;
+    vk::MemoryRequirements memRequirements{};
+    try
+    {
+        image = vk::raii::Image{m_device, imageCreateInfo};
+        memRequirements = image.getMemoryRequirements();
+        vk::MemoryAllocateInfo allocInfo{
+            memRequirements.size,
+            FindMemoryType(memRequirements.memoryTypeBits,
+                           vk::MemoryPropertyFlagBits::eDeviceLocal)};
+        memory = vk::raii::DeviceMemory{m_device, allocInfo};
+        image.bindMemory(memory, 0);
+    }
+    catch (const vk::OutOfDeviceMemoryError &)
+    {
+        return false;
+    }
+
+    const vk::DeviceSize stagingSize = EstimatedBytes(texture, mip);
+    vk::BufferCreateInfo bufferCreateInfo{
+        {}, stagingSize, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive};
+    vk::raii::Buffer stagingBuffer{m_device, bufferCreateInfo};
+    vk::MemoryRequirements stagingRequirements = stagingBuffer.getMemoryRequirements();
+    vk::MemoryAllocateInfo stagingAllocInfo{
+        stagingRequirements.size,
+        FindMemoryType(stagingRequirements.memoryTypeBits,
+                       vk::MemoryPropertyFlagBits::eHostVisible |
+                           vk::MemoryPropertyFlagBits::eHostCoherent)};
+    vk::raii::DeviceMemory stagingMemory{m_device, stagingAllocInfo};
+    stagingBuffer.bindMemory(*stagingMemory, 0);
+
+    std::vector<vk::BufferImageCopy> regions{};
+    auto *data = static_cast<uint8_t *>(stagingMemory.mapMemory(0, stagingSize));
+    vk::DeviceSize offset = 0;
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        const MipLevel &mipLevel = texture.Mips[mip + level];
+        memcpy(data + offset, mipLevel.Pixels.data(), mipLevel.Pixels.size());
+
+        const uint32_t baseArrayLayer = 0;
+        const uint32_t layerCount = 1;
+        vk::ImageSubresourceLayers subresourceLayers{vk::ImageAspectFlagBits::eColor, level,
+                                                     baseArrayLayer, layerCount};
+        const uint32_t bufferRowLength = 0;
+        const uint32_t bufferImageHeight = 0;
+        const vk::Extent3D extent{mipLevel.Width, mipLevel.Height, 1};
+        regions.push_back({offset, bufferRowLength, bufferImageHeight, subresourceLayers,
+                           vk::Offset3D{0, 0, 0}, extent});
+
+        offset += mipLevel.Pixels.size();
+    }
+    stagingMemory.unmapMemory();
+
+    const uint32_t baseMipLevel = 0;
+    const uint32_t baseArrayLayer = 0;
+    const uint32_t layerCount = 1;
+    const vk::ImageSubresourceRange subresourceRange{vk::ImageAspectFlagBits::eColor, baseMipLevel,
+                                                     levelCount, baseArrayLayer, layerCount};
+
+    vk::ImageMemoryBarrier2 toTransfer{vk::PipelineStageFlagBits2::eTopOfPipe,
+                                       {},
+                                       vk::PipelineStageFlagBits2::eTransfer,
+                                       vk::AccessFlagBits2::eTransferWrite,
+                                       vk::ImageLayout::eUndefined,
+                                       vk::ImageLayout::eTransferDstOptimal,
+                                       VK_QUEUE_FAMILY_IGNORED,
+                                       VK_QUEUE_FAMILY_IGNORED,
+                                       image,
+                                       subresourceRange};
+    uploadCommandBuffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, toTransfer});
+
+    uploadCommandBuffer.copyBufferToImage(stagingBuffer, image,
+                                          vk::ImageLayout::eTransferDstOptimal, regions);
+
+    m_upload.Release(uploadCommandBuffer, image, subresourceRange,
+                     vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+    m_upload.Acquire(sampleCommandBuffer, image, subresourceRange,
+                     vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    vk::ImageViewCreateInfo viewCreateInfo{
+        {}, image, vk::ImageViewType::e2D, TextureFormat, {}, subresourceRange};
+    vk::raii::ImageView view{m_device, viewCreateInfo};
+
+    // frames in flight may still sample the old image
+    m_deletionQueue.Retire(std::move(texture.View), frame);
+    m_deletionQueue.Retire(std::move(texture.Image), frame);
+    m_deletionQueue.Retire(std::move(texture.Memory), frame);
+    m_deletionQueue.Retire(std::move(stagingBuffer), frame);
+    m_deletionQueue.Retire(std::move(stagingMemory), frame);
+
+    m_residentBytes = m_residentBytes - texture.Bytes + memRequirements.size;
+    texture.Bytes = memRequirements.size;
+    texture.ResidentMip = mip;
+    texture.Image = std::move(image);
+    texture.Memory = std::move(memory);
+    texture.View = std::move(view);
+
+    return true;
+}
+
+} // namespace vkstart
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "DeletionQueue.h"
+#include "DeviceQueues.h"
+
+namespace vkstart
+{
+
+using TextureHandle = uint32_t;
+
+// Keeps the full mip chain of every texture in system memory, and only the mip levels
+// that are worth it on the GPU, within a VRAM budget.
+// A texture's image holds the levels from its resident mip down to 1x1; streaming a level
+// in or out replaces the image, and the old one goes to the deletion queue.
+struct TextureManager
+{
+    // A `budget` of 0 means as much as the device's memory budget allows.
+    // Uploads get recorded for `uploadFamily`, the images are sampled on `sampleFamily`.
+    TextureManager(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device,
+                   DeletionQueue &deletionQueue, bool hasMemoryBudget, uint32_t uploadFamily,
+                   uint32_t sampleFamily, vk::DeviceSize budget = 0);
+
+    // `pixels` are 8-bit sRGB RGBA. Nothing is resident before the next `Update`.
+    TextureHandle Add(uint32_t width, uint32_t height, const uint8_t *pixels);
+
+    // Asks for enough detail to cover `projectedSize` pixels on screen, along the larger
+    // side of the texture. The largest request since the last `Update` wins, and is
+    // also the texture's streaming priority.
+    void Request(TextureHandle texture, float projectedSize, uint64_t frame);
+
+    // Streams mip levels in and out according to the requests, evicting the
+    // least recently used high mips when over budget. Records the uploads
+    // into `uploadCommandBuffer`, and acquiring the new images into
+    // `sampleCommandBuffer`, which must execute after the uploads and before
+    // the textures get sampled. Within one family both may be the same.
+    void Update(const vk::raii::CommandBuffer &uploadCommandBuffer,
+                const vk::raii::CommandBuffer &sampleCommandBuffer, uint64_t frame);
+
+    vk::ImageView ImageView(TextureHandle texture) const;
+    uint32_t ResidentMip(TextureHandle texture) const;
+    uint32_t MipCount(TextureHandle texture) const;
+
+    vk::DeviceSize Budget() const;
+    vk::DeviceSize ResidentBytes() const;
+
+  private:
+    struct MipLevel
+    {
+        uint32_t Width;
+        uint32_t Height;
+        std::vector<uint8_t> Pixels;
+    };
+
+    // What the device actually let us allocate, after an allocation has failed.
+    struct AllocationCap
+    {
+        vk::DeviceSize Bytes;
+        // the device budget at the time, a larger one lifts the cap
+        vk::DeviceSize DeviceBudget;
+        uint64_t Frame;
+    };
+
+    struct Texture
+    {
+        std::vector<MipLevel> Mips;
+
+        // Mips.size() until something is resident
+        uint32_t ResidentMip;
+        uint32_t DesiredMip;
+        float Priority = 0.0f;
+        uint64_t LastUsed = 0;
+
+        vk::DeviceSize Bytes = 0;
+        vk::raii::Image Image = nullptr;
+        vk::raii::DeviceMemory Memory = nullptr;
+        vk::raii::ImageView View = nullptr;
+    };
+
+    // What the device's memory budget leaves to textures, before any limit of ours.
+    vk::DeviceSize DeviceBudget() const;
+    uint32_t TailMip(const Texture &texture) const;
+    vk::DeviceSize EstimatedBytes(const Texture &texture, uint32_t mip) const;
+    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+    bool MakeResident(Texture &texture, uint32_t mip,
+                      const vk::raii::CommandBuffer &uploadCommandBuffer,
+                      const vk::raii::CommandBuffer &sampleCommandBuffer, uint64_t frame);
+
+    const vk::raii::PhysicalDevice &m_physicalDevice;
+    const vk::raii::Device &m_device;
+    DeletionQueue &m_deletionQueue;
+    bool m_hasMemoryBudget;
+    OwnershipTransfer m_upload;
+    vk::DeviceSize m_configuredBudget;
+    std::optional<AllocationCap> m_allocationCap;
+    vk::DeviceSize m_residentBytes = 0;
+
+    std::vector<Texture> m_textures;
+};
+
+} // namespace vkstart
@@ -18,4 +18,14 @@ std::array<vk::VertexInputAttributeDescription, 3> Vertex::GetAttributeDescripti
                                                 offsetof(Vertex, TextureCoordinates))};
 }
 
+vk::VertexInputBindingDescription Vertex::GetPositionBindingDescription()
+{
+    return {0, sizeof(glm::vec3), vk::VertexInputRate::eVertex};
+}
+
+vk::VertexInputAttributeDescription Vertex::GetPositionAttributeDescription()
+{
+    return {0, 0, vk::Format::eR32G32B32Sfloat, 0};
+}
+
 } // namespace vkstart
\ No newline at end of file
@@ -13,6 +13,10 @@ struct Vertex
 
     static vk::VertexInputBindingDescription GetBindingDescription();
     static std::array<vk::VertexInputAttributeDescription, 3> GetAttributeDescriptions();
+
+    // of a stream of just the positions, which depth-only passes read
+    static vk::VertexInputBindingDescription GetPositionBindingDescription();
+    static vk::VertexInputAttributeDescription GetPositionAttributeDescription();
 };
 
 } // namespace vkstart
@@ -0,0 +1,69 @@
+#include "VirtualFileSystem.h"
+
+namespace vkstart
+{
+
+static std::vector<char> ReadLooseFile(const std::filesystem::path &filePath)
+{
+    std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open file " + filePath.string());
+    }
+
+    size_t fileSize = file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0, std::ios::beg);
+    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+    return buffer;
+}
+
+VirtualFileSystem::VirtualFileSystem(const std::filesystem::path &root) : m_root{root}
+{
+    const std::filesystem::path archivePath = m_root / DefaultArchiveName;
+    if (std::filesystem::exists(archivePath))
+    {
+        m_archive = std::make_unique<AssetArchive>(archivePath);
+    }
+}
+
+bool VirtualFileSystem::HasArchive() const
+{
+    return m_archive != nullptr;
+}
+
+std::vector<char> VirtualFileSystem::Read(const std::string &name) const
+{
+    if (m_archive && m_archive->Contains(name))
+    {
+        return m_archive->Read(name);
+    }
+
+    return ReadLooseFile(m_root / std::filesystem::path{name});
+}
+
+void VirtualFileSystem::ReadAsync(
+    const std::string &name, JobSystem &jobs, JobCounter &counter,
+    std::function<void(std::vector<char> data, std::exception_ptr error)> onLoaded) const
+{
+    auto read = [this, name, onLoaded = std::move(onLoaded)]() {
+        std::vector<char> data{};
+        std::exception_ptr error{};
+        try
+        {
+            data = Read(name);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        onLoaded(std::move(data), error);
+    };
+
+    jobs.Submit(read, counter);
+}
+
+} // namespace vkstart
\ No newline at end of file
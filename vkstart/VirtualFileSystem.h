@@ -0,0 +1,35 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "AssetArchive.h"
+#include "JobSystem.h"
+
+namespace vkstart
+{
+
+// Name of the archive that `VirtualFileSystem` mounts from its root, if there is one.
+constexpr const char *DefaultArchiveName = "assets.pak";
+
+// Asset names are relative paths with forward slashes, like "shaders/shader.slang.spv".
+// They are looked up in the archive first, then as loose files under the root.
+struct VirtualFileSystem
+{
+    explicit VirtualFileSystem(const std::filesystem::path &root);
+
+    bool HasArchive() const;
+
+    std::vector<char> Read(const std::string &name) const;
+
+    // Reads `name` on a job, and hands the result, or why there is none,
+    // to `onLoaded` on that same job.
+    void ReadAsync(const std::string &name, JobSystem &jobs, JobCounter &counter,
+                   std::function<void(std::vector<char> data, std::exception_ptr error)> onLoaded)
+        const;
+
+  private:
+    std::filesystem::path m_root;
+    std::unique_ptr<AssetArchive> m_archive;
+};
+
+} // namespace vkstart
@@ -3,4 +3,5 @@
 #include "stdafx.h"
 
 #include "Engine.h"
+#include "HeadlessWindow.h"
 #include "SDL3IWindow.h"